@@ -1,9 +1,12 @@
 #include "StoryManager.h" // Include the header for StoryManager
 #include <iostream>       // For std::cerr
 #include <fstream>        // For std::ifstream
-#include <sstream>        // For std::istringstream
 #include <algorithm>      // For std::min, std::max
+#include <filesystem>     // For std::filesystem::is_regular_file
 #include <cmath>          // For std::fabs (already in text_effects.cpp, but good for self-containment)
+#include "render_stats.h" // For counted draw calls and texture creation
+#include "utf8_text.h"    // For appendGraphemeStarts
+#include "story_tokenizer.h" // For StoryTokenizer, parseStoryNumber, parseStoryLabelTag
 
 // --- Global Constants Access ---
 // These are declared extern in text_ui.h and defined in main.cpp.
@@ -24,9 +27,13 @@ extern SDL_Color choiceBorderColor;
 // --- Constructor & Destructor ---
 StoryManager::StoryManager(SDL_Renderer* renderer, TTF_Font* dialogFont, TTF_Font* nameFont, TTF_TextEngine* textEngine)
     : gRenderer(renderer), gDialogFont(dialogFont), gNameFont(nameFont), gTextEngine(textEngine),
-      currentDialogIndex(0), currentVisibleCharCount(0), animationDelayMs(40.0f),
-      lastCharRevealTime(0), animationIsPlaying(true), awaitingChoice(false),
-      prevDialogIndex(0), currentStoryFile("") { // Initialize currentStoryFile
+      wordsLineIndex((size_t)-1),
+      currentDialogIndex(0), currentVisibleGraphemes(0), animationDelayMs(40.0f),
+      lineRevealStartNS(0), animationIsPlaying(true), awaitingChoice(false),
+      prevDialogIndex(0), currentStoryFile(""), clockNS(0), voicePlayer(nullptr), lineEntryPending(false), historyFile(0),
+      readLines(nullptr), skipHeld(false), skipActive(false), skipBudget(0.0f), skipPreviewNS(0), skipPreviewBytes(0), skipPreviewSpeaker(0),
+      streamingThresholdBytes(8 * 1024 * 1024), streamingActive(false), windowFirstLine(0), streamWarnedLines(0),
+      shapedLineIndex((size_t)-1), shapedWrapWidth(0), layoutLineIndex((size_t)-1), layoutWrapWidth(0) { // Initialize currentStoryFile
     // Constructor initializes internal state and takes SDL pointers
 }
 
@@ -36,366 +43,1286 @@ StoryManager::~StoryManager() {
 
 // --- Resource Management ---
 void StoryManager::clearAllStoryResources() {
-    for (auto& dialog : dialogLines) {
-        if (dialog.hasChoices) {
-            for (auto& choice : dialog.choices) {
-                if (choice.textTexture) {
-                    SDL_DestroyTexture(choice.textTexture);
-                    choice.textTexture = nullptr;
-                }
-            }
-        }
-        // Also clear jitter/physics words to free their memory if any
-        dialog.jitterWords.clear();
-        dialog.physicsWords.clear();
+    storyProgram.clear(); // Code and jump targets belong to the file; variables persist
+    destroyShapedText(shapedLine);
+    shapedLineIndex = (size_t)-1;
+    layoutLineIndex = (size_t)-1;
+
+    for (auto& choice : choices) {
+        if (choice.textObject) TTF_DestroyText(choice.textObject);
+    }
+    for (TTF_Text* speakerText : speakerTexts) {
+        if (speakerText) TTF_DestroyText(speakerText);
     }
-    dialogLines.clear(); // Clear the vector itself
+    dialogLines.clear();
+    storyText.clear();
+    lineTexts.clear();
+    textRuns.clear();
+    graphemeStarts.clear();
+    revealTimes.clear();
+    choices.clear();
+    effectSets.assign(1, LineEffectSet()); // Entry 0: no effects
+    effectSetLookup.clear();
+    speakerNames.clear();
+    speakerTexts.clear();
+
+    destroyRenderedWords(effectStage.words);
+    effectStage.wordsShown = false;
+    wordsLineIndex = (size_t)-1;
+}
+
+void StoryManager::releaseStoryResources() {
+    clearAllStoryResources();
 }
 
 // --- Story Loading ---
+// A laid out text of the load before a hot reload with these contents, or nullptr
+static TTF_Text* takeReloadText(std::unordered_multimap<std::string, TTF_Text*>& texts, std::string_view text) {
+    if (texts.empty()) return nullptr; // Not reloading
+    auto it = texts.find(std::string(text));
+    if (it == texts.end()) return nullptr;
+    TTF_Text* textObject = it->second;
+    texts.erase(it);
+    return textObject;
+}
+
 bool StoryManager::loadStory(const std::string& filename) {
-    clearAllStoryResources(); // Clear any previously loaded story and its resources
+    return loadStoryFile(filename, nullptr);
+}
 
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open story file: " << filename << std::endl;
-        return false;
+bool StoryManager::loadStoryFile(const std::string& filename, std::string* fileBytes) {
+    clearAllStoryResources(); // Clear any previously loaded story and its resources
+    streamingActive = false;
+    streamIndex.clear();
+    windowFirstLine = 0;
+    storyLabels.clear();
+
+    diagnostics.beginLoad(filename);
+
+    std::ifstream file;
+    Uint64 fileSize = fileBytes ? fileBytes->size() : 0;
+    if (!fileBytes) {
+        file.open(filename, std::ios::binary | std::ios::ate); // Opened at the end to read the size
+        if (!file.is_open()) {
+            diagnostics.report(DIAG_FILE, filename, 0, "file", "failed to open story file");
+            diagnostics.endLoad();
+            return false;
+        }
+        fileSize = (Uint64)file.tellg();
     }
 
     currentStoryFile = filename; // Store for relative jumps
+    historyFile = history.internFile(filename);
+    readLines = &readTracker.getFile(filename);
+
+    if (fileSize >= streamingThresholdBytes) {
+        // Large script: index it now and parse only a window of lines around the current one
+        file.close();
+        if (!buildStoryLineIndex(filename, streamIndex)) {
+            diagnostics.report(DIAG_FILE, filename, 0, "file", "failed to index story file");
+            diagnostics.endLoad();
+            return false;
+        }
+        for (const auto& voiceTag : streamIndex.voiceTags) {
+            if (!parseVoiceTag(voiceTag)) { // Voices apply to the whole file, wherever they're declared
+                diagnostics.report(DIAG_VOICE, filename, 0, "[VOICE]", "malformed tag: " + voiceTag);
+            }
+        }
+        storyLabels = streamIndex.labels; // Every label of the file, wherever the window is
+        streamingActive = true;
+        streamWarnedLines = 0;
+        loadStreamWindow(0);
+    } else {
+        // Read the whole script in one go; the tokenizer works on these bytes in place
+        if (fileBytes) {
+            fileBuffer.swap(*fileBytes);
+        } else {
+            file.seekg(0);
+            fileBuffer.resize((size_t)fileSize);
+            file.read(fileBuffer.data(), (std::streamsize)fileSize);
+            fileBuffer.resize((size_t)file.gcount());
+            file.close();
+        }
+        storyText.reserve(fileBuffer.size()); // Stripped text is never longer than the file
+        parseStoryLines(fileBuffer, filename, 0, "", (size_t)-1);
+    }
 
-    std::string line;
-    std::string currentSpeaker = "";
-    int rawLineNumber = 0;
+    currentDialogIndex = 0;
+    currentVisibleGraphemes = 0;
+    animationIsPlaying = true;
+    awaitingChoice = false;
+    lineRevealStartNS = clockNS;
+    prevDialogIndex = (size_t)-1; // Line 0's effects start on the next update
+    lineEntryPending = true; // Line 0's statements run on the next update
+    diagnostics.endLoad();
+
+    return true;
+}
 
-    // Temporary flags and parameters for the *next* dialog line to be loaded
-    bool nextLineShouldJitter = false;
-    bool nextLineShouldFall = false;
-    bool nextLineShouldFloat = false;
-    bool nextLineShouldPulse = false;
-    Uint64 nextLinePulseDuration = 1500;
-    float nextLinePulseFrequency = 2.0f;
-    SDL_Color nextLinePulseColor1 = {255,255,255,255};
-    SDL_Color nextLinePulseColor2 = {255,100,100,255};
+void StoryManager::setStreamingThreshold(Uint64 bytes) {
+    streamingThresholdBytes = bytes;
+}
 
-    bool nextLineShouldShake = false;
-    Uint64 nextLineShakeDuration = 0;
-    float nextLineShakeIntensity = 0.0f;
+void StoryManager::parseStoryLines(std::string_view buffer, const std::string& filename, int rawLineNumber,
+                                   std::string_view currentSpeaker, size_t maxLines) {
+    // One pass over the file bytes: every token is a view into `buffer`, so lines are never copied
+    StoryTokenizer tokenizer(buffer, rawLineNumber);
+    StoryToken token;
 
-    bool nextLineShouldTear = false;
-    Uint32 nextLineTearDuration = 0;
-    float nextLineTearMaxOffsetX = 0.0f;
-    float nextLineTearLineDensity = 0.0f;
+    // Effect tags for the *next* dialog line to be loaded
+    LineEffectSet nextLineEffects;
 
+    float nextLineCharDelayMs = animationDelayMs; // [SPEED ms]
 
-    while (std::getline(file, line)) {
-        rawLineNumber++;
-        size_t firstChar = line.find_first_not_of(" \t\r\n");
-        if (firstChar == std::string::npos) {
-            continue; // Skip empty or whitespace-only lines
-        }
-        std::string trimmedLine = line.substr(firstChar);
+    // Compiled [SET]/[ADD]/[IF] statements waiting for the next dialog line
+    std::vector<StoryInstr> pendingEnterCode;
+
+    // [LABEL]s waiting for the next dialog line, and the jump targets to check once every label is known
+    std::vector<std::string_view> pendingLabels;
+    struct TargetCheck {
+        Uint32 jumpTarget;
+        int rawLineNumber;
+        bool fromChoice; // Otherwise an [IF]
+    };
+    std::vector<TargetCheck> targetChecks;
+
+    // Scratch buffers reused for every line's markup
+    std::string plainText;
+    std::vector<TextStyleRun> lineRuns;
+    std::vector<TextTiming> textTimings;
+    std::string markupError;
+
+    Uint32 currentSpeakerId = internSpeaker(currentSpeaker);
+
+
+    while (tokenizer.next(token)) {
+        rawLineNumber = token.rawLineNumber;
+        std::string_view trimmedLine = token.text;
 
-        // Skip lines that start with a '#' comment character
-        if (trimmedLine.rfind("#", 0) == 0) {
+        // Skip empty or whitespace-only lines, and lines that start with a '#' comment character
+        if (token.kind == STORY_LINE_BLANK || token.kind == STORY_LINE_COMMENT) {
             continue;
         }
 
         // --- Handle Special Tags ---
-        if (trimmedLine == "[") { // Start of a choice block
+        if (token.kind == STORY_LINE_CHOICE_OPEN) { // Start of a choice block
             if (dialogLines.empty()) {
-                std::cerr << "Warning: Choice block found without preceding dialog on line " << rawLineNumber << " in " << filename << std::endl;
+                diagnostics.report(DIAG_CHOICE, filename, rawLineNumber, "choice", "choice block without a preceding dialog line");
                 continue;
             }
 
             DialogLine& lastDialog = dialogLines.back(); // Choices belong to the most recently added dialog line
-            lastDialog.hasChoices = true;
+            if (lastDialog.choiceCount == 0) {
+                lastDialog.firstChoice = (Uint32)choices.size(); // Nothing is added between a line and its choices
+            }
 
-            // Reset all "next line should" flags and parameters for the *next* dialog line (after choices)
+            // Reset the effect tags for the *next* dialog line (after choices)
             // This ensures effects don't carry over unintentionally if a choice leads to a new dialog line
-            nextLineShouldJitter = false;
-            nextLineShouldFall = false;
-            nextLineShouldFloat = false;
-            nextLineShouldPulse = false;
-            nextLinePulseDuration = 1500;
-            nextLinePulseFrequency = 2.0f;
-            nextLinePulseColor1 = {255,255,255,255};
-            nextLinePulseColor2 = {255,100,100,255};
-            nextLineShouldShake = false;
-            nextLineShakeDuration = 0;
-            nextLineShakeIntensity = 0.0f;
-            nextLineShouldTear = false;
-            nextLineTearDuration = 0;
-            nextLineTearMaxOffsetX = 0.0f;
-            nextLineTearLineDensity = 0.0f;
-
-            while (std::getline(file, line)) {
-                rawLineNumber++;
-                size_t choiceLineFirstChar = line.find_first_not_of(" \t\r\n");
-                if (choiceLineFirstChar == std::string::npos) continue;
-                trimmedLine = line.substr(choiceLineFirstChar);
-
-                if (trimmedLine == "]") break; // End of choice block
-                if (trimmedLine.rfind("#", 0) == 0) continue; // Skip comments in choice block
-
-                size_t firstQuote = trimmedLine.find('"');
-                size_t secondQuote = trimmedLine.find('"', firstQuote + 1);
-                size_t arrow = trimmedLine.find("->");
-
-                if (firstQuote == std::string::npos || secondQuote == std::string::npos || arrow == std::string::npos ||
-                    firstQuote >= secondQuote || secondQuote >= arrow) {
-                    std::cerr << "Warning: Malformed choice line " << rawLineNumber << " in " << filename << ": " << line << std::endl;
+            nextLineEffects = LineEffectSet();
+            if (!pendingEnterCode.empty()) {
+                diagnostics.report(DIAG_STATEMENT, filename, rawLineNumber, "statement", "statements before a choice block have no dialog line and are ignored");
+                pendingEnterCode.clear();
+            }
+
+            StoryChoiceToken choiceToken;
+            while (tokenizer.next(token)) {
+                rawLineNumber = token.rawLineNumber;
+                if (token.kind == STORY_LINE_BLANK) continue;
+                if (token.kind == STORY_LINE_CHOICE_CLOSE) break; // End of choice block
+                if (token.kind == STORY_LINE_COMMENT) continue; // Skip comments in choice block
+                trimmedLine = token.text;
+
+                if (!parseStoryChoiceLine(trimmedLine, choiceToken)) {
+                    diagnostics.report(DIAG_CHOICE, filename, rawLineNumber, "choice", "malformed choice line: " + std::string(trimmedLine));
                     continue;
                 }
 
                 Choice c;
-                c.text = trimmedLine.substr(firstQuote + 1, secondQuote - (firstQuote + 1));
-                std::string targetString = trimmedLine.substr(arrow + 2);
-                size_t colonPos = targetString.find(':');
-
-                if (colonPos != std::string::npos) {
-                    c.nextFile = targetString.substr(0, colonPos);
-                    try { c.nextDialogIndex = std::stoi(targetString.substr(colonPos + 1)); }
-                    catch (...) { std::cerr << "Invalid choice index in " << filename << " on line " << rawLineNumber << std::endl; c.nextDialogIndex = 0; }
-                } else {
-                    c.nextDialogIndex = 0;
-                    try {
-                        size_t end;
-                        int val = std::stoi(targetString, &end);
-                        if (end == targetString.length()) {
-                            c.nextDialogIndex = val;
-                            c.nextFile = "";
-                        } else {
-                            c.nextFile = targetString;
-                            c.nextDialogIndex = 0;
-                        }
+                c.text = storyText.add(choiceToken.text);
+
+                // Optional trailing condition: "Text" -> target [IF expr]
+                if (choiceToken.hasCondition) {
+                    std::string conditionError;
+                    if (!choiceToken.conditionClosed) {
+                        conditionError = "missing ']'";
+                    } else {
+                        c.condition = compileStoryCondition(std::string(choiceToken.condition), storyProgram, storyVariables, conditionError);
                     }
-                    catch (...) {
-                        std::cerr << "Invalid choice target in " << filename << " on line " << rawLineNumber << ": " << targetString << std::endl;
-                        c.nextDialogIndex = 0;
-                        c.nextFile = "";
+                    if (c.condition == STORY_NO_CODE) {
+                        diagnostics.report(DIAG_STATEMENT, filename, rawLineNumber, "[IF]", "malformed choice condition: " + conditionError);
                     }
                 }
 
-                // Pre-render choice text texture here
-                // Use the current global winWidth for wrapping when pre-rendering
-                TTF_GetStringSize(gDialogFont, c.text.c_str(), c.text.length(), &c.textWidth, &c.textHeight);
-                SDL_Surface* textSurface = TTF_RenderText_Blended_Wrapped(gDialogFont, c.text.c_str(), c.text.length(), textColorWhite, winWidth);
-                if (textSurface) {
-                    c.textTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
-                    SDL_DestroySurface(textSurface);
-                    if (!c.textTexture) {
-                         std::cerr << "Failed to create texture for choice text: " << SDL_GetError() << std::endl;
-                    }
+                StoryJumpTarget target;
+                std::string_view targetFile, targetLabel;
+                if (parseStoryTarget(choiceToken.target, targetFile, targetLabel, target.lineIndex)) {
+                    target.file = std::string(targetFile);
+                    target.label = std::string(targetLabel);
+                    targetChecks.push_back({(Uint32)storyProgram.jumpTargets.size(), rawLineNumber, true});
                 } else {
-                    std::cerr << "Failed to create surface for choice text: " << SDL_GetError() << std::endl;
+                    diagnostics.report(DIAG_CHOICE, filename, rawLineNumber, "choice", "invalid choice target: " + std::string(choiceToken.target));
+                    target.lineIndex = -1;
+                }
+                c.target = (Uint32)storyProgram.jumpTargets.size();
+                storyProgram.jumpTargets.push_back(std::move(target));
+
+                if (lastDialog.choiceCount == 0xFFFF) {
+                    diagnostics.report(DIAG_CHOICE, filename, rawLineNumber, "choice", "too many choices for one line");
+                    continue;
                 }
 
-                lastDialog.choices.push_back(c);
+                // Lay the choice text out once, wrapped to the current global winWidth (a hot reload
+                // takes over the previous load's text if it's unchanged)
+                TTF_GetStringSize(gDialogFont, storyText.c_str(c.text), c.text.length, &c.textWidth, &c.textHeight);
+                if (gTextEngine) {
+                    c.textObject = takeReloadText(reloadChoiceTexts, choiceToken.text);
+                    if (!c.textObject) {
+                        c.textObject = TTF_CreateText(gTextEngine, gDialogFont, storyText.c_str(c.text), c.text.length);
+                        if (c.textObject) {
+                            TTF_SetTextWrapWidth(c.textObject, winWidth);
+                            TTF_SetTextColor(c.textObject, textColorWhite.r, textColorWhite.g, textColorWhite.b, textColorWhite.a);
+                        } else {
+                            diagnostics.report(DIAG_RESOURCE, filename, rawLineNumber, "choice", std::string("failed to create text for choice: ") + SDL_GetError());
+                        }
+                    }
+                    if (c.textObject) {
+                        TTF_GetTextSize(c.textObject, &c.textWidth, &c.textHeight);
+                    }
+                }
+                choices.push_back(c);
+                lastDialog.choiceCount++;
+            }
+            continue;
+        }
+        else if (token.kind == STORY_LINE_TAG && isEffectTag(trimmedLine)) {
+            // [JITTER], [SHAKE ms intensity], ... - any tag of the effect registry, parsed once here
+            EffectSpec spec;
+            std::string effectError;
+            if (parseEffectTag(trimmedLine, spec, effectError)) {
+                addEffectSpec(nextLineEffects.effects, spec);
+            } else {
+                diagnostics.report(DIAG_EFFECT_TAG, filename, rawLineNumber, "[" + std::string(token.tagName) + "]", effectError);
             }
             continue;
         }
-        else if (trimmedLine == "[JITTER]") { nextLineShouldJitter = true; continue; }
-        else if (trimmedLine == "[FALL]") { nextLineShouldFall = true; continue; }
-        else if (trimmedLine == "[FLOAT]") { nextLineShouldFloat = true; continue; }
-        else if (trimmedLine.rfind("[PULSE", 0) == 0) {
-            size_t closeBracketPos = trimmedLine.find(']');
-            if (closeBracketPos == std::string::npos) {
-                std::cerr << "Warning: Malformed [PULSE] tag on line " << rawLineNumber << ": Missing ']' -> " << line << std::endl; continue;
+        else if (trimmedLine.rfind("[SET", 0) == 0 || trimmedLine.rfind("[ADD", 0) == 0 || trimmedLine.rfind("[IF", 0) == 0) {
+            // Variable statements compile into the next dialog line's enter code
+            std::string statementError;
+            const size_t firstTarget = storyProgram.jumpTargets.size();
+            if (!compileStoryStatement(std::string(trimmedLine), pendingEnterCode, storyProgram, storyVariables, statementError)) {
+                diagnostics.report(DIAG_STATEMENT, filename, rawLineNumber, std::string(trimmedLine.substr(0, trimmedLine.find_first_of(" ]"))) + "]", statementError);
+            }
+            for (size_t i = firstTarget; i < storyProgram.jumpTargets.size(); ++i) {
+                targetChecks.push_back({(Uint32)i, rawLineNumber, false});
             }
-            std::string tagContent = trimmedLine.substr(0, closeBracketPos + 1);
-            std::istringstream iss(tagContent);
-            std::string tagStr;
-            int r1, g1, b1, a1, r2, g2, b2, a2;
-            Uint64 duration;
-            float frequency;
-            iss >> tagStr;
-            if (iss >> duration >> frequency >> r1 >> g1 >> b1 >> a1 >> r2 >> g2 >> b2 >> a2) {
-                 nextLineShouldPulse = true;
-                 nextLinePulseDuration = duration;
-                 nextLinePulseFrequency = frequency;
-                 nextLinePulseColor1 = {(Uint8)r1, (Uint8)g1, (Uint8)b1, (Uint8)a1};
-                 nextLinePulseColor2 = {(Uint8)r2, (Uint8)g2, (Uint8)b2, (Uint8)a2};
-            } else { std::cerr << "Warning: Malformed [PULSE] parameters on line " << rawLineNumber << ": " << line << std::endl; }
             continue;
         }
-        else if (trimmedLine.rfind("[SHAKE", 0) == 0) {
-            size_t closeBracketPos = trimmedLine.find(']');
-            if (closeBracketPos == std::string::npos) {
-                std::cerr << "Warning: Malformed [SHAKE] tag on line " << rawLineNumber << ": Missing ']' -> " << line << std::endl; continue;
+        else if (trimmedLine.rfind("[LABEL", 0) == 0) {
+            // [LABEL name] - names the next dialog line as a jump target: -> name or -> file:name
+            std::string_view labelName;
+            if (parseStoryLabelTag(token, labelName)) {
+                pendingLabels.push_back(labelName);
+            } else {
+                diagnostics.report(DIAG_LABEL, filename, rawLineNumber, "[LABEL]", "malformed tag: " + std::string(trimmedLine));
             }
-            std::string tagContent = trimmedLine.substr(0, closeBracketPos + 1);
-            std::istringstream iss(tagContent);
-            std::string tagStr;
-            Uint64 duration;
-            float intensity;
-            iss >> tagStr;
-            if (iss >> duration >> intensity) {
-                 nextLineShouldShake = true;
-                 nextLineShakeDuration = duration;
-                 nextLineShakeIntensity = intensity;
-            } else { std::cerr << "Warning: Malformed [SHAKE] parameters on line " << rawLineNumber << ": " << line << std::endl; }
             continue;
         }
-        else if (trimmedLine.rfind("[TEAR", 0) == 0) {
-            size_t closeBracketPos = trimmedLine.find(']');
-            if (closeBracketPos == std::string::npos) {
-                std::cerr << "Warning: Malformed [TEAR] tag on line " << rawLineNumber << ": Missing ']' -> " << line << std::endl; continue;
+        else if (trimmedLine.rfind("[VOICE", 0) == 0) {
+            // [VOICE 'Speaker Name' pitchHz lengthMs volume] - typewriter blip voice for one speaker
+            if (!parseVoiceTag(trimmedLine)) {
+                diagnostics.report(DIAG_VOICE, filename, rawLineNumber, "[VOICE]", "malformed tag: " + std::string(trimmedLine));
             }
-            std::string tagContent = trimmedLine.substr(0, closeBracketPos + 1);
-            std::istringstream iss(tagContent);
-            std::string tagStr;
-            Uint32 duration;
-            float maxOffsetX;
-            float density;
-            iss >> tagStr;
-            if (iss >> duration >> maxOffsetX >> density) {
-                 nextLineShouldTear = true;
-                 nextLineTearDuration = duration;
-                 nextLineTearMaxOffsetX = maxOffsetX;
-                 nextLineTearLineDensity = density;
-            } else { std::cerr << "Warning: Malformed [TEAR] parameters on line " << rawLineNumber << ": " << line << std::endl; }
+            continue;
+        }
+        else if (trimmedLine.rfind("[SPEED", 0) == 0) {
+            // [SPEED ms] - per-character typewriter delay for the next line (0 shows it at once)
+            std::string_view args;
+            float delayMs;
+            if (getStoryTagArgs(token, args) && parseStoryNumber(args, delayMs) && delayMs >= 0.0f) {
+                nextLineCharDelayMs = delayMs;
+            } else { diagnostics.report(DIAG_EFFECT_TAG, filename, rawLineNumber, "[SPEED]", "malformed parameters: " + std::string(trimmedLine)); }
             continue;
         }
 
 
-        size_t speakerQuoteEnd = trimmedLine.find('\'', 1);
-        if (trimmedLine.front() == '\'' && speakerQuoteEnd != std::string::npos) {
-            currentSpeaker = trimmedLine.substr(1, speakerQuoteEnd - 1);
-            trimmedLine = trimmedLine.substr(speakerQuoteEnd + 1);
-            size_t recheckedFirstChar = trimmedLine.find_first_not_of(" \t\r\n");
-            if (recheckedFirstChar != std::string::npos) trimmedLine = trimmedLine.substr(recheckedFirstChar);
-            else trimmedLine = "";
+        if (token.hasSpeaker) {
+            currentSpeakerId = internSpeaker(token.speaker);
         }
 
-        size_t dialogQuoteEnd = trimmedLine.find('"', 1);
-        if (trimmedLine.front() == '"' && dialogQuoteEnd != std::string::npos) {
+        if (token.kind == STORY_LINE_DIALOG) {
+            if (dialogLines.size() >= maxLines) {
+                break; // Reached the first line past a streaming window
+            }
             DialogLine dl;
-            dl.speakerName = currentSpeaker;
-            dl.dialogText = trimmedLine.substr(1, dialogQuoteEnd - 1);
-            dl.hasChoices = false;
-
-            dl.applyJitter = nextLineShouldJitter;
-            dl.applyFall = nextLineShouldFall;
-            dl.applyFloat = nextLineShouldFloat;
-            dl.applyPulse = nextLineShouldPulse;
-            dl.pulseDurationMs = nextLinePulseDuration;
-            dl.pulseFrequencyHz = nextLinePulseFrequency;
-            dl.pulseColor1 = nextLinePulseColor1;
-            dl.pulseColor2 = nextLinePulseColor2;
-            dl.applyShake = nextLineShouldShake;
-            dl.shakeDuration = nextLineShakeDuration;
-            dl.shakeIntensity = nextLineShakeIntensity;
-            dl.applyTear = nextLineShouldTear;
-            dl.tearDuration = nextLineTearDuration;
-            dl.tearMaxOffsetX = nextLineTearMaxOffsetX;
-            dl.tearLineDensity = nextLineTearLineDensity;
-            dl.physicsActive = false;
-
-
-            const int textStartXForEffectInit = (int)(winWidth * 0.1f + textPadding);
-            const int textStartYForEffectInit = (int)(winHeight * 0.55f + textPadding);
-            const int textWrapWidthForEffectInit = (int)(winWidth * 0.8f - (2 * textPadding));
-
-            if (dl.applyJitter) {
-                dl.jitterWords = initJitterWords(gRenderer, gDialogFont, dl.dialogText,
-                                                 textStartXForEffectInit, textStartYForEffectInit,
-                                                 textWrapWidthForEffectInit);
+            dl.speaker = currentSpeakerId;
+            dl.text = (Uint32)lineTexts.size();
+
+            const int lineIndex = (int)(windowFirstLine + dialogLines.size());
+            for (std::string_view label : pendingLabels) {
+                // When streaming, the index has already entered every label of the file
+                auto defined = storyLabels.emplace(std::string(label), lineIndex);
+                if (!defined.second && defined.first->second != lineIndex) {
+                    diagnostics.report(DIAG_LABEL, filename, rawLineNumber, "[LABEL]", "label '" + std::string(label) +
+                                       "' already names line " + std::to_string(defined.first->second) + "; this one is ignored");
+                }
             }
-            if (dl.applyFall || dl.applyFloat) {
-                dl.physicsWords = initPhysicsWords(gRenderer, gDialogFont, dl.dialogText,
-                                                   textStartXForEffectInit, textStartYForEffectInit,
-                                                   textWrapWidthForEffectInit);
+            pendingLabels.clear();
+
+            DialogLineText lineText;
+            if (!parseRichText(token.dialog, plainText, lineRuns, textTimings, markupError)) {
+                diagnostics.report(DIAG_MARKUP, filename, rawLineNumber, "markup", markupError);
+            }
+            lineText.text = storyText.add(plainText);
+            lineText.firstRun = (Uint32)textRuns.size();
+            lineText.runCount = (Uint32)lineRuns.size();
+            textRuns.insert(textRuns.end(), lineRuns.begin(), lineRuns.end());
+            lineText.graphemes = (Uint32)graphemeStarts.size();
+            lineText.graphemeCount = (Uint32)appendGraphemeStarts(plainText, graphemeStarts);
+            lineText.timeline = (Uint32)revealTimes.size();
+            buildRevealTimeline(plainText, graphemeStarts.data() + lineText.graphemes, lineText.graphemeCount,
+                                textTimings, nextLineCharDelayMs, revealTimes);
+            lineTexts.push_back(lineText);
+
+            dl.effects = internEffectSet(nextLineEffects);
+            if (dl.effects == 0 && !(nextLineEffects == effectSets[0])) {
+                diagnostics.report(DIAG_EFFECT_TAG, filename, rawLineNumber, "effects", "too many distinct effect tag combinations; effects dropped");
             }
+            dl.enterCode = appendStoryBlock(storyProgram, pendingEnterCode);
+            pendingEnterCode.clear();
 
             dialogLines.push_back(dl);
 
-            // Reset "next line should" flags and parameters for the *next* iteration
-            nextLineShouldJitter = false;
-            nextLineShouldFall = false;
-            nextLineShouldFloat = false;
-            nextLineShouldPulse = false;
-            nextLinePulseDuration = 1500;
-            nextLinePulseFrequency = 2.0f;
-            nextLinePulseColor1 = {255,255,255,255};
-            nextLinePulseColor2 = {255,100,100,255};
-            nextLineShouldShake = false;
-            nextLineShakeDuration = 0;
-            nextLineShakeIntensity = 0.0f;
-            nextLineShouldTear = false;
-            nextLineTearDuration = 0;
-            nextLineTearMaxOffsetX = 0.0f;
-            nextLineTearLineDensity = 0.0f;
+            // Reset the effect tags for the *next* line
+            nextLineEffects = LineEffectSet();
+            nextLineCharDelayMs = animationDelayMs;
         } else {
-            std::cerr << "Warning: Unrecognized line format on line " << rawLineNumber << " in " << filename << ": " << line << std::endl;
+            // The text after a speaker prefix, as before: the report shows what couldn't be read
+            std::string_view rest = trimmedLine;
+            if (token.hasSpeaker) {
+                rest = rest.substr(token.speaker.size() + 2);
+                const size_t restFirst = rest.find_first_not_of(" \t\r\n");
+                rest = (restFirst == std::string_view::npos) ? std::string_view() : rest.substr(restFirst);
+            }
+            diagnostics.report(DIAG_UNRECOGNIZED, filename, rawLineNumber, "line", "unrecognized line format: " + std::string(rest));
+        }
+    }
+    if (!pendingLabels.empty() && dialogLines.size() < maxLines) {
+        diagnostics.report(DIAG_LABEL, filename, rawLineNumber, "[LABEL]", "label '" + std::string(pendingLabels.front()) + "' has no dialog line after it");
+    }
+
+    // Every label of the file is known now: turn this file's label targets into line numbers, so
+    // taking a jump is an index into the jump table
+    for (const TargetCheck& check : targetChecks) {
+        StoryJumpTarget& target = storyProgram.jumpTargets[check.jumpTarget];
+        if (!target.file.empty()) continue; // Another file: checked when the jump is taken
+        const DiagnosticCategory category = check.fromChoice ? DIAG_CHOICE : DIAG_STATEMENT;
+        const char* tag = check.fromChoice ? "choice" : "[IF]";
+        if (!target.label.empty()) {
+            auto label = storyLabels.find(target.label);
+            if (label != storyLabels.end()) {
+                target.lineIndex = label->second;
+                target.label.clear();
+            } else if (std::filesystem::is_regular_file(target.label)) {
+                target.file = std::move(target.label); // A bare file name without an extension, as before labels
+                target.label.clear();
+                target.lineIndex = 0;
+            } else {
+                diagnostics.report(category, filename, check.rawLineNumber, tag, "unknown label '" + target.label + "'");
+                target.label.clear();
+                target.lineIndex = -1;
+            }
+        } else if (target.lineIndex < 0 || (size_t)target.lineIndex >= lineCount()) {
+            diagnostics.report(category, filename, check.rawLineNumber, tag, "target line " + std::to_string(target.lineIndex) +
+                               " is outside the file (" + std::to_string(lineCount()) + " lines)");
+            target.lineIndex = -1;
         }
     }
+}
+
+// --- Hot Reload ---
+// Whether two lines' style runs draw the same (the shaped text bakes them in)
+static bool sameStyleRuns(const TextStyleRun* a, const TextStyleRun* b, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (a[i].start != b[i].start || a[i].end != b[i].end || a[i].hasColor != b[i].hasColor ||
+            a[i].fontStyle != b[i].fontStyle || a[i].pulse != b[i].pulse ||
+            (a[i].hasColor && (a[i].color.r != b[i].color.r || a[i].color.g != b[i].color.g ||
+                               a[i].color.b != b[i].color.b || a[i].color.a != b[i].color.a))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StoryManager::reloadStory(const std::string& filename) {
+    if (filename != currentStoryFile) return false;
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Warning: Could not reread " << filename << "; keeping the loaded story" << std::endl;
+        return false;
+    }
+    // Read once: the same bytes are compared and then parsed (a streamed file is only indexed)
+    const bool readWhole = !streamingActive;
+    std::string bytes;
+    if (readWhole) {
+        bytes.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read(bytes.data(), (std::streamsize)bytes.size());
+        bytes.resize((size_t)file.gcount());
+        if (bytes == fileBuffer) return true; // Saving without changes (or an editor touching the file) needs no reload at all
+    }
     file.close();
 
-    currentDialogIndex = 0;
-    currentVisibleCharCount = 0;
-    animationIsPlaying = true;
-    awaitingChoice = false;
-    lastCharRevealTime = SDL_GetTicks();
-    prevDialogIndex = 0;
+    // The reader's place by content, so it survives lines being added or removed before it
+    const size_t oldIndex = currentDialogIndex;
+    const bool hadLine = hasCurrentLine();
+    std::string oldSpeaker, oldText;
+    std::vector<TextStyleRun> oldRuns;
+    LineEffectSet oldEffects;
+    if (hadLine) {
+        const DialogLine& line = getCurrentLine();
+        const DialogLineText& lineText = getLineText(line);
+        oldSpeaker = getSpeakerName(line);
+        oldText = getLineString(line);
+        oldRuns.assign(textRuns.begin() + lineText.firstRun, textRuns.begin() + lineText.firstRun + lineText.runCount);
+        oldEffects = getLineEffects(line);
+    }
+    const size_t oldVisibleGraphemes = currentVisibleGraphemes;
+    const bool oldAnimationIsPlaying = animationIsPlaying;
+    const Uint64 oldRevealStartNS = lineRevealStartNS;
+    const bool oldLineEntryPending = lineEntryPending;
+    const bool effectsStarted = prevDialogIndex == oldIndex;
+
+    // Hand the laid out texts to the new load instead of destroying them with the old tables
+    for (Choice& choice : choices) {
+        if (choice.textObject) {
+            reloadChoiceTexts.emplace(std::string(storyText.view(choice.text)), choice.textObject);
+            choice.textObject = nullptr;
+        }
+    }
+    for (size_t i = 0; i < speakerTexts.size(); ++i) {
+        if (speakerTexts[i]) {
+            reloadSpeakerTexts.emplace(std::string(storyText.view(speakerNames[i])), speakerTexts[i]);
+            speakerTexts[i] = nullptr;
+        }
+    }
+    ShapedText oldShapedLine;
+    std::swap(oldShapedLine, shapedLine);
+    const bool hadShapedLine = hadLine && shapedLineIndex == oldIndex;
+    const int oldShapedWrapWidth = shapedWrapWidth;
+    std::vector<RenderedWord> oldWords;
+    std::swap(oldWords, effectStage.words);
+    const bool hadWords = hadLine && wordsLineIndex == oldIndex;
+    const bool oldWordsShown = effectStage.wordsShown;
+
+    const bool loaded = loadStoryFile(filename, readWhole ? &bytes : nullptr);
+    fileLabelCache.clear(); // Labels may have moved
+    historyIndexes.erase(filename); // Its lines too; the backlog keeps the rows it already drew
+
+    // Texts nothing took over belonged to lines that changed or went away
+    for (auto& reloadText : reloadChoiceTexts) TTF_DestroyText(reloadText.second);
+    for (auto& reloadText : reloadSpeakerTexts) TTF_DestroyText(reloadText.second);
+    reloadChoiceTexts.clear();
+    reloadSpeakerTexts.clear();
+
+    size_t newIndex = (loaded && hadLine) ? findReloadedLine(oldIndex, oldSpeaker, oldText) : (size_t)-1;
+    const bool lineKept = newIndex != (size_t)-1;
+    if (!lineKept) {
+        newIndex = std::min(oldIndex, (lineCount() > 0) ? lineCount() - 1 : 0); // The edited line is most likely still here
+    }
+    currentDialogIndex = newIndex;
+    ensureLineLoaded(newIndex);
+    lineEntryPending = oldLineEntryPending; // Statements that already ran don't run again
+    lastFrame.valid = false;                // Choices and names may have moved: redraw it all once
+
+    if (lineKept && hasCurrentLine()) {
+        const DialogLine& line = getCurrentLine();
+        const DialogLineText& lineText = getLineText(line);
+        currentVisibleGraphemes = oldVisibleGraphemes;
+        animationIsPlaying = oldAnimationIsPlaying;
+        lineRevealStartNS = oldRevealStartNS;
+        awaitingChoice = !animationIsPlaying && hasVisibleChoices(line);
+
+        if (hadShapedLine && lineText.runCount == oldRuns.size() &&
+            sameStyleRuns(textRuns.data() + lineText.firstRun, oldRuns.data(), oldRuns.size())) {
+            std::swap(oldShapedLine, shapedLine);
+            shapedLineIndex = newIndex;
+            shapedWrapWidth = oldShapedWrapWidth;
+        }
+        if (effectsStarted && getLineEffects(line) == oldEffects) {
+            prevDialogIndex = newIndex; // The running effects carry on
+            if (hadWords) {
+                std::swap(oldWords, effectStage.words);
+                effectStage.wordsShown = oldWordsShown;
+                wordsLineIndex = newIndex;
+            }
+        } // Otherwise the line's new effects start on the next update
+    } else {
+        currentVisibleGraphemes = 0;
+        animationIsPlaying = true;
+        awaitingChoice = false;
+        lineRevealStartNS = clockNS;
+    }
+    destroyShapedText(oldShapedLine);
+    destroyRenderedWords(oldWords);
+    return loaded;
+}
+
+size_t StoryManager::findReloadedLine(size_t oldIndex, std::string_view speaker, std::string_view text) {
+    if (lineCount() == 0) return (size_t)-1;
+    ensureLineLoaded(std::min(oldIndex, lineCount() - 1));
+
+    // Outward from the old index: an edit above the line usually moves it by a few lines
+    const size_t first = windowFirstLine;
+    const size_t end = windowFirstLine + dialogLines.size();
+    auto matches = [&](size_t index) {
+        if (index < first || index >= end) return false;
+        const DialogLine& line = dialogLines[index - windowFirstLine];
+        return getLineString(line) == text && getSpeakerName(line) == speaker;
+    };
+    const size_t maxDistance = std::max(oldIndex, end) - std::min(oldIndex, first);
+    for (size_t distance = 0; distance <= maxDistance; ++distance) {
+        if (distance <= oldIndex && matches(oldIndex - distance)) return oldIndex - distance;
+        if (distance > 0 && matches(oldIndex + distance)) return oldIndex + distance;
+    }
+    return (size_t)-1;
+}
+
+const std::string& StoryManager::getCurrentStoryFile() const {
+    return currentStoryFile;
+}
+
+// --- Save Snapshots ---
+namespace {
+
+const Uint8 SNAPSHOT_ANIMATION_PLAYING = 1u << 0;
+const Uint8 SNAPSHOT_AWAITING_CHOICE = 1u << 1;
+const Uint8 SNAPSHOT_LINE_ENTRY_PENDING = 1u << 2;
+const Uint8 SNAPSHOT_EFFECTS_STARTED = 1u << 3;   // The line's effects ran (their state follows)
+const Uint8 SNAPSHOT_WORDS_SHOWN = 1u << 4;
+
+// Effect start times are saved as the time since they started, since the story clock starts
+// over with every run. A start before the new clock's zero is pulled up to it.
+Uint64 getElapsedTicks(Uint64 nowTicks, Uint64 startTicks) {
+    return (nowTicks > startTicks) ? nowTicks - startTicks : 0;
+}
+
+Uint64 getStartTicks(Uint64 nowTicks, Uint64 elapsedTicks) {
+    return (nowTicks > elapsedTicks) ? nowTicks - elapsedTicks : 0;
+}
+
+void writeRect(SnapshotWriter& out, const SDL_FRect& rect) {
+    out.f32(rect.x);
+    out.f32(rect.y);
+    out.f32(rect.w);
+    out.f32(rect.h);
+}
+
+SDL_FRect readRect(SnapshotReader& in) {
+    SDL_FRect rect;
+    rect.x = in.f32();
+    rect.y = in.f32();
+    rect.w = in.f32();
+    rect.h = in.f32();
+    return rect;
+}
+
+void writeColor(SnapshotWriter& out, SDL_Color color) {
+    out.u8(color.r);
+    out.u8(color.g);
+    out.u8(color.b);
+    out.u8(color.a);
+}
+
+SDL_Color readColor(SnapshotReader& in) {
+    SDL_Color color;
+    color.r = in.u8();
+    color.g = in.u8();
+    color.b = in.u8();
+    color.a = in.u8();
+    return color;
+}
+
+void writeRng(SnapshotWriter& out, const EffectRng& rng) {
+    for (Uint32 word : rng.s) out.u32(word);
+}
+
+void readRng(SnapshotReader& in, EffectRng& rng) {
+    for (Uint32& word : rng.s) word = in.u32();
+}
+
+void writeScreenEffects(SnapshotWriter& out, const ScreenEffectsContext& screen, Uint64 nowTicks) {
+    out.u8(screen.shakeActive ? 1 : 0);
+    out.u64(getElapsedTicks(nowTicks, screen.shakeStartTime));
+    out.u32(screen.shakeDuration);
+    out.f32(screen.shakeIntensity);
+    out.f32(screen.currentShakeOffset.x);
+    out.f32(screen.currentShakeOffset.y);
+    writeRng(out, screen.shakeRng);
+    out.u8(screen.tearActive ? 1 : 0);
+    out.u64(getElapsedTicks(nowTicks, screen.tearStartTime));
+    out.u32(screen.tearDuration);
+    out.f32(screen.tearMaxOffsetX);
+    out.f32(screen.tearLineDensity);
+    out.f32(screen.currentTearLineY);
+    out.f32(screen.currentTearOffsetX);
+    writeRng(out, screen.tearRng);
+}
+
+void readScreenEffects(SnapshotReader& in, ScreenEffectsContext& screen, Uint64 nowTicks) {
+    screen.shakeActive = in.u8() != 0;
+    screen.shakeStartTime = getStartTicks(nowTicks, in.u64());
+    screen.shakeDuration = in.u32();
+    screen.shakeIntensity = in.f32();
+    screen.currentShakeOffset.x = in.f32();
+    screen.currentShakeOffset.y = in.f32();
+    readRng(in, screen.shakeRng);
+    screen.tearActive = in.u8() != 0;
+    screen.tearStartTime = getStartTicks(nowTicks, in.u64());
+    screen.tearDuration = in.u32();
+    screen.tearMaxOffsetX = in.f32();
+    screen.tearLineDensity = in.f32();
+    screen.currentTearLineY = in.f32();
+    screen.currentTearOffsetX = in.f32();
+    readRng(in, screen.tearRng);
+}
+
+void writeTextEffects(SnapshotWriter& out, const TextEffectsContext& pulse, Uint64 nowTicks) {
+    out.u8(pulse.pulseActive ? 1 : 0);
+    out.u64(getElapsedTicks(nowTicks, pulse.pulseStartTime));
+    out.u64(pulse.pulseDuration);
+    out.f32(pulse.pulseFrequencyHz);
+    writeColor(out, pulse.pulseColorStart);
+    writeColor(out, pulse.pulseColorEnd);
+}
+
+void readTextEffects(SnapshotReader& in, TextEffectsContext& pulse, Uint64 nowTicks) {
+    pulse.pulseActive = in.u8() != 0;
+    pulse.pulseStartTime = getStartTicks(nowTicks, in.u64());
+    pulse.pulseDuration = in.u64();
+    pulse.pulseFrequencyHz = in.f32();
+    pulse.pulseColorStart = readColor(in);
+    pulse.pulseColorEnd = readColor(in);
+}
+
+} // namespace
+
+void StoryManager::saveSnapshot(std::vector<Uint8>& bytes) const {
+    SnapshotWriter out(bytes);
+    writeSnapshotHeader(out);
+    const Uint64 nowTicks = SDL_NS_TO_MS(clockNS);
+    const bool effectsStarted = prevDialogIndex == currentDialogIndex;
+
+    // Where the reader is
+    out.str(currentStoryFile);
+    out.u64(currentDialogIndex);
+    out.u32((Uint32)currentVisibleGraphemes);
+    out.u64((clockNS > lineRevealStartNS) ? clockNS - lineRevealStartNS : 0);
+    out.u8((animationIsPlaying ? SNAPSHOT_ANIMATION_PLAYING : 0) | (awaitingChoice ? SNAPSHOT_AWAITING_CHOICE : 0) |
+           (lineEntryPending ? SNAPSHOT_LINE_ENTRY_PENDING : 0) | (effectsStarted ? SNAPSHOT_EFFECTS_STARTED : 0) |
+           (effectStage.wordsShown ? SNAPSHOT_WORDS_SHOWN : 0));
+
+    // Progress carried across files: variables by name (slots depend on the order files were
+    // loaded in) and every [VOICE] seen so far
+    out.u32((Uint32)storyVariables.names.size());
+    for (size_t i = 0; i < storyVariables.names.size(); ++i) {
+        out.str(storyVariables.names[i]);
+        out.i32(storyVariables.values[i]);
+    }
+    out.u32((Uint32)speakerVoices.size());
+    for (const auto& voice : speakerVoices) {
+        out.str(voice.first);
+        out.f32(voice.second.pitchHz);
+        out.f32(voice.second.lengthMs);
+        out.f32(voice.second.volume);
+    }
+
+    // The running effects, by tag name so registering another type doesn't break old saves
+    const size_t effectCount = effectsStarted ? effectStage.active.size() : 0;
+    out.u32((Uint32)effectCount);
+    for (size_t i = 0; i < effectCount; ++i) {
+        const EffectInstance& effect = effectStage.active[i];
+        out.str(getEffectType(effect.type).tag);
+        for (float param : effect.params) out.f32(param);
+        out.u64(getElapsedTicks(nowTicks, effect.startTicks));
+        out.u64(effect.seed);
+        writeRng(out, effect.rng);
+        out.i32(effect.phase);
+    }
+    writeScreenEffects(out, effectStage.screen, nowTicks);
+    writeTextEffects(out, effectStage.linePulse, nowTicks);
+    writeTextEffects(out, effectStage.spanPulse, nowTicks);
+
+    // Word physics, only meaningful for the window size it was laid out at
+    const bool hasWords = effectsStarted && wordsLineIndex == currentDialogIndex;
+    out.u32((Uint32)winWidth);
+    out.u32((Uint32)winHeight);
+    out.u32(hasWords ? (Uint32)effectStage.words.size() : 0);
+    if (!hasWords) return;
+    for (const RenderedWord& word : effectStage.words) {
+        writeRect(out, word.rect);
+        writeRect(out, word.prevRect);
+        out.f32(word.offset.x);
+        out.f32(word.offset.y);
+        out.f32(word.vx);
+        out.f32(word.vy);
+        out.f32(word.ax);
+        out.f32(word.ay);
+        out.u8(word.active ? 1 : 0);
+    }
+}
+
+bool StoryManager::loadSnapshot(const Uint8* data, size_t size) {
+    // Everything is read and checked before the story is touched
+    SnapshotReader in(data, size);
+    if (!readSnapshotHeader(in)) {
+        std::cerr << "Warning: Not a save snapshot of this version; ignoring it" << std::endl;
+        return false;
+    }
+    const Uint64 nowTicks = SDL_NS_TO_MS(clockNS);
+
+    const std::string file = in.str();
+    const Uint64 lineIndex = in.u64();
+    const Uint32 visibleGraphemes = in.u32();
+    const Uint64 revealElapsedNS = in.u64();
+    const Uint8 flags = in.u8();
+
+    std::vector<std::pair<std::string, Sint32>> variables(in.count(8));
+    for (auto& variable : variables) {
+        variable.first = in.str();
+        variable.second = in.i32();
+    }
+    std::vector<std::pair<std::string, VoiceParams>> voices(in.count(16));
+    for (auto& voice : voices) {
+        voice.first = in.str();
+        voice.second.pitchHz = in.f32();
+        voice.second.lengthMs = in.f32();
+        voice.second.volume = in.f32();
+    }
+
+    std::vector<EffectInstance> effects;
+    const Uint32 effectCount = in.count(4 + 4 * EFFECT_MAX_PARAMS + 36);
+    for (Uint32 i = 0; i < effectCount; ++i) {
+        const std::string tag = in.str();
+        EffectInstance effect;
+        for (float& param : effect.params) param = in.f32();
+        effect.startTicks = getStartTicks(nowTicks, in.u64());
+        effect.seed = in.u64();
+        readRng(in, effect.rng);
+        effect.phase = in.i32();
+        const int type = findEffectType(tag);
+        if (type < 0) {
+            std::cerr << "Warning: Saved effect [" << tag << "] isn't registered; dropping it" << std::endl;
+            continue;
+        }
+        effect.type = (Uint16)type;
+        effects.push_back(effect);
+    }
+    ScreenEffectsContext screen;
+    TextEffectsContext linePulse, spanPulse;
+    readScreenEffects(in, screen, nowTicks);
+    readTextEffects(in, linePulse, nowTicks);
+    readTextEffects(in, spanPulse, nowTicks);
+
+    const int savedWidth = (int)in.u32();
+    const int savedHeight = (int)in.u32();
+    std::vector<RenderedWord> words(in.count(57));
+    for (RenderedWord& word : words) {
+        word.rect = readRect(in);
+        word.prevRect = readRect(in);
+        word.offset.x = in.f32();
+        word.offset.y = in.f32();
+        word.vx = in.f32();
+        word.vy = in.f32();
+        word.ax = in.f32();
+        word.ay = in.f32();
+        word.active = in.u8() != 0;
+    }
+
+    if (!in.ok() || !in.atEnd()) {
+        std::cerr << "Warning: Save snapshot is truncated or corrupt; ignoring it" << std::endl;
+        return false;
+    }
+    if (file != currentStoryFile && !std::filesystem::is_regular_file(file)) {
+        std::cerr << "Warning: Saved story file " << file << " is gone; ignoring the save" << std::endl;
+        return false;
+    }
+
+    // Where the reader was
+    deactivateActiveEffects();
+    if (file != currentStoryFile && !loadStory(file)) return false;
+    storyVariables.resetValues(); // Variables the save doesn't name didn't exist yet: back to 0
+    for (const auto& variable : variables) {
+        Uint16 slot;
+        if (storyVariables.intern(variable.first, slot)) {
+            storyVariables.values[slot] = variable.second;
+        }
+    }
+    for (const auto& voice : voices) {
+        speakerVoices[voice.first] = voice.second;
+    }
+
+    const bool lineKept = lineIndex < lineCount();
+    currentDialogIndex = lineKept ? (size_t)lineIndex : ((lineCount() > 0) ? lineCount() - 1 : 0);
+    ensureLineLoaded(currentDialogIndex);
+    destroyRenderedWords(effectStage.words); // Laid out again for the restored line below
+    wordsLineIndex = (size_t)-1;
+    lastFrame.valid = false;
+    if (!lineKept || !hasCurrentLine()) {
+        currentVisibleGraphemes = 0;
+        animationIsPlaying = true;
+        awaitingChoice = false;
+        lineRevealStartNS = clockNS;
+        prevDialogIndex = (size_t)-1;
+        lineEntryPending = true;
+        return true;
+    }
+
+    const DialogLineText& lineText = getLineText(getCurrentLine());
+    currentVisibleGraphemes = std::min<size_t>(visibleGraphemes, lineText.graphemeCount);
+    animationIsPlaying = (flags & SNAPSHOT_ANIMATION_PLAYING) != 0;
+    awaitingChoice = (flags & SNAPSHOT_AWAITING_CHOICE) != 0;
+    lineEntryPending = (flags & SNAPSHOT_LINE_ENTRY_PENDING) != 0;
+    lineRevealStartNS = (clockNS > revealElapsedNS) ? clockNS - revealElapsedNS : 0;
+    if (!(flags & SNAPSHOT_EFFECTS_STARTED)) {
+        prevDialogIndex = (size_t)-1; // The line's effects start on the next update
+        return true;
+    }
+
+    // The running effects carry on from their saved state
+    prevDialogIndex = currentDialogIndex;
+    effectStage.active = effects;
+    effectStage.screen = screen;
+    effectStage.linePulse = linePulse;
+    effectStage.spanPulse = spanPulse;
+    ensureLineWords();
+    effectStage.wordsShown = (flags & SNAPSHOT_WORDS_SHOWN) != 0;
+    if (savedWidth == winWidth && savedHeight == winHeight && words.size() == effectStage.words.size()) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            RenderedWord& word = effectStage.words[i];
+            word.rect = words[i].rect;
+            word.prevRect = words[i].prevRect;
+            word.offset = words[i].offset;
+            word.vx = words[i].vx;
+            word.vy = words[i].vy;
+            word.ax = words[i].ax;
+            word.ay = words[i].ay;
+            word.active = words[i].active;
+        }
+    }
+    return true;
+}
+
+// --- Streaming Window ---
+void StoryManager::loadStreamWindow(size_t lineIndex) {
+    // The window starts one index block before the line's block, so there's always at least a
+    // block of lines on either side of the current one (except at the start of the file).
+    const size_t block = lineIndex / STORY_INDEX_STRIDE;
+    const size_t firstBlock = (block > 0) ? block - 1 : 0;
+    if (firstBlock >= streamIndex.checkpoints.size()) return;
+
+    clearAllStoryResources();
+    windowFirstLine = firstBlock * STORY_INDEX_STRIDE;
+
+    std::ifstream file(currentStoryFile, std::ios::binary);
+    if (!file.is_open()) {
+        diagnostics.reportRuntime(DIAG_FILE, currentStoryFile, 0, "file", "failed to reopen streamed story file");
+        return;
+    }
+    // Read just the window's bytes: from its checkpoint to the next window's (or the end of the file)
+    const StoryCheckpoint& checkpoint = streamIndex.checkpoints[firstBlock];
+    const size_t endBlock = firstBlock + STREAM_WINDOW_BLOCKS;
+    Uint64 endOffset;
+    if (endBlock < streamIndex.checkpoints.size()) {
+        endOffset = streamIndex.checkpoints[endBlock].offset;
+    } else {
+        file.seekg(0, std::ios::end);
+        endOffset = (Uint64)file.tellg();
+    }
+    fileBuffer.resize((size_t)(endOffset - checkpoint.offset));
+    file.seekg((std::streamoff)checkpoint.offset);
+    file.read(fileBuffer.data(), (std::streamsize)fileBuffer.size());
+    fileBuffer.resize((size_t)file.gcount());
+    storyText.reserve(fileBuffer.size());
+
+    // Report diagnostics only for windows reaching into lines not parsed before, so stepping back
+    // and forth across a block boundary doesn't repeat them.
+    const size_t windowEnd = windowFirstLine + STREAM_WINDOW_BLOCKS * STORY_INDEX_STRIDE;
+    diagnostics.setMuted(windowEnd <= streamWarnedLines);
+    parseStoryLines(fileBuffer, currentStoryFile, checkpoint.rawLineNumber, checkpoint.speaker,
+                    STREAM_WINDOW_BLOCKS * STORY_INDEX_STRIDE);
+    diagnostics.setMuted(false);
+    streamWarnedLines = std::max(streamWarnedLines, windowEnd);
+}
+
+void StoryManager::ensureLineLoaded(size_t lineIndex) {
+    if (!streamingActive) return;
+    const size_t block = lineIndex / STORY_INDEX_STRIDE;
+    const size_t wantedFirstLine = ((block > 0) ? block - 1 : 0) * STORY_INDEX_STRIDE;
+    if (wantedFirstLine != windowFirstLine || dialogLines.empty()) {
+        loadStreamWindow(lineIndex);
+    }
+}
+
+size_t StoryManager::lineCount() const {
+    return streamingActive ? streamIndex.lineCount : dialogLines.size();
+}
+
+bool StoryManager::hasCurrentLine() const {
+    return currentDialogIndex >= windowFirstLine && currentDialogIndex - windowFirstLine < dialogLines.size();
+}
+
+DialogLine& StoryManager::getCurrentLine() {
+    return dialogLines[currentDialogIndex - windowFirstLine];
+}
 
+const LineEffectSet& StoryManager::getLineEffects(const DialogLine& line) const {
+    return effectSets[line.effects];
+}
+
+const DialogLineText& StoryManager::getLineText(const DialogLine& line) const {
+    return lineTexts[line.text];
+}
+
+std::string_view StoryManager::getLineString(const DialogLine& line) const {
+    return storyText.view(lineTexts[line.text].text);
+}
+
+size_t StoryManager::getVisibleTextBytes() const {
+    if (!hasCurrentLine()) return 0;
+    const DialogLineText& lineText = getLineText(dialogLines[currentDialogIndex - windowFirstLine]);
+    return graphemeStarts[lineText.graphemes + std::min<size_t>(currentVisibleGraphemes, lineText.graphemeCount)];
+}
+
+std::string_view StoryManager::getSpeakerName(const DialogLine& line) const {
+    return storyText.view(speakerNames[line.speaker]);
+}
+
+// --- Line Tables ---
+bool LineEffectSet::operator==(const LineEffectSet& o) const {
+    return effects == o.effects;
+}
+
+// FNV-1a over each spec's type and parameters
+static Uint64 hashLineEffectSet(const LineEffectSet& e) {
+    Uint64 h = 0xcbf29ce484222325ull;
+    auto mix = [&h](const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i) { h ^= bytes[i]; h *= 0x100000001b3ull; }
+    };
+    for (const EffectSpec& spec : e.effects) {
+        mix(&spec.type, sizeof(spec.type));
+        mix(spec.params, sizeof(spec.params));
+    }
+    return h;
+}
+
+Uint16 StoryManager::internEffectSet(const LineEffectSet& effects) {
+    if (effects == effectSets[0]) return 0;
+    const Uint64 hash = hashLineEffectSet(effects);
+    auto it = effectSetLookup.find(hash);
+    if (it != effectSetLookup.end() && effectSets[it->second] == effects) {
+        return it->second;
+    }
+    if (effectSets.size() > 0xFFFF) {
+        return 0; // Table full; the caller reports it
+    }
+    effectSets.push_back(effects);
+    if (it == effectSetLookup.end()) {
+        effectSetLookup[hash] = (Uint16)(effectSets.size() - 1); // A colliding set is stored, just not shared
+    }
+    return (Uint16)(effectSets.size() - 1);
+}
+
+Uint32 StoryManager::internSpeaker(std::string_view name) {
+    // Scripts have few speakers and only switch between them at speaker tags, so a scan is enough
+    for (Uint32 i = 0; i < (Uint32)speakerNames.size(); ++i) {
+        if (storyText.view(speakerNames[i]) == name) return i;
+    }
+    speakerNames.push_back(storyText.add(name));
+    // The name box text is laid out once here and drawn from the glyph atlas on every frame
+    TTF_Text* speakerText = nullptr;
+    if (gTextEngine && !name.empty()) {
+        speakerText = takeReloadText(reloadSpeakerTexts, name);
+        if (!speakerText) {
+            speakerText = TTF_CreateText(gTextEngine, gNameFont, storyText.c_str(speakerNames.back()), name.size());
+        }
+    }
+    speakerTexts.push_back(speakerText);
+    return (Uint32)(speakerNames.size() - 1);
+}
+
+bool StoryManager::parseVoiceTag(std::string_view tag) {
+    // [VOICE 'Speaker Name' pitchHz lengthMs volume]
+    size_t closeBracketPos = tag.find(']');
+    size_t nameStart = tag.find('\'');
+    size_t nameEnd = (nameStart == std::string_view::npos) ? std::string_view::npos : tag.find('\'', nameStart + 1);
+    if (closeBracketPos == std::string_view::npos || nameEnd == std::string_view::npos || nameEnd > closeBracketPos) {
+        return false;
+    }
+    std::string_view args = tag.substr(nameEnd + 1, closeBracketPos - nameEnd - 1);
+    VoiceParams voice;
+    if (!parseStoryNumber(args, voice.pitchHz) || !parseStoryNumber(args, voice.lengthMs)) {
+        return false;
+    }
+    float volume;
+    if (parseStoryNumber(args, volume)) voice.volume = volume;
+    speakerVoices[std::string(tag.substr(nameStart + 1, nameEnd - nameStart - 1))] = voice;
     return true;
 }
 
 // --- Update Logic ---
-void StoryManager::update(Uint64 currentTicks, float deltaTime) {
-    if (currentDialogIndex >= dialogLines.size()) {
+void StoryManager::setClock(Uint64 timeNS) {
+    clockNS = timeNS;
+}
+
+void StoryManager::fixedUpdate(Uint64 simTimeNS, float stepSeconds) {
+    clockNS = simTimeNS;
+    const Uint64 currentTicks = SDL_NS_TO_MS(simTimeNS); // Effects keep millisecond durations
+
+    processLineEntry(); // Statements of a newly reached line run before it's shown
+
+    if (!hasCurrentLine()) {
+        updateLineEffects(effectStage, currentTicks, stepSeconds); // Screen effects still play out
         return;
     }
+    skipReadLines(stepSeconds);
+    history.push({historyFile, (Uint32)currentDialogIndex, HISTORY_NO_CHOICE}); // Ignored unless the line is new
+    if (skipActive) {
+        return; // Read lines going by: no typewriter, voice or effects until skipping stops
+    }
 
-    DialogLine& currentLine = dialogLines[currentDialogIndex];
+    const DialogLine& currentLine = getCurrentLine();
+    const DialogLineText& lineText = getLineText(currentLine);
 
     if (currentDialogIndex != prevDialogIndex) {
         deactivateActiveEffects(); // Correctly scoped
         activateLineEffects();     // Correctly scoped
         prevDialogIndex = currentDialogIndex;
     }
+    ensureLineWords();
 
     if (animationIsPlaying && !awaitingChoice) {
-        currentVisibleCharCount = (currentTicks - lastCharRevealTime) / animationDelayMs;
-        currentVisibleCharCount = std::min(currentVisibleCharCount, currentLine.dialogText.length());
+        size_t previousVisibleGraphemes = currentVisibleGraphemes;
+        // The line's pacing was compiled at load, so any point of the reveal is one binary search
+        const Uint64 elapsedNS = (simTimeNS > lineRevealStartNS) ? simTimeNS - lineRevealStartNS : 0;
+        currentVisibleGraphemes = countRevealedGraphemes(revealTimes.data() + lineText.timeline, lineText.graphemeCount, elapsedNS);
+        if (currentVisibleGraphemes > previousVisibleGraphemes) {
+            postVoiceBlips(currentLine, previousVisibleGraphemes, currentVisibleGraphemes);
+        }
 
-        if (currentVisibleCharCount >= currentLine.dialogText.length()) {
+        if (currentVisibleGraphemes >= lineText.graphemeCount) {
             animationIsPlaying = false;
-            if (currentLine.hasChoices) {
+            if (hasVisibleChoices(currentLine)) {
                 awaitingChoice = true;
-            } else if ((currentLine.applyFall || currentLine.applyFloat) && !currentLine.physicsActive) {
-                currentLine.physicsActive = true;
-                if (currentLine.applyFall) {
-                    applyfallEffect(currentLine.physicsWords);
-                } else if (currentLine.applyFloat) {
-                    applyfloatEffect(currentLine.physicsWords);
-                }
             }
         }
     }
 
-    if (currentLine.applyJitter) {
-        applyJitter(currentLine.jitterWords);
+    // Each running effect of the line steps once; word effects take over when the reveal ends
+    effectStage.revealed = !animationIsPlaying;
+    effectStage.choicesShown = awaitingChoice;
+    updateLineEffects(effectStage, currentTicks, stepSeconds);
+}
+
+// --- Voice Blips ---
+void StoryManager::setVoiceBlipPlayer(VoiceBlipPlayer* player) {
+    voicePlayer = player;
+}
+
+void StoryManager::postVoiceBlips(const DialogLine& line, size_t firstGrapheme, size_t endGrapheme) {
+    if (!voicePlayer || !voicePlayer->isOpen()) return;
+    auto voiceIt = speakerVoices.find(getSpeakerName(line)); // Transparent lookup: no string built
+    if (voiceIt == speakerVoices.end()) return; // Speakers without a [VOICE] stay silent
+
+    const VoiceParams& voice = voiceIt->second;
+    const DialogLineText& lineText = getLineText(line);
+    const std::string_view text = getLineString(line);
+    const Uint32* starts = graphemeStarts.data() + lineText.graphemes;
+    const Uint32* timeline = revealTimes.data() + lineText.timeline;
+    for (size_t g = firstGrapheme; g < endGrapheme && g < lineText.graphemeCount; ++g) {
+        unsigned char c = (unsigned char)text[starts[g]];
+        if (c == ' ' || c == '\t') {
+            continue; // No blip for spaces
+        }
+        if (g > 0 && timeline[g] == timeline[g - 1]) {
+            continue; // Appeared together with the previous character ({instant} or no delay)
+        }
+        BlipEvent event;
+        // The exact time cluster g became visible, even if this frame revealed several at once
+        event.revealTimeMs = (double)(lineRevealStartNS + getGraphemeRevealOffsetNS(timeline, lineText.graphemeCount, g)) / SDL_NS_PER_MS;
+        event.pitchHz = voice.pitchHz * (1.0f + ((int)(c % 5) - 2) * 0.03f); // Slight per-letter variation
+        event.lengthMs = voice.lengthMs;
+        event.volume = voice.volume;
+        voicePlayer->post(event); // Never blocks; a full queue just drops the blip
+    }
+}
+
+// --- History ---
+const StoryHistory& StoryManager::getHistory() const {
+    return history;
+}
+
+bool StoryManager::getHistoryText(const HistoryEntry& entry, std::string& speaker, std::string& text) {
+    const std::string& file = history.getFileName(entry.file);
+    if (entry.file == historyFile && entry.line >= windowFirstLine && entry.line - windowFirstLine < dialogLines.size()) {
+        const DialogLine& line = dialogLines[entry.line - windowFirstLine];
+        speaker = getSpeakerName(line);
+        if (entry.choice == HISTORY_NO_CHOICE) {
+            text = getLineString(line);
+            return true;
+        }
+        if (entry.choice >= line.choiceCount) return false;
+        text = storyText.view(choices[line.firstChoice + entry.choice].text);
+        return true;
     }
-    if ((currentLine.applyFall || currentLine.applyFloat) && currentLine.physicsActive) {
-        updatePhysicsWords(currentLine.physicsWords, deltaTime);
-        bool allWordsInactive = true;
-        for(const auto& word : currentLine.physicsWords) {
-            if(word.active) {
-                allWordsInactive = false;
-                break;
+
+    // Another file, or a streamed line outside the window
+    const StoryLineIndex* index = nullptr;
+    if (entry.file == historyFile && streamingActive) {
+        index = &streamIndex;
+    } else {
+        auto it = historyIndexes.find(file);
+        if (it == historyIndexes.end()) {
+            it = historyIndexes.emplace(file, StoryLineIndex()).first;
+            if (!buildStoryLineIndex(file, it->second)) {
+                std::cerr << "Warning: Could not read " << file << " for the backlog" << std::endl;
             }
         }
-        if(allWordsInactive) {
-            currentLine.physicsActive = false;
+        index = &it->second;
+    }
+    return readHistoryEntryText(file, *index, entry, speaker, text);
+}
+
+// --- Read Lines & Skip Mode ---
+bool StoryManager::loadReadLines(const std::string& path) {
+    const bool loaded = readTracker.load(path);
+    readLines = currentStoryFile.empty() ? nullptr : &readTracker.getFile(currentStoryFile); // The old sets are gone
+    return loaded;
+}
+
+bool StoryManager::saveReadLines(const std::string& path) const {
+    return readTracker.save(path);
+}
+
+void StoryManager::setSkipHeld(bool held) {
+    skipHeld = held;
+}
+
+bool StoryManager::isSkipping() const {
+    return skipActive;
+}
+
+void StoryManager::markLineRead() {
+    if (readLines && hasCurrentLine()) {
+        readLines->markRead(currentDialogIndex);
+    }
+}
+
+void StoryManager::skipReadLines(float stepSeconds) {
+    if (!skipHeld) {
+        stopSkipping();
+        return;
+    }
+
+    // Only what advancing needs: the line's statements run and the streaming window follows,
+    // but nothing is revealed, laid out or started
+    skipBudget += stepSeconds * SKIP_LINES_PER_SECOND;
+    bool stopped = false;
+    while (skipBudget >= 1.0f) {
+        if (!hasCurrentLine() || awaitingChoice || !readLines || !readLines->isRead(currentDialogIndex) ||
+            currentDialogIndex + 1 >= lineCount()) {
+            stopped = true; // Unread, waiting on a choice, or the last line (skipping doesn't loop the story)
+            break;
+        }
+        const DialogLine& line = getCurrentLine();
+        if (hasVisibleChoices(line)) {
+            currentVisibleGraphemes = getLineText(line).graphemeCount; // The choices are the player's to make
+            animationIsPlaying = false;
+            awaitingChoice = true;
+            stopped = true;
+            break;
         }
+        advanceStoryLine();
+        processLineEntry();
+        history.push({historyFile, (Uint32)currentDialogIndex, HISTORY_NO_CHOICE});
+        skipBudget -= 1.0f;
+        skipActive = true;
     }
+
+    if (stopped) {
+        stopSkipping();
+    } else if (skipActive) {
+        prevDialogIndex = currentDialogIndex; // No effects for lines going by
+    }
+}
+
+void StoryManager::stopSkipping() {
+    skipBudget = 0.0f; // Time spent stopped doesn't bank lines
+    if (!skipActive) return;
+    skipActive = false;
+    prevDialogIndex = (size_t)-1; // The line's effects start on this update
+    lastFrame.valid = false;
+}
+
+void StoryManager::renderSkipPreview(Uint64 renderTimeNS) {
+    // Lines go by faster than they could be read: lay out and shape one only every
+    // SKIP_PREVIEW_INTERVAL_NS, and draw that one fully revealed until then
+    const SDL_FRect dialogBoxRect = {winWidth * 0.1f, winHeight * 0.55f, winWidth * 0.8f, winHeight * 0.25f};
+    if (shapedLineIndex == (size_t)-1 || renderTimeNS - skipPreviewNS >= SKIP_PREVIEW_INTERVAL_NS) {
+        const DialogLine& currentLine = getCurrentLine();
+        ensureShapedLine(currentLine, (int)(dialogBoxRect.w - (2 * textPadding)));
+        computeRunColors(currentLine, SDL_NS_TO_MS(renderTimeNS), textColorWhite);
+        skipPreviewBytes = getLineText(currentLine).text.length;
+        skipPreviewSpeaker = currentLine.speaker;
+        skipPreviewNS = renderTimeNS;
+    }
+
+    drawDialogBoxUI(gRenderer, dialogBoxRect.x, dialogBoxRect.y, dialogBoxRect.w, dialogBoxRect.h, dialogBoxBgColor, borderColor);
+    if (skipPreviewSpeaker < speakerTexts.size()) {
+        renderNameBox(gRenderer, speakerTexts[skipPreviewSpeaker], dialogBoxRect.x, dialogBoxRect.y - 40, 150.0f, 30.0f,
+                      nameBoxBgColor, nameBoxBgColor, textColorWhite);
+    }
+    renderShapedText(gRenderer, shapedLine, runColors, skipPreviewBytes,
+                     (float)(int)(dialogBoxRect.x + textPadding), (float)(int)(dialogBoxRect.y + textPadding));
+    lastFrame.valid = false; // The first frame after skipping is drawn whole
+}
+
+// --- Batch Rendering Support ---
+const StoryDiagnostics& StoryManager::getDiagnostics() const {
+    return diagnostics;
+}
+
+void StoryManager::setDiagnosticsSilenced(bool silenced) {
+    diagnostics.setSilenced(silenced);
+}
+
+size_t StoryManager::getDialogLineCount() const {
+    return lineCount();
+}
+
+void StoryManager::showLineFullyRevealed(size_t index) {
+    if (index >= lineCount()) return;
+
+    // Jump straight to the end state of the line without triggering its one-shot effects,
+    // so the captured frame is the static, fully revealed line (plus its choice panel).
+    deactivateActiveEffects();
+    currentDialogIndex = index;
+    prevDialogIndex = index;
+    ensureLineLoaded(index);
+    if (!hasCurrentLine()) return;
+    currentVisibleGraphemes = getLineText(getCurrentLine()).graphemeCount;
+    animationIsPlaying = false;
+    awaitingChoice = hasVisibleChoices(getCurrentLine());
 }
 
 // --- Input Handling ---
 void StoryManager::handleInput(const SDL_Event& event) {
-    if (currentDialogIndex >= dialogLines.size()) {
+    if ((event.type == SDL_EVENT_KEY_DOWN || event.type == SDL_EVENT_KEY_UP) && event.key.key == SDLK_TAB) {
+        setSkipHeld(event.type == SDL_EVENT_KEY_DOWN); // Skips on the next fixed step
+        return;
+    }
+    if (!hasCurrentLine()) {
         return;
     }
 
@@ -404,26 +1331,14 @@ void StoryManager::handleInput(const SDL_Event& event) {
             if (awaitingChoice) {
                 // Do nothing, awaiting mouse click for choice
             } else if (animationIsPlaying) {
-                currentVisibleCharCount = dialogLines[currentDialogIndex].dialogText.length();
+                const DialogLine& currentLine = getCurrentLine();
+                currentVisibleGraphemes = getLineText(currentLine).graphemeCount;
                 animationIsPlaying = false;
-                DialogLine& currentLine = dialogLines[currentDialogIndex];
-                if (currentLine.hasChoices) {
+                if (hasVisibleChoices(currentLine)) {
                     awaitingChoice = true;
-                } else if (currentLine.applyFall || currentLine.applyFloat) {
-                    currentLine.physicsActive = true;
-                    if (currentLine.applyFall) {
-                        applyfallEffect(currentLine.physicsWords);
-                    } else if (currentLine.applyFloat) {
-                        applyfloatEffect(currentLine.physicsWords);
-                    }
                 }
-                activateLineEffects(); // Correctly scoped
+                activateLineEffects(); // Correctly scoped; word effects see the reveal on the next step
             } else {
-                DialogLine& currentLine = dialogLines[currentDialogIndex];
-                if ((currentLine.applyFall || currentLine.applyFloat) && currentLine.physicsActive) {
-                    currentLine.physicsActive = false;
-                    currentLine.physicsWords.clear();
-                }
                 advanceStoryLine(); // Correctly scoped
             }
         }
@@ -433,21 +1348,33 @@ void StoryManager::handleInput(const SDL_Event& event) {
             handleChoiceClick({(float)event.button.x, (float)event.button.y}); // Correctly scoped
         }
     }
+
+    processLineEntry(); // Apply a new line's statements before anything renders it
 }
 
 // --- Rendering ---
-void StoryManager::render(Uint64 currentTicks) {
-    if (currentDialogIndex >= dialogLines.size()) {
+void StoryManager::render(Uint64 renderTimeNS, float interpolationAlpha) {
+    const Uint64 currentTicks = SDL_NS_TO_MS(renderTimeNS);
+
+    if (!hasCurrentLine()) {
+        return;
+    }
+
+    if (skipActive) {
+        renderSkipPreview(renderTimeNS);
         return;
     }
 
-    DialogLine& currentLine = dialogLines[currentDialogIndex];
+    const DialogLine& currentLine = getCurrentLine();
+    ensureLineWords(); // A jump or resize may have skipped the line-change activation
 
-    SDL_FPoint shakeOffset = getScreenShakeOffset();
+    // What the line's running effects (shake, tear, pulse, ...) do to this frame
+    const EffectFrame frame = getEffectFrame(effectStage, currentTicks, textColorWhite);
+    SDL_FPoint shakeOffset = frame.offset;
 
     float dialogBoxBaseX = (float)(winWidth * 0.1f + shakeOffset.x);
     float dialogBoxBaseY = (float)(winHeight * 0.55f + shakeOffset.y);
-    float dialogBoxTearOffsetX = getScreenTearXOffset(dialogBoxBaseY);
+    float dialogBoxTearOffsetX = getFrameXOffset(frame, dialogBoxBaseY);
     SDL_FRect dialogBoxRect = {
         dialogBoxBaseX + dialogBoxTearOffsetX,
         dialogBoxBaseY,
@@ -456,7 +1383,7 @@ void StoryManager::render(Uint64 currentTicks) {
 
     float nameBoxBaseX = (float)(dialogBoxRect.x);
     float nameBoxBaseY = (float)(dialogBoxRect.y - 40);
-    float nameBoxTearOffsetX = getScreenTearXOffset(nameBoxBaseY);
+    float nameBoxTearOffsetX = getFrameXOffset(frame, nameBoxBaseY);
     SDL_FRect nameBoxRect = {
         nameBoxBaseX + nameBoxTearOffsetX,
         nameBoxBaseY + shakeOffset.y,
@@ -465,39 +1392,53 @@ void StoryManager::render(Uint64 currentTicks) {
 
     drawDialogBoxUI(gRenderer, dialogBoxRect.x, dialogBoxRect.y, dialogBoxRect.w, dialogBoxRect.h, dialogBoxBgColor, borderColor);
 
-    renderNameBox(gRenderer, gNameFont, gTextEngine, currentLine.speakerName
+    renderNameBox(gRenderer, speakerTexts[currentLine.speaker]
         , nameBoxRect.x, nameBoxRect.y, nameBoxRect.w, nameBoxRect.h
         , nameBoxBgColor, nameBoxBgColor, textColorWhite);
 
-    SDL_Color currentTextColor = isTextColorPulseActive() ? getPulsingTextColor(currentTicks) : textColorWhite;
+    SDL_Color currentTextColor = frame.textColor;
 
     float textRenderBaseX = (float)(dialogBoxRect.x + textPadding);
     float textRenderBaseY = (float)(dialogBoxRect.y + textPadding);
 
-    if (currentLine.applyJitter && !animationIsPlaying && !(currentLine.applyFall || currentLine.applyFloat)) {
-        for (const auto& word : currentLine.jitterWords) {
-            renderText(gRenderer, gDialogFont, word.text, currentTextColor,
-                       (int)(word.rect.x + shakeOffset.x + getScreenTearXOffset(word.rect.y + shakeOffset.y)),
-                       (int)(word.rect.y + shakeOffset.y), 0);
-        }
-    } else if ((currentLine.applyFall || currentLine.applyFloat) && currentLine.physicsActive) {
-        for (const auto& word : currentLine.physicsWords) {
-            if (word.active) {
-                renderText(gRenderer, gDialogFont, word.text, currentTextColor,
-                           (int)(word.rect.x + shakeOffset.x + getScreenTearXOffset(word.rect.y + shakeOffset.y)),
-                           (int)(word.rect.y + shakeOffset.y), 0);
-            }
+    const TextDrawMode textMode = getTextDrawMode();
+    lastFrame.wordRects.clear();
+    if (textMode == TEXT_DRAW_WORDS) {
+        for (const auto& word : effectStage.words) {
+            // Interpolate between the last two physics steps so motion is smooth at any refresh rate (plus jitter)
+            SDL_FRect wordRect = getInterpolatedWordRect(word, interpolationAlpha);
+            drawWord(word, wordRect, currentTextColor, frame);
+            lastFrame.wordRects.push_back(wordRect);
         }
     } else {
-        std::string textToDisplay = currentLine.dialogText.substr(0, currentVisibleCharCount);
-        float currentTextTearOffsetX = getScreenTearXOffset(textRenderBaseY);
-        renderText(gRenderer, gDialogFont, textToDisplay, currentTextColor,
-                   (int)(textRenderBaseX + currentTextTearOffsetX),
-                   (int)textRenderBaseY,
-                   (int)(dialogBoxRect.w - (2 * textPadding)));
+        // Shaped once per line; each frame only re-tints the runs and picks how much is revealed
+        ensureShapedLine(currentLine, (int)(dialogBoxRect.w - (2 * textPadding)));
+        computeRunColors(currentLine, currentTicks, currentTextColor);
+        float currentTextTearOffsetX = getFrameXOffset(frame, textRenderBaseY);
+        const float textX = (float)(int)(textRenderBaseX + currentTextTearOffsetX);
+        if (frame.glyphs.isAnimated()) {
+            // Wave / letter shake / rainbow: one quad per glyph, still a single draw call
+            renderAnimatedShapedText(gRenderer, shapedLine, runColors, getVisibleTextBytes(), textX, (float)(int)textRenderBaseY, frame.glyphs);
+        } else {
+            renderShapedText(gRenderer, shapedLine, runColors, getVisibleTextBytes(), textX, (float)(int)textRenderBaseY);
+        }
     }
 
-    if (awaitingChoice && currentLine.hasChoices) {
+    // Remember what this frame shows, for the next collectDirtyRects()
+    lastFrame.valid = true;
+    lastFrame.lineIndex = currentDialogIndex;
+    lastFrame.visibleBytes = getVisibleTextBytes();
+    lastFrame.awaitingChoice = awaitingChoice;
+    lastFrame.effectsMoving = frame.moving;
+    lastFrame.textMode = textMode;
+    lastFrame.textColor = currentTextColor;
+    lastFrame.glyphsAnimated = frame.glyphs.isAnimated();
+    lastFrame.glyphReach = getGlyphAnimationReach(frame.glyphs);
+    lastFrame.runColors = runColors;
+    lastFrame.width = winWidth;
+    lastFrame.height = winHeight;
+
+    if (awaitingChoice && currentLine.choiceCount > 0) {
         const float CHOICES_GAP_ABOVE_DIALOG = 20.0f;
         const float CHOICE_HEIGHT = 40.0f;
         const float HORIZONTAL_CHOICE_SPACING = 30.0f;
@@ -512,8 +1453,9 @@ void StoryManager::render(Uint64 currentTicks) {
             float boxWidth;
         };
         std::vector<ChoiceLayoutInfo> layoutInfos;
-        for (size_t i = 0; i < currentLine.choices.size(); ++i) {
-            layoutInfos.push_back({i, currentLine.choices[i].textWidth, (float)currentLine.choices[i].textWidth + (2 * CHOICE_PADDING_X)});
+        for (size_t i = currentLine.firstChoice; i < currentLine.firstChoice + currentLine.choiceCount; ++i) {
+            if (!isChoiceVisible(choices[i])) continue; // Hidden by its [IF] condition
+            layoutInfos.push_back({i, choices[i].textWidth, (float)choices[i].textWidth + (2 * CHOICE_PADDING_X)});
         }
 
         std::vector<std::vector<size_t>> rowChoiceIndices;
@@ -557,12 +1499,12 @@ void StoryManager::render(Uint64 currentTicks) {
 
             for (size_t layoutInfoIndex : rowChoiceIndices[r]) {
                 const auto& info = layoutInfos[layoutInfoIndex];
-                Choice& choice = currentLine.choices[info.originalIndex];
+                Choice& choice = choices[info.originalIndex];
 
                 float choiceBaseX = currentRenderX + shakeOffset.x;
                 float choiceBaseY = currentRenderY + shakeOffset.y;
 
-                float choiceBoxTearOffsetX = getScreenTearXOffset(choiceBaseY);
+                float choiceBoxTearOffsetX = getFrameXOffset(frame, choiceBaseY);
 
                 SDL_FRect choiceRect = {
                     choiceBaseX + choiceBoxTearOffsetX,
@@ -573,17 +1515,16 @@ void StoryManager::render(Uint64 currentTicks) {
                 choice.rect = choiceRect;
 
                 SDL_SetRenderDrawColor(gRenderer, choiceBgColor.r, choiceBgColor.g, choiceBgColor.b, choiceBgColor.a);
-                SDL_RenderFillRect(gRenderer, &choiceRect);
+                countedRenderFillRect(gRenderer, &choiceRect);
                 SDL_SetRenderDrawColor(gRenderer, choiceBorderColor.r, choiceBorderColor.g, choiceBorderColor.b, choiceBorderColor.a);
-                SDL_RenderRect(gRenderer, &choiceRect);
+                countedRenderRect(gRenderer, &choiceRect);
 
-                if (choice.textTexture) {
+                if (choice.textObject) {
                      float textX = choiceRect.x + (choiceRect.w - choice.textWidth) / 2.0f;
                      float textY = choiceRect.y + (choiceRect.h - choice.textHeight) / 2.0f;
-                     SDL_FRect textDstRect = { textX, textY, (float)choice.textWidth, (float)choice.textHeight };
-                     SDL_RenderTexture(gRenderer, choice.textTexture, NULL, &textDstRect);
+                     countedDrawRendererText(choice.textObject, textX, textY);
                 } else {
-                    renderText(gRenderer, gDialogFont, choice.text, textColorWhite,
+                    renderText(gRenderer, gDialogFont, storyText.view(choice.text), textColorWhite,
                                (int)(choiceRect.x + (choiceRect.w - info.textWidth) / 2),
                                (int)(choiceRect.y + (choiceRect.h - choice.textHeight) / 2),
                                (int)choiceRect.w);
@@ -596,134 +1537,338 @@ void StoryManager::render(Uint64 currentTicks) {
     }
 }
 
+// --- Dirty Rectangles ---
+bool StoryManager::collectDirtyRects(Uint64 renderTimeNS, std::vector<SDL_FRect>& rects, float interpolationAlpha) {
+    if (skipActive) {
+        return true; // The skip preview is drawn whole
+    }
+    if (!hasCurrentLine()) {
+        bool wasShowingLine = lastFrame.valid;
+        lastFrame.valid = false;
+        return wasShowingLine; // Clear the old line once
+    }
+    const DialogLine& currentLine = getCurrentLine();
+
+    // Anything that moves or replaces the whole layout: shake/tear (and the frame after they
+    // stop, to put everything back), a new line, the choice panel appearing, a resize.
+    const Uint64 currentTicks = SDL_NS_TO_MS(renderTimeNS);
+    const EffectFrame frame = getEffectFrame(effectStage, currentTicks, textColorWhite);
+    const TextDrawMode textMode = getTextDrawMode();
+    if (!lastFrame.valid || frame.moving || lastFrame.effectsMoving ||
+        lastFrame.lineIndex != currentDialogIndex || lastFrame.awaitingChoice != awaitingChoice ||
+        lastFrame.width != winWidth || lastFrame.height != winHeight) {
+        return true;
+    }
+
+    // Same layout as render() without shake/tear, which are known to be inactive here
+    const SDL_FRect textArea = {
+        winWidth * 0.1f + textPadding, winHeight * 0.55f + textPadding,
+        winWidth * 0.8f - 2 * textPadding, winHeight * 0.25f - 2 * textPadding
+    };
+
+    SDL_Color textColor = frame.textColor;
+    bool colorChanged = textColor.r != lastFrame.textColor.r || textColor.g != lastFrame.textColor.g ||
+                        textColor.b != lastFrame.textColor.b || textColor.a != lastFrame.textColor.a;
+    if (textMode == TEXT_DRAW_PLAIN) {
+        computeRunColors(currentLine, currentTicks, textColor);
+        colorChanged = colorChanged || runColors.size() != lastFrame.runColors.size();
+        for (size_t i = 0; i < runColors.size() && !colorChanged; ++i) {
+            const SDL_Color& a = runColors[i];
+            const SDL_Color& b = lastFrame.runColors[i];
+            colorChanged = a.r != b.r || a.g != b.g || a.b != b.b || a.a != b.a;
+        }
+    }
+
+    if (textMode != lastFrame.textMode) {
+        // Switching between the plain text and word effects: old words and the text area both change
+        rects.push_back(textArea);
+        rects.insert(rects.end(), lastFrame.wordRects.begin(), lastFrame.wordRects.end());
+    } else if (textMode == TEXT_DRAW_PLAIN) {
+        if (frame.glyphs.isAnimated() || lastFrame.glyphsAnimated) {
+            // Animated glyphs move every frame and may reach past the text area
+            const float reach = std::max(getGlyphAnimationReach(frame.glyphs), lastFrame.glyphReach);
+            rects.push_back({textArea.x - reach, textArea.y - reach, textArea.w + 2 * reach, textArea.h + 2 * reach});
+        } else if (colorChanged) {
+            rects.push_back(textArea);
+        } else if (getVisibleTextBytes() > lastFrame.visibleBytes) {
+            // Only the newly revealed characters, from the shaped layout render() drew with
+            ensureShapedLine(currentLine, (int)textArea.w);
+            SDL_FRect revealed = getShapedTextBounds(shapedLine, lastFrame.visibleBytes, getVisibleTextBytes());
+            if (revealed.w > 0.0f && revealed.h > 0.0f) {
+                rects.push_back({textArea.x + revealed.x, textArea.y + revealed.y, revealed.w, revealed.h});
+            }
+        } else if (getVisibleTextBytes() != lastFrame.visibleBytes) {
+            rects.push_back(textArea);
+        }
+    } else {
+        // Word effects: where each word was drawn last frame and where it goes now
+        rects.insert(rects.end(), lastFrame.wordRects.begin(), lastFrame.wordRects.end());
+        for (const auto& word : effectStage.words) {
+            rects.push_back(getInterpolatedWordRect(word, interpolationAlpha));
+        }
+    }
+    return false;
+}
+
+StoryManager::TextDrawMode StoryManager::getTextDrawMode() const {
+    // Word effects decide when their words replace the typewriter text
+    return (effectStage.wordsShown && !effectStage.words.empty()) ? TEXT_DRAW_WORDS : TEXT_DRAW_PLAIN;
+}
+
+const TextLayout& StoryManager::ensureLineLayout(const DialogLine& line, int wrapWidth) {
+    if (layoutLineIndex != currentDialogIndex || layoutWrapWidth != wrapWidth) {
+        const DialogLineText& lineText = getLineText(line);
+        layoutRichText(gDialogFont, dialogMetrics, getLineString(line), graphemeStarts.data() + lineText.graphemes,
+                       lineText.graphemeCount, textRuns.data() + lineText.firstRun, lineText.runCount, wrapWidth, lineLayout);
+        layoutLineIndex = currentDialogIndex;
+        layoutWrapWidth = wrapWidth;
+    }
+    return lineLayout;
+}
+
+void StoryManager::ensureShapedLine(const DialogLine& line, int wrapWidth) {
+    if (shapedLineIndex == currentDialogIndex && shapedWrapWidth == wrapWidth) {
+        return;
+    }
+    const TextLayout& layout = ensureLineLayout(line, wrapWidth);
+    const DialogLineText& lineText = getLineText(line);
+    shapeRichText(gRenderer, gDialogFont, getLineString(line), graphemeStarts.data() + lineText.graphemes, lineText.graphemeCount,
+                  textRuns.data() + lineText.firstRun, layout, shapedLine);
+    shapedLineIndex = currentDialogIndex;
+    shapedWrapWidth = wrapWidth;
+}
+
+void StoryManager::computeRunColors(const DialogLine& line, Uint64 currentTicks, SDL_Color lineColor) {
+    const DialogLineText& lineText = getLineText(line);
+    const TextStyleRun* runs = textRuns.data() + lineText.firstRun;
+    runColors.resize(lineText.runCount);
+    SDL_Color pulseColor = lineColor;
+    if (isTextColorPulseActive(effectStage.spanPulse)) {
+        pulseColor = getPulsingTextColor(effectStage.spanPulse, currentTicks);
+    }
+    for (size_t i = 0; i < lineText.runCount; ++i) {
+        const TextStyleRun& run = runs[i];
+        runColors[i] = run.pulse ? pulseColor : run.hasColor ? run.color : lineColor;
+    }
+}
+
+void StoryManager::drawWord(const RenderedWord& word, const SDL_FRect& rect, SDL_Color color, const EffectFrame& frame) {
+    if (!word.textObject) return;
+    TTF_SetTextColor(word.textObject, color.r, color.g, color.b, color.a); // Applied at draw time, no re-layout
+    const float x = rect.x + frame.offset.x;
+    const float y = rect.y + frame.offset.y;
+    countedDrawRendererText(word.textObject, (float)(int)(x + getFrameXOffset(frame, y)), (float)(int)y);
+}
+
+SDL_FRect StoryManager::getInterpolatedWordRect(const RenderedWord& word, float interpolationAlpha) {
+    return {
+        word.prevRect.x + (word.rect.x - word.prevRect.x) * interpolationAlpha + word.offset.x,
+        word.prevRect.y + (word.rect.y - word.prevRect.y) * interpolationAlpha + word.offset.y,
+        word.rect.w, word.rect.h
+    };
+}
+
 // --- Private Helper Methods (for internal use by StoryManager) ---
 
 // All these methods now have the correct 'StoryManager::' scope qualification.
 
 void StoryManager::advanceStoryLine() { // Corrected: Added StoryManager::
+    markLineRead();
     deactivateActiveEffects();
 
     currentDialogIndex++;
-    if (currentDialogIndex < dialogLines.size()) {
-        currentVisibleCharCount = 0;
+    lineEntryPending = true;
+    if (currentDialogIndex < lineCount()) {
+        currentVisibleGraphemes = 0;
         animationIsPlaying = true;
         awaitingChoice = false;
-        lastCharRevealTime = SDL_GetTicks();
+        lineRevealStartNS = clockNS;
     } else {
         std::cout << "End of story. Looping to start." << std::endl;
         currentDialogIndex = 0;
-        currentVisibleCharCount = 0;
+        currentVisibleGraphemes = 0;
         animationIsPlaying = true;
         awaitingChoice = false;
-        lastCharRevealTime = SDL_GetTicks();
+        lineRevealStartNS = clockNS;
     }
+    ensureLineLoaded(currentDialogIndex);
 }
 
 void StoryManager::handleWindowResize(int newWidth, int newHeight) { // CORRECTED: Added StoryManager::
-    // Re-render all choice textures as their wrapWidth (winWidth) has changed.
-    for (auto& dialog : dialogLines) {
-        if (dialog.hasChoices) {
-            for (auto& choice : dialog.choices) {
-                if (choice.textTexture) {
-                    SDL_DestroyTexture(choice.textTexture); // Destroy old texture
-                    choice.textTexture = nullptr;
-                }
-                // Re-create texture using the new window width for wrapping
-                TTF_GetStringSize(gDialogFont, choice.text.c_str(), choice.text.length(), &choice.textWidth, &choice.textHeight);
-                SDL_Surface* textSurface = TTF_RenderText_Blended_Wrapped(gDialogFont, choice.text.c_str(), choice.text.length(), textColorWhite, newWidth);
-                if (textSurface) {
-                    choice.textTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
-                    SDL_DestroySurface(textSurface);
-                    if (!choice.textTexture) {
-                         std::cerr << "Failed to re-create texture for choice text after resize: " << SDL_GetError() << std::endl;
-                    }
-                } else {
-                    std::cerr << "Failed to re-create surface for choice text after resize: " << SDL_GetError() << std::endl;
-                }
-            }
-        }
-
-        // Clear and reset word-based effects (jitter, physics) for each dialog line.
-        // This forces them to be re-initialized with new dimensions when that line becomes active.
-        if (dialog.applyJitter) {
-            dialog.jitterWords.clear();
-        }
-        if (dialog.applyFall || dialog.applyFloat) {
-            dialog.physicsWords.clear();
-            dialog.physicsActive = false; // Also reset physics active state
+    destroyShapedText(shapedLine); // Re-wrapped at the new width on the next render
+    shapedLineIndex = (size_t)-1;
+
+    // Re-wrap the choice texts in place, as their wrapWidth (winWidth) has changed
+    for (auto& choice : choices) {
+        if (!choice.textObject) continue;
+        if (!TTF_SetTextWrapWidth(choice.textObject, newWidth)) {
+            std::cerr << "Failed to re-wrap choice text after resize: " << SDL_GetError() << std::endl;
         }
+        TTF_GetTextSize(choice.textObject, &choice.textWidth, &choice.textHeight);
     }
+
+    // Effect words are laid out again for the new dimensions on the next update, back at rest
+    destroyRenderedWords(effectStage.words);
+    wordsLineIndex = (size_t)-1;
 }
 
 void StoryManager::activateLineEffects() { // Corrected: Added StoryManager::
-    if (currentDialogIndex >= dialogLines.size()) return;
-
-    DialogLine& currentLine = dialogLines[currentDialogIndex];
+    if (!hasCurrentLine()) return;
+
+    const DialogLine& currentLine = getCurrentLine();
+    const Uint64 currentTicks = SDL_NS_TO_MS(clockNS);
+
+    // {pulse} spans cycle for as long as the line is shown (duration 0), in the default colors
+    // unless the line has a [PULSE] tag
+    const DialogLineText& lineText = getLineText(currentLine);
+    for (Uint32 i = 0; i < lineText.runCount; ++i) {
+        if (textRuns[lineText.firstRun + i].pulse) {
+            const TextEffectsContext defaults;
+            initTextColorPulse(effectStage.spanPulse, currentTicks, 0, defaults.pulseFrequencyHz,
+                               defaults.pulseColorStart, defaults.pulseColorEnd);
+            break;
+        }
+    }
 
     // Important: Effects need to be re-initialized if their parameters were changed
     // or if they were deactivated by the previous line or window resize.
-    if (currentLine.applyShake) {
-        initScreenShake(currentLine.shakeDuration, currentLine.shakeIntensity);
-    }
-    if (currentLine.applyPulse) {
-        initTextColorPulse(currentLine.pulseDurationMs, currentLine.pulseFrequencyHz, currentLine.pulseColor1, currentLine.pulseColor2);
-    }
-    if (currentLine.applyTear) {
-        initScreenTear(currentLine.tearDuration, currentLine.tearMaxOffsetX, currentLine.tearLineDensity);
-    }
+    ensureLineWords();
+    startLineEffects(effectStage, getLineEffects(currentLine).effects, currentTicks, currentStoryFile, currentDialogIndex);
+}
+
+void StoryManager::ensureLineWords() {
+    if (!hasCurrentLine() || wordsLineIndex == currentDialogIndex) return;
 
+    const DialogLine& currentLine = getCurrentLine();
+    destroyRenderedWords(effectStage.words);
+    wordsLineIndex = currentDialogIndex;
+    if (!effectSpecsUseWords(getLineEffects(currentLine).effects)) return;
+
+    // The same origin and width render() uses for the typewriter text, so the words start where it drew them
     const int textStartXForEffectInit = (int)(winWidth * 0.1f + textPadding);
     const int textStartYForEffectInit = (int)(winHeight * 0.55f + textPadding);
     const int textWrapWidthForEffectInit = (int)(winWidth * 0.8f - (2 * textPadding));
+    const TextLayout& layout = ensureLineLayout(currentLine, textWrapWidthForEffectInit);
+    effectStage.words = initLayoutWords(gTextEngine, gDialogFont, getLineString(currentLine), layout,
+                                        textStartXForEffectInit, textStartYForEffectInit);
+}
+
+void StoryManager::deactivateActiveEffects() { // Corrected: Added StoryManager::
+    // Every running effect of the line gets its stop hook (screen effects snap back, pulses end)
+    stopLineEffects(effectStage);
+    deactivateTextColorPulse(effectStage.spanPulse);
+}
+
+bool StoryManager::jumpToLine(const std::string& file, int lineIndex) {
+    // Handle the jump (potentially loading a new file, which also clears old resources)
+    if (!file.empty() && !loadJumpFile(file)) {
+        return false;
+    }
+
+    // Deactivate effects before changing state
+    deactivateActiveEffects();
+    currentDialogIndex = (lineIndex >= 0) ? (size_t)lineIndex : 0;
+    if (currentDialogIndex >= lineCount()) { currentDialogIndex = 0; } // Fallback
+    ensureLineLoaded(currentDialogIndex); // A numeric jump in a streamed file seeks via the index
+
+    // Reset state for new dialog path
+    currentVisibleGraphemes = 0;
+    animationIsPlaying = true;
+    awaitingChoice = false;
+    lineRevealStartNS = clockNS;
+    prevDialogIndex = (size_t)-1; // The target line's effects start on the next update
+    lineEntryPending = true;
+    return true;
+}
+
+bool StoryManager::loadJumpFile(const std::string& file) {
+    if (!std::ifstream(file, std::ios::binary).is_open()) {
+        diagnostics.reportRuntime(DIAG_FILE, currentStoryFile, 0, "jump", "can't open '" + file + "'; staying at dialog line " +
+                                  std::to_string(currentDialogIndex));
+        return false;
+    }
+    const std::string previousFile = currentStoryFile;
+    const size_t previousLine = currentDialogIndex;
+    deactivateActiveEffects();
+    if (loadStory(file)) return true;
+
+    // Opened but not loaded (loadStory reported why): back to the line the jump left from
+    loadStory(previousFile);
+    currentDialogIndex = std::min(previousLine, (lineCount() > 0) ? lineCount() - 1 : 0);
+    ensureLineLoaded(currentDialogIndex);
+    lineEntryPending = false; // Its statements already ran
+    return false;
+}
 
-    // Re-initialize jitter/physics words if they are currently empty (e.g., after clearAllStoryResources or resize)
-    // or if the effect is applied for this line and they haven't been set up yet.
-    if (currentLine.applyJitter && currentLine.jitterWords.empty()) {
-        currentLine.jitterWords = initJitterWords(gRenderer, gDialogFont, currentLine.dialogText,
-                                                 textStartXForEffectInit, textStartYForEffectInit,
-                                                 textWrapWidthForEffectInit);
+bool StoryManager::followJumpTarget(StoryJumpTarget target) { // A copy: loading a file clears the program
+    if (!target.label.empty()) {
+        // A label of another file: looked up in its label table once it's loaded, then remembered
+        const std::string key = target.file + ":" + target.label;
+        auto cached = fileLabelCache.find(key);
+        if (cached != fileLabelCache.end()) {
+            return jumpToLine(target.file, cached->second);
+        }
+        if (!loadJumpFile(target.file)) return false;
+        auto label = storyLabels.find(target.label);
+        if (label == storyLabels.end()) {
+            diagnostics.reportRuntime(DIAG_LABEL, target.file, 0, "[LABEL]", "no label '" + target.label + "'; starting at the first line");
+            jumpToLine("", 0);
+            return true;
+        }
+        fileLabelCache[key] = label->second;
+        jumpToLine("", label->second);
+        return true;
     }
-     if ((currentLine.applyFall || currentLine.applyFloat) && currentLine.physicsWords.empty()) {
-        currentLine.physicsWords = initPhysicsWords(gRenderer, gDialogFont, currentLine.dialogText,
-                                                   textStartXForEffectInit, textStartYForEffectInit,
-                                                   textWrapWidthForEffectInit);
+    if (target.lineIndex < 0) {
+        diagnostics.reportRuntime(DIAG_LABEL, currentStoryFile, 0, "jump", "target at dialog line " + std::to_string(currentDialogIndex) +
+                                  " couldn't be resolved when the file was loaded");
+        return false;
     }
+    return jumpToLine(target.file, target.lineIndex);
 }
 
-void StoryManager::deactivateActiveEffects() { // Corrected: Added StoryManager::
-    // These functions from text_effects.h and visual_effects.h modify their internal state to turn off effects
-    deactivateTextColorPulse(); // From text_effects.h
+void StoryManager::processLineEntry() {
+    // Run the statements of the line just arrived at. An [IF] may jump elsewhere, whose
+    // statements then run too; the limit stops scripts that jump in a circle.
+    const int MAX_JUMPS_PER_ENTRY = 64;
+    for (int jumps = 0; lineEntryPending; ++jumps) {
+        lineEntryPending = false;
+        if (!hasCurrentLine()) return;
+        if (jumps >= MAX_JUMPS_PER_ENTRY) {
+            std::cerr << "Warning: More than " << MAX_JUMPS_PER_ENTRY << " chained [IF] jumps at line "
+                      << currentDialogIndex << " in " << currentStoryFile << "; stopping here" << std::endl;
+            return;
+        }
+
+        int target = runStoryCode(storyProgram, getCurrentLine().enterCode, storyVariables.values.data());
+        if (target >= 0) {
+            followJumpTarget(storyProgram.jumpTargets[target]); // An unresolved target doesn't jump
+        }
+    }
+}
 
-    // Force deactivate screen-wide effects if they are active, or let them fade
-    initScreenShake(0, 0.0f); // Setting duration to 0 effectively turns it off
-    initScreenTear(0, 0.0f, 0.0f); // Setting duration to 0 effectively turns it off
+bool StoryManager::isChoiceVisible(const Choice& choice) const {
+    return evaluateStoryCondition(storyProgram, choice.condition, storyVariables.values.data());
+}
+
+bool StoryManager::hasVisibleChoices(const DialogLine& line) const {
+    for (Uint32 i = line.firstChoice; i < line.firstChoice + line.choiceCount; ++i) {
+        if (isChoiceVisible(choices[i])) return true;
+    }
+    return false; // Every choice is hidden by its condition: the line advances like a normal one
 }
 
 void StoryManager::handleChoiceClick(SDL_FPoint mouseClick) { // Corrected: Added StoryManager::
-    DialogLine& currentLine = dialogLines[currentDialogIndex];
-    for (size_t i = 0; i < currentLine.choices.size(); ++i) {
-        Choice& choice = currentLine.choices[i];
-        if (SDL_PointInRectFloat(&mouseClick, &choice.rect)) {
-            // Deactivate effects before changing state
-            deactivateActiveEffects();
-
-            // Handle choice jump (potentially loading new file)
-            if (!choice.nextFile.empty()) {
-                loadStory(choice.nextFile); // Load new story file (this will also clear old resources)
-                currentDialogIndex = choice.nextDialogIndex;
-                if (currentDialogIndex >= dialogLines.size()) { currentDialogIndex = 0; } // Fallback
-            } else {
-                currentDialogIndex = choice.nextDialogIndex;
-                if (currentDialogIndex >= dialogLines.size()) { currentDialogIndex = 0; } // Fallback
+    const DialogLine& currentLine = getCurrentLine();
+    for (Uint32 i = currentLine.firstChoice; i < currentLine.firstChoice + currentLine.choiceCount; ++i) {
+        const Choice& choice = choices[i];
+        if (isChoiceVisible(choice) && SDL_PointInRectFloat(&mouseClick, &choice.rect)) {
+            history.push({historyFile, (Uint32)currentDialogIndex, (Uint16)(i - currentLine.firstChoice)});
+            markLineRead();
+            if (!followJumpTarget(storyProgram.jumpTargets[choice.target])) {
+                advanceStoryLine(); // Reported at load; carry on with the story rather than restart it
             }
 
-            // Reset state for new dialog path
-            currentVisibleCharCount = 0;
-            animationIsPlaying = true;
-            awaitingChoice = false;
-            lastCharRevealTime = SDL_GetTicks();
-            prevDialogIndex = currentDialogIndex; // Reset prevDialogIndex for new path to trigger effects
-
             break; // Exit loop after a choice is made
         }
     }
@@ -3,6 +3,9 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <map>
+#include <string_view>
 #include <SDL3/SDL.h>       // For SDL_Texture, SDL_FRect, SDL_Event, Uint64, SDL_Color
 #include <SDL3_ttf/SDL_ttf.h> // For TTF_Font, TTF_TextEngine, TTF_GetStringSize, TTF_RenderText_Blended_Wrapped
 
@@ -10,60 +13,65 @@
 #include "text_effects.h"   // For RenderedWord, text effect declarations
 #include "visual_effects.h" // For screen effect declarations
 #include "text_ui.h"        // For UI rendering function declarations (drawDialogBoxUI, renderNameBox, renderText)
+#include "voice_blips.h"    // For VoiceBlipPlayer, VoiceParams
+#include "story_vm.h"       // For StoryProgram, StoryVariables, STORY_NO_CODE
+#include "story_index.h"    // For StoryLineIndex (streaming mode)
+#include "story_diagnostics.h" // For StoryDiagnostics (load warnings)
+#include "rich_text.h"      // For TextStyleRun, TextTiming, ShapedText
+#include "text_arena.h"     // For TextArena, StoryStr
+#include "line_effects.h"   // For EffectSpec, EffectStage (the effect registry)
+#include "save_state.h"     // For SnapshotWriter, SnapshotReader
+#include "story_history.h"  // For StoryHistory, HistoryEntry (the backlog)
+#include "read_tracker.h"   // For ReadTracker, ReadLineSet (skip mode)
 
 
 // --- Data Structures (Moved from main.cpp to be owned by StoryManager) ---
 
 // Choice struct
 struct Choice {
-    std::string text;
-    int nextDialogIndex;
-    std::string nextFile;
+    StoryStr text;              // In the story's text arena
+    Uint32 target;              // Index into the story program's jumpTargets
     SDL_FRect rect;             // Stores the clickable area for the choice box
-    SDL_Texture* textTexture;   // Pre-rendered texture for the choice text
-    int textWidth;              // Width of the pre-rendered text
-    int textHeight;             // Height of the pre-rendered text
+    TTF_Text* textObject;       // Laid out at load, re-wrapped in place on resize; drawn from the glyph atlas
+    int textWidth;              // Width of the laid out text
+    int textHeight;             // Height of the laid out text
+    Uint32 condition;           // Start of the compiled [IF] condition in the story program, or STORY_NO_CODE
 
-    Choice() : textTexture(nullptr), textWidth(0), textHeight(0) {} // Initialize members
+    Choice() : target(0), textObject(nullptr), textWidth(0), textHeight(0), condition(STORY_NO_CODE) {} // Initialize members
+};
+
+// --- Line Effects ---
+// The effect tags in front of a line, parsed through the effect registry (line_effects.h). Lines
+// with the same tags share one entry of the loaded story's effect table; most lines have none and
+// use entry 0.
+struct LineEffectSet {
+    std::vector<EffectSpec> effects; // In tag order, at most one per effect type
+
+    bool operator==(const LineEffectSet& other) const;
+};
+
+// The text of a line and what was compiled from its markup. Only read for the line on screen.
+struct DialogLineText {
+    StoryStr text;           // Plain text in the story's text arena, with the inline markup stripped
+    Uint32 firstRun;         // Styled runs covering the text: textRuns[firstRun, firstRun + runCount)
+    Uint32 runCount;
+    Uint32 graphemes;        // Cluster byte offsets: graphemeStarts[graphemes, graphemes + graphemeCount], last = text length
+    Uint32 graphemeCount;
+    Uint32 timeline;         // revealTimes[timeline + g]: microseconds after the line starts at which cluster g appears
 };
 
 // DialogLine struct
+// The per-line record walked by update and render: handles into the StoryManager's tables
+// for the loaded file instead of owned strings and vectors, so a line is 20 bytes.
 struct DialogLine {
-    std::string speakerName;
-    std::string dialogText;
-    std::vector<Choice> choices;
-    bool hasChoices;
-
-    bool applyJitter;
-
-    bool applyFall;
-    bool applyFloat;
-
-    bool applyPulse;
-    Uint64 pulseDurationMs;
-    float pulseFrequencyHz;
-    SDL_Color pulseColor1;
-    SDL_Color pulseColor2;
-
-    bool applyShake;
-    Uint64 shakeDuration;
-    float shakeIntensity;
-
-    bool applyTear;
-    Uint32 tearDuration;
-    float tearMaxOffsetX;
-    float tearLineDensity;
-
-    std::vector<RenderedWord> physicsWords;
-    std::vector<RenderedWord> jitterWords;
-    bool physicsActive;
-
-    DialogLine() : hasChoices(false), applyJitter(false),
-                   applyFall(false), applyFloat(false),
-                   applyPulse(false), pulseDurationMs(0), pulseFrequencyHz(0.0f),
-                   applyShake(false), shakeDuration(0), shakeIntensity(0.0f),
-                   applyTear(false), tearDuration(0), tearMaxOffsetX(0.0f), tearLineDensity(0.0f),
-                   physicsActive(false) {}
+    Uint32 speaker;             // Index into speakerNames
+    Uint32 text;                // Index into lineTexts
+    Uint32 firstChoice;         // The line's choices are choices[firstChoice, firstChoice + choiceCount)
+    Uint16 choiceCount;
+    Uint16 effects;             // Index into effectSets
+    Uint32 enterCode;           // Start of the [SET]/[ADD]/[IF] code run on arrival, or STORY_NO_CODE
+
+    DialogLine() : speaker(0), text(0), firstChoice(0), choiceCount(0), effects(0), enterCode(STORY_NO_CODE) {}
 };
 
 
@@ -76,21 +84,108 @@ public:
     // Destructor: Responsible for cleaning up loaded story resources
     ~StoryManager();
 
-    // Loads a story from a text file, parsing lines and choices
+    // Loads a story from a text file, parsing lines and choices. Files at least as large as the
+    // streaming threshold are indexed instead, and only a window of lines around the current one
+    // is kept parsed in memory.
     bool loadStory(const std::string& filename);
 
-    // Updates the state of the story (typing animation, physics, effects)
-    void update(Uint64 currentTicks, float deltaTime);
+    // Destroys the loaded story's texts and textures, which belong to the renderer and text
+    // engine passed to the constructor. Call before those are destroyed if the StoryManager
+    // outlives them (the destructor does the same, but too late then).
+    void releaseStoryResources();
+
+    // Sets the file size (bytes) from which loadStory streams. 0 streams every file.
+    void setStreamingThreshold(Uint64 bytes);
+
+    // Re-reads the loaded story file after it was edited. Other files are ignored: they are read
+    // afresh whenever a choice leads to them. The reader keeps their place: the current line stays
+    // as it was if its speaker and text are unchanged, at a new index if lines were added or
+    // removed before it; an edited line is revealed again. Name and choice texts, and the current
+    // line's shaped text and words, are kept wherever their text didn't change. Variables keep
+    // their values and the current line's statements don't run again.
+    // Returns false (keeping the story as it was) if the file isn't the loaded one or can't be read.
+    bool reloadStory(const std::string& filename);
+
+    // The story file currently loaded (the last one jumped to)
+    const std::string& getCurrentStoryFile() const;
+
+    // Appends a save snapshot (save_state.h) to `bytes`: the story file and line, the reveal
+    // progress, variables and voices, and the running effects with their words' physics. Times
+    // are kept relative to the story clock. Touches neither the disk nor the loaded story.
+    void saveSnapshot(std::vector<Uint8>& bytes) const;
+
+    // Restores a snapshot taken by saveSnapshot, loading its story file if another one is shown.
+    // The running effects continue where they were; the words' physics only if the window size
+    // is the same, otherwise they start over at rest. If the file was edited and is now shorter,
+    // its last line is shown from the start. Returns false, keeping the story as it was, if the
+    // snapshot is malformed, from another version, or its story file is gone.
+    bool loadSnapshot(const Uint8* data, size_t size);
+
+    // Sets the story clock (nanoseconds). Input handled before the next fixedUpdate() is
+    // timestamped with this, which keeps recorded sessions replayable frame-for-frame.
+    void setClock(Uint64 timeNS);
+
+    // Advances the story by one fixed simulation step (typing animation, physics, effects).
+    // simTimeNS: Clock time at the end of the step. stepSeconds: Length of the step.
+    void fixedUpdate(Uint64 simTimeNS, float stepSeconds);
 
     // Handles user input for advancing dialogue and making choices
     void handleInput(const SDL_Event& event);
 
     // Renders the current dialogue line, name box, and choices
-    void render(Uint64 currentTicks);
+    // renderTimeNS: Clock time of the frame. interpolationAlpha: 0..1 position between the
+    // last two simulation steps, used to interpolate physics words.
+    void render(Uint64 renderTimeNS, float interpolationAlpha);
+
+    // Retained compositing: reports the screen areas that changed since the last render() into
+    // `rects`. Returns true instead if the whole frame must be redrawn (new line, choices shown,
+    // resize, or screen shake/tear moving everything). Call just before render() with the same
+    // time and alpha.
+    bool collectDirtyRects(Uint64 renderTimeNS, std::vector<SDL_FRect>& rects, float interpolationAlpha);
 
     // handleWindowResize method in StoryManager
     void handleWindowResize(int newWidth, int newHeight);
 
+    // Attaches the audio player that typewriter voice blips are posted to (nullptr disables them).
+    // The player is not owned and must outlive the StoryManager or be detached first.
+    void setVoiceBlipPlayer(VoiceBlipPlayer* player);
+
+    // Lines shown and choices taken so far, oldest first (bounded: see story_history.h)
+    const StoryHistory& getHistory() const;
+
+    // The speaker and plain text of a history entry's line, or the text of its choice. Read from
+    // the loaded tables if the line is in memory, otherwise from its file on disk through the
+    // file's line index (built the first time an entry of that file is read, then kept).
+    // Returns false if the line isn't in the file any more.
+    bool getHistoryText(const HistoryEntry& entry, std::string& speaker, std::string& text);
+
+    // Read lines: a line counts as read once the player moves on from it. loadReadLines replaces
+    // what's tracked with a file written by saveReadLines (see read_tracker.h).
+    bool loadReadLines(const std::string& path);
+    bool saveReadLines(const std::string& path) const;
+
+    // Skip mode, while held (Tab, through handleInput): read lines go by at SKIP_LINES_PER_SECOND
+    // of story time without their typewriter, voice, effects or text layout, and the screen
+    // shows one of the lines passed over every SKIP_PREVIEW_INTERVAL_NS. Stops at the first
+    // unread line (shown as usual), at choices and at the last line, and carries on once the
+    // player has moved past them if it's still held.
+    void setSkipHeld(bool held);
+    bool isSkipping() const;
+
+    // Diagnostics (malformed tags, bad choices, ...) reported by the most recent loadStory
+    const StoryDiagnostics& getDiagnostics() const;
+
+    // Stops this StoryManager reporting diagnostics about the story files (anything but failed
+    // texts and textures), for loads of files someone else has already checked.
+    void setDiagnosticsSilenced(bool silenced);
+
+    // Number of dialog lines in the currently loaded story
+    size_t getDialogLineCount() const;
+
+    // Jumps to a line and shows it fully revealed (with its choices, if any) without
+    // starting its effects. Used by the offscreen batch renderer.
+    void showLineFullyRevealed(size_t index);
+
 private:
     // SDL resources used for rendering
     SDL_Renderer* gRenderer;
@@ -98,21 +193,158 @@ private:
     TTF_Font* gNameFont;
     TTF_TextEngine* gTextEngine;
 
+    // The current line's running effects and the state they act on (screen offsets, colors, words)
+    EffectStage effectStage;
+
     // Story state variables
-    std::vector<DialogLine> dialogLines;
+    std::vector<DialogLine> dialogLines; // The whole file, or in streaming mode the current window
+
+    // Tables the lines point into (rebuilt with dialogLines). Every string of the loaded file lives
+    // in storyText, so loading allocates a handful of buffers rather than one per string.
+    TextArena storyText;
+    std::vector<DialogLineText> lineTexts;
+    std::vector<TextStyleRun> textRuns;    // Every line's runs, in line order
+    std::vector<Uint32> graphemeStarts;    // Every line's grapheme cluster offsets, in line order
+    std::vector<Uint32> revealTimes;       // Every line's reveal timeline, in line order
+    std::vector<Choice> choices;           // Every line's choices, in line order
+    std::vector<LineEffectSet> effectSets; // Deduplicated; entry 0 has no effects
+    std::unordered_map<Uint64, Uint16> effectSetLookup; // Hash of an effect set -> its entry
+    std::vector<StoryStr> speakerNames;    // Each speaker once
+    std::vector<TTF_Text*> speakerTexts;   // The name box text of each speaker, parallel to speakerNames
+
+    // Effect words (effectStage.words) are laid out for the line on screen only
+    size_t wordsLineIndex;         // Line the words belong to, or (size_t)-1
     size_t currentDialogIndex;
-    size_t currentVisibleCharCount;
-    float animationDelayMs;
-    Uint64 lastCharRevealTime;
+    size_t currentVisibleGraphemes; // Revealed grapheme clusters of the current line
+    float animationDelayMs;        // Default per-character delay, compiled into each line's reveal timeline
+    Uint64 lineRevealStartNS; // Clock time the current line's typewriter reveal started
     bool animationIsPlaying;
     bool awaitingChoice;
     std::string currentStoryFile;
     size_t prevDialogIndex; // Used for one-time effect triggering on line change
+    Uint64 clockNS;         // Story clock in nanoseconds (set by setClock/fixedUpdate)
+
+    // Typewriter voice blips
+    VoiceBlipPlayer* voicePlayer;                               // Not owned; may be nullptr
+    std::map<std::string, VoiceParams, std::less<>> speakerVoices; // From [VOICE] tags, kept across files (looked up by view)
+
+    // Story variables and the compiled statements/conditions of the loaded file
+    StoryProgram storyProgram;
+    StoryVariables storyVariables; // Kept across files, like the rest of the player's progress
+    bool lineEntryPending;         // The current line was just reached and its enter code hasn't run yet
+
+    // Jump labels: [LABEL name] -> line of the whole file, for the loaded file (from the index when
+    // streaming). Labels of other files are looked up when a jump to them is taken, and cached.
+    std::unordered_map<std::string, int> storyLabels;
+    std::unordered_map<std::string, int> fileLabelCache; // "file:label" -> line
+
+    // Backlog history: every line reached and choice taken, by reference
+    StoryHistory history;
+    Uint32 historyFile;            // History id of currentStoryFile
+    std::unordered_map<std::string, StoryLineIndex> historyIndexes; // Files read back for the backlog
+
+    // Read lines and skip mode
+    static constexpr float SKIP_LINES_PER_SECOND = 10000.0f;
+    static const Uint64 SKIP_PREVIEW_INTERVAL_NS = 100 * SDL_NS_PER_MS;
+    ReadTracker readTracker;
+    ReadLineSet* readLines;        // Of currentStoryFile, or nullptr before the first load
+    bool skipHeld;
+    bool skipActive;               // Lines are going by (skip is held and hasn't stopped)
+    float skipBudget;              // Lines the elapsed story time allows skipping, carried between steps
+    Uint64 skipPreviewNS;          // Render time the preview last changed lines
+    size_t skipPreviewBytes;       // Byte length of the previewed line (shapedLine)
+    Uint32 skipPreviewSpeaker;     // Speaker of the previewed line
+
+    // Streaming mode: dialogLines holds STREAM_WINDOW_BLOCKS index blocks starting at windowFirstLine.
+    // currentDialogIndex stays a line number in the whole file.
+    static const size_t STREAM_WINDOW_BLOCKS = 3;
+    Uint64 streamingThresholdBytes;
+    bool streamingActive;
+    StoryLineIndex streamIndex;
+    size_t windowFirstLine;        // File line number of dialogLines[0] (always 0 when not streaming)
+    size_t streamWarnedLines;      // Lines up to here have had their diagnostics reported
+    std::string fileBuffer;        // Bytes of the file (or streamed window) being parsed, reused between loads
+
+    // Hot reload: laid out texts of the previous load by their contents, taken over by the new
+    // load's choices and speakers with the same text (whatever is left is destroyed afterwards)
+    std::unordered_multimap<std::string, TTF_Text*> reloadChoiceTexts;
+    std::unordered_multimap<std::string, TTF_Text*> reloadSpeakerTexts;
+
+    StoryDiagnostics diagnostics;
+
+    // What the last render() drew, for collectDirtyRects()
+    enum TextDrawMode { TEXT_DRAW_PLAIN, TEXT_DRAW_WORDS };
+    struct RenderedFrameState {
+        bool valid = false;
+        size_t lineIndex = 0;
+        size_t visibleBytes = 0;
+        bool awaitingChoice = false;
+        bool effectsMoving = false;          // Shake or tear was active
+        TextDrawMode textMode = TEXT_DRAW_PLAIN;
+        SDL_Color textColor = {0, 0, 0, 0};
+        bool glyphsAnimated = false;         // Wave / letter shake / rainbow was drawn
+        float glyphReach = 0.0f;             // How far those glyphs could move
+        std::vector<SDL_Color> runColors;
+        int width = 0;
+        int height = 0;
+        std::vector<SDL_FRect> wordRects;    // Where effect words were drawn
+    };
+    RenderedFrameState lastFrame;
+
+    // The current line's text, wrapped and rasterized once (rebuilt on line change or resize).
+    // The layout is shared by the shaped text and the effect words.
+    ShapedText shapedLine;
+    size_t shapedLineIndex;
+    int shapedWrapWidth;
+    TextLayout lineLayout;
+    size_t layoutLineIndex;
+    int layoutWrapWidth;
+    FontMetrics dialogMetrics[FONT_METRICS_STYLES]; // Widths for the dialog font in each style, kept across lines and resizes
+    std::vector<SDL_Color> runColors; // This frame's color for each run of the current line
 
     // Private helper methods
     void advanceStoryLine();
+    void markLineRead();            // Marks the current line as read
+    void skipReadLines(float stepSeconds); // Skip mode's part of a fixed step
+    void stopSkipping();            // The line skipping stopped at is shown as usual
+    void renderSkipPreview(Uint64 renderTimeNS);
     void activateLineEffects();
     void deactivateActiveEffects(); // Deactivates effects from the *previous* line
+    void postVoiceBlips(const DialogLine& line, size_t firstGrapheme, size_t endGrapheme); // One blip per revealed character
     void handleChoiceClick(SDL_FPoint mouseClick);
+    bool jumpToLine(const std::string& file, int lineIndex); // Loads `file` if non-empty, then goes to the line
+    bool loadJumpFile(const std::string& file); // False, with the story left where it was, if it can't be loaded
+    bool followJumpTarget(StoryJumpTarget target); // Resolves a label of another file first; false if unresolved
+    void processLineEntry();        // Runs the enter code of a newly reached line, following [IF] jumps
+    bool isChoiceVisible(const Choice& choice) const;
+    bool hasVisibleChoices(const DialogLine& line) const;
     void clearAllStoryResources(); // Cleans up all loaded dialog lines (especially choice textures)
+    // loadStory, given the file's bytes if the caller has already read them (taken over), or nullptr
+    bool loadStoryFile(const std::string& filename, std::string* fileBytes);
+    // Parses script lines from `buffer` into dialogLines until its end or until maxLines lines are
+    // loaded. rawLineNumber: file lines before the start of `buffer`.
+    void parseStoryLines(std::string_view buffer, const std::string& filename, int rawLineNumber,
+                         std::string_view currentSpeaker, size_t maxLines);
+    bool parseVoiceTag(std::string_view tag); // Applies a [VOICE] tag; false if malformed
+    void loadStreamWindow(size_t lineIndex);    // Reparses the window around a line from the index
+    void ensureLineLoaded(size_t lineIndex);    // Moves the streaming window if the line is outside it
+    // The line nearest oldIndex with this speaker and text (within the streaming window), or (size_t)-1
+    size_t findReloadedLine(size_t oldIndex, std::string_view speaker, std::string_view text);
+    size_t lineCount() const;                   // Dialog lines in the whole file
+    bool hasCurrentLine() const;                // Whether currentDialogIndex is loaded in dialogLines
+    DialogLine& getCurrentLine();
+    const LineEffectSet& getLineEffects(const DialogLine& line) const;
+    const DialogLineText& getLineText(const DialogLine& line) const;
+    std::string_view getLineString(const DialogLine& line) const;
+    size_t getVisibleTextBytes() const; // Byte length of the revealed part of the current line
+    std::string_view getSpeakerName(const DialogLine& line) const;
+    Uint16 internEffectSet(const LineEffectSet& effects);
+    Uint32 internSpeaker(std::string_view name);
+    void ensureLineWords();                     // Lays out the current line's effect words if an effect uses them
+    TextDrawMode getTextDrawMode() const;
+    const TextLayout& ensureLineLayout(const DialogLine& line, int wrapWidth);
+    void ensureShapedLine(const DialogLine& line, int wrapWidth);
+    void computeRunColors(const DialogLine& line, Uint64 currentTicks, SDL_Color lineColor);
+    static SDL_FRect getInterpolatedWordRect(const RenderedWord& word, float interpolationAlpha);
+    void drawWord(const RenderedWord& word, const SDL_FRect& rect, SDL_Color color, const EffectFrame& frame);
 };
\ No newline at end of file
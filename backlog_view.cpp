@@ -0,0 +1,186 @@
+// backlog_view.cpp - Implementation of the virtualized backlog view
+#include "backlog_view.h"   // Include the corresponding header
+#include <algorithm>        // For std::min, std::max
+#include <iostream>         // For std::cerr
+#include <string>           // For std::string
+#include "StoryManager.h"   // For StoryManager, StoryHistory
+#include "render_stats.h"   // For counted draw calls and texture creation
+#include "text_ui.h"        // For winWidth, winHeight, drawDialogBoxUI, colors
+
+// --- BacklogView ---
+BacklogView::~BacklogView() {
+    destroy();
+}
+
+void BacklogView::open() {
+    opened = true;
+    scrollRows = 0; // Start at the newest entry
+}
+
+void BacklogView::close() {
+    opened = false;
+}
+
+bool BacklogView::handleInput(const SDL_Event& event) {
+    if (!opened) {
+        if (event.type == SDL_EVENT_KEY_DOWN && event.key.key == SDLK_B && !event.key.repeat) {
+            open();
+            return true;
+        }
+        if (event.type == SDL_EVENT_MOUSE_WHEEL && event.wheel.y > 0.0f) {
+            open();
+            return true;
+        }
+        return false;
+    }
+
+    switch (event.type) {
+        case SDL_EVENT_KEY_DOWN:
+            if ((event.key.key == SDLK_B || event.key.key == SDLK_ESCAPE) && !event.key.repeat) {
+                close();
+            } else if (event.key.key == SDLK_UP) {
+                scrollBy(1);
+            } else if (event.key.key == SDLK_DOWN) {
+                scrollBy(-1);
+            } else if (event.key.key == SDLK_PAGEUP) {
+                scrollBy((int)pageRows);
+            } else if (event.key.key == SDLK_PAGEDOWN) {
+                scrollBy(-(int)pageRows);
+            }
+            return true;
+        case SDL_EVENT_MOUSE_WHEEL:
+            if (event.wheel.y < 0.0f && scrollRows == 0) {
+                close(); // Scrolled back down past the newest entry
+            } else if (event.wheel.y != 0.0f) {
+                scrollBy((event.wheel.y > 0.0f ? 1 : -1) * WHEEL_ROWS);
+            }
+            return true;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void BacklogView::scrollBy(int rows) {
+    const size_t maxScroll = (historySize > pageRows) ? historySize - pageRows : 0;
+    if (rows < 0) {
+        scrollRows -= std::min(scrollRows, (size_t)-rows);
+    } else {
+        scrollRows = std::min(scrollRows + (size_t)rows, maxScroll);
+    }
+}
+
+BacklogView::CachedRow* BacklogView::findRow(Uint64 sequence) {
+    for (CachedRow& row : rows) {
+        if (row.used && row.sequence == sequence) return &row;
+    }
+    return nullptr;
+}
+
+BacklogView::CachedRow* BacklogView::rasterizeRow(SDL_Renderer* renderer, TTF_Font* font, StoryManager& story, size_t entryIndex) {
+    // Reuse the least recently drawn row (rows on screen were drawn this frame, so never them)
+    CachedRow* row = &rows[0];
+    for (CachedRow& candidate : rows) {
+        if (!candidate.used) {
+            row = &candidate;
+            break;
+        }
+        if (candidate.lastUsedFrame < row->lastUsedFrame) row = &candidate;
+    }
+    if (row->texture) countedDestroyTexture(row->texture);
+    *row = CachedRow();
+    row->used = true;
+    row->sequence = story.getHistory().getSequence(entryIndex);
+    row->lastUsedFrame = frame;
+
+    // Looked up now, for this row only: the history holds references, not text
+    const HistoryEntry& entry = story.getHistory().at(entryIndex);
+    std::string speaker, text;
+    if (!story.getHistoryText(entry, speaker, text)) return row; // Drawn as an empty row
+    std::string rowText;
+    SDL_Color color = textColorWhite;
+    if (entry.choice != HISTORY_NO_CHOICE) {
+        rowText = "> " + text;
+        color = choiceBorderColor;
+    } else {
+        rowText = speaker.empty() ? text : speaker + ": " + text;
+    }
+    if (rowText.empty()) return row;
+
+    SDL_Surface* surface = countedRenderText_Blended_Wrapped(font, rowText.data(), rowText.size(), color, wrapWidth);
+    if (!surface) {
+        std::cerr << "Unable to render backlog row! SDL_Error: " << SDL_GetError() << std::endl;
+        return row;
+    }
+    row->texture = countedCreateTextureFromSurface(renderer, surface);
+    row->width = (float)surface->w;
+    row->height = (float)surface->h;
+    SDL_DestroySurface(surface);
+    return row;
+}
+
+void BacklogView::render(SDL_Renderer* renderer, TTF_Font* font, StoryManager& story) {
+    if (!opened || !renderer || !font) return;
+    frame++;
+
+    const float margin = (float)textPadding;
+    const SDL_FRect panel = {winWidth * 0.05f, winHeight * 0.05f, winWidth * 0.9f, winHeight * 0.9f};
+    drawDialogBoxUI(renderer, panel.x, panel.y, panel.w, panel.h, dialogBoxBgColor, borderColor);
+
+    // Rows rasterized for another width are stale
+    const int rowWrapWidth = std::max(1, (int)(panel.w - 3 * margin));
+    if (rowWrapWidth != wrapWidth) {
+        destroy();
+        wrapWidth = rowWrapWidth;
+    }
+
+    // Which entries are on screen follows from the scroll position and the fixed row height
+    const StoryHistory& history = story.getHistory();
+    const float rowHeight = (float)(TTF_GetFontHeight(font) * ROW_TEXT_LINES) + margin;
+    const float rowsTop = panel.y + margin;
+    const float rowsHeight = panel.h - 2 * margin;
+    historySize = history.size();
+    pageRows = std::max<size_t>(1, (size_t)(rowsHeight / rowHeight));
+    scrollBy(0); // The history may have shrunk or the window grown since the last scroll
+    if (historySize == 0) return;
+    const size_t lastEntry = historySize - 1 - std::min(scrollRows, historySize - 1);
+    const size_t firstEntry = (lastEntry + 1 > pageRows) ? lastEntry + 1 - pageRows : 0;
+
+    // Newest at the bottom of the panel
+    int rasterized = 0;
+    for (size_t i = firstEntry; i <= lastEntry; ++i) {
+        CachedRow* row = findRow(history.getSequence(i));
+        if (!row) {
+            if (rasterized >= RASTERS_PER_FRAME) continue; // Filled in on a later frame
+            row = rasterizeRow(renderer, font, story, i);
+            rasterized++;
+        }
+        row->lastUsedFrame = frame;
+        if (!row->texture) continue;
+
+        const float y = rowsTop + rowsHeight - (float)(lastEntry - i + 1) * rowHeight;
+        const float visibleHeight = std::min(row->height, rowHeight - margin);
+        const SDL_FRect source = {0.0f, 0.0f, row->width, visibleHeight};
+        const SDL_FRect destination = {panel.x + margin, y, row->width, visibleHeight};
+        countedRenderTexture(renderer, row->texture, &source, &destination);
+    }
+
+    // Scroll bar: the share of the history on screen, and where it is
+    if (historySize > pageRows) {
+        const float barHeight = std::max(8.0f, rowsHeight * (float)pageRows / (float)historySize);
+        const float barTravel = rowsHeight - barHeight;
+        const float position = 1.0f - (float)scrollRows / (float)(historySize - pageRows); // 1: at the newest
+        const SDL_FRect bar = {panel.x + panel.w - margin * 0.75f, rowsTop + barTravel * position, margin * 0.5f, barHeight};
+        SDL_SetRenderDrawColor(renderer, borderColor.r, borderColor.g, borderColor.b, borderColor.a);
+        countedRenderFillRect(renderer, &bar);
+    }
+}
+
+void BacklogView::destroy() {
+    for (CachedRow& row : rows) {
+        if (row.texture) countedDestroyTexture(row.texture);
+        row = CachedRow();
+    }
+}
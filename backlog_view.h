@@ -0,0 +1,61 @@
+// backlog_view.h - Scrollable backlog of the story history, drawing only the rows on screen
+#pragma once
+#include <SDL3/SDL.h>       // For SDL_Renderer, SDL_Texture, SDL_Event, Uint64
+#include <SDL3_ttf/SDL_ttf.h> // For TTF_Font
+
+class StoryManager;
+
+// --- BacklogView ---
+// Shows the StoryManager's history (story_history.h) over the story, newest entry at the bottom.
+// Rows have a fixed height, so the rows on screen follow from the scroll position alone and a
+// frame costs the same with 100 entries as with 10,000. Each row's text is looked up and
+// rasterized once into a cached texture when it scrolls into view; at most a few new rows are
+// rasterized per frame, and the rest fill in over the next frames.
+// Opened with B or by scrolling the mouse wheel up; closed with B, Escape or by scrolling back
+// down past the newest entry.
+class BacklogView {
+public:
+    ~BacklogView();
+
+    void open();
+    void close();
+    bool isOpen() const { return opened; }
+
+    // Handles the keys and wheel that open, scroll and close the backlog. Returns true if the
+    // event was used (while open, every key press and mouse event is, so the story doesn't
+    // advance underneath; key releases still reach it, so a held skip key is let go).
+    bool handleInput(const SDL_Event& event);
+
+    // Draws the backlog over the current frame if it's open.
+    void render(SDL_Renderer* renderer, TTF_Font* font, StoryManager& story);
+
+    // Destroys the cached row textures. Call before the renderer goes away.
+    void destroy();
+
+private:
+    struct CachedRow {
+        Uint64 sequence = 0;           // StoryHistory::getSequence of the entry
+        SDL_Texture* texture = nullptr; // nullptr if the entry's text couldn't be found
+        float width = 0.0f;
+        float height = 0.0f;
+        Uint64 lastUsedFrame = 0;      // For evicting the least recently drawn row
+        bool used = false;
+    };
+
+    static const int ROW_CACHE_SIZE = 96;       // A few screens of rows
+    static const int ROW_TEXT_LINES = 3;        // Wrapped lines a row has room for; more are cut off
+    static const int RASTERS_PER_FRAME = 4;     // New rows rasterized per frame while scrolling fast
+    static const int WHEEL_ROWS = 3;            // Rows scrolled per wheel notch
+
+    CachedRow* findRow(Uint64 sequence);
+    CachedRow* rasterizeRow(SDL_Renderer* renderer, TTF_Font* font, StoryManager& story, size_t entryIndex);
+    void scrollBy(int rows);
+
+    bool opened = false;
+    size_t scrollRows = 0;         // Entries hidden below the bottom row (0: the newest is shown)
+    size_t historySize = 0;        // At the last render, for clamping scrolls
+    size_t pageRows = 1;           // Rows on screen at the last render
+    int wrapWidth = 0;             // Width the cached rows were rasterized for
+    Uint64 frame = 0;
+    CachedRow rows[ROW_CACHE_SIZE];
+};
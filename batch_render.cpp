@@ -0,0 +1,166 @@
+// batch_render.cpp - Implementation of the offscreen batch renderer
+#include "batch_render.h"   // Include the corresponding header
+#include <iostream>         // For std::cout, std::cerr
+#include <cstdio>           // For std::snprintf
+#include <atomic>           // For std::atomic (shared work counters)
+#include <mutex>            // For std::mutex (logging)
+#include <thread>           // For std::thread (one per worker)
+#include <memory>           // For std::unique_ptr
+#include <functional>       // For std::ref
+#include <SDL3/SDL.h>       // For SDL_Init, SDL_SavePNG, SDL_GetNumLogicalCPUCores
+#include <SDL3_ttf/SDL_ttf.h> // For TTF_Init, TTF_Quit
+
+#include "StoryManager.h"   // Each worker drives its own StoryManager
+#include "headless.h"       // For OffscreenTarget
+#include "text_ui.h"        // For winWidth, winHeight
+#include "story_diagnostics.h" // For flushDiagnostics
+
+// Every line is captured at the same story time, so time-based colors (pulse, rainbow, ...)
+// come out the same on every run. The story clock stays at 0 in batch mode.
+const Uint64 BATCH_RENDER_TIME_NS = 0;
+
+// --- Shared Batch State ---
+// Work is split per line: every worker loads each story file itself, then claims line
+// indices from that file's counter until none are left. No barrier is needed between files.
+// The files are checked once up front (checkStoryFiles), so the workers load them silently.
+struct BatchShared {
+    const std::vector<std::string>* storyFiles;
+    std::string outputDir;
+    std::vector<char> fileLoads;                     // Per story file: whether it passed the check
+    std::unique_ptr<std::atomic<size_t>[]> nextLine; // One claim counter per story file
+    std::atomic<size_t> linesWritten{0};
+    std::atomic<size_t> failures{0};
+    std::mutex logMutex;
+};
+
+// Strips directories and the extension so "chapters/ch1.txt" becomes "ch1".
+static std::string storyStem(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    return (dot == std::string::npos || dot == 0) ? name : name.substr(0, dot);
+}
+
+// --- Checking the Files ---
+// Loads each story file once, with no renderer, and parses every line of it (a streamed file
+// window by window), so its diagnostics and load failure are reported once, whatever the
+// number of workers.
+static void checkStoryFiles(BatchShared& shared) {
+    StoryManager checker(nullptr, nullptr, nullptr, nullptr);
+    shared.fileLoads.assign(shared.storyFiles->size(), 0);
+    for (size_t fileIndex = 0; fileIndex < shared.storyFiles->size(); ++fileIndex) {
+        if (!checker.loadStory((*shared.storyFiles)[fileIndex])) {
+            shared.failures++;
+            continue;
+        }
+        for (size_t lineIndex = 0; lineIndex < checker.getDialogLineCount(); ++lineIndex) {
+            checker.showLineFullyRevealed(lineIndex);
+        }
+        shared.fileLoads[fileIndex] = 1;
+    }
+}
+
+// --- Worker ---
+// Each worker owns a complete, private rendering stack: surface, software renderer,
+// text engine, fonts and StoryManager. Nothing here is shared with other workers.
+static void batchWorker(BatchShared& shared, int workerId) {
+    OffscreenTarget target;
+    if (!createOffscreenTarget(target, winWidth, winHeight)) {
+        std::lock_guard<std::mutex> lock(shared.logMutex);
+        std::cerr << "Batch worker " << workerId << " failed to initialize: " << SDL_GetError() << std::endl;
+        shared.failures++;
+        return;
+    }
+
+    {
+        StoryManager storyManager(target.renderer, target.dialogFont, target.nameFont, target.textEngine);
+        storyManager.setDiagnosticsSilenced(true); // Reported by checkStoryFiles
+
+        for (size_t fileIndex = 0; fileIndex < shared.storyFiles->size(); ++fileIndex) {
+            const std::string& storyFile = (*shared.storyFiles)[fileIndex];
+            if (!shared.fileLoads[fileIndex]) {
+                continue; // Counted once by checkStoryFiles
+            }
+            if (!storyManager.loadStory(storyFile)) { // Loaded for the check, so only if it changed since
+                std::lock_guard<std::mutex> lock(shared.logMutex);
+                std::cerr << "Batch worker " << workerId << " failed to reload " << storyFile << std::endl;
+                shared.failures++;
+                continue;
+            }
+            const std::string stem = storyStem(storyFile);
+            const size_t lineCount = storyManager.getDialogLineCount();
+
+            size_t lineIndex;
+            while ((lineIndex = shared.nextLine[fileIndex].fetch_add(1)) < lineCount) {
+                storyManager.showLineFullyRevealed(lineIndex);
+
+                clearOffscreenTarget(target);
+                storyManager.render(BATCH_RENDER_TIME_NS, 1.0f);
+                SDL_FlushRenderer(target.renderer);
+
+                char fileName[64];
+                std::snprintf(fileName, sizeof(fileName), "_%05zu.png", lineIndex);
+                std::string outPath = shared.outputDir + "/" + stem + fileName;
+                if (SDL_SavePNG(target.surface, outPath.c_str())) {
+                    shared.linesWritten++;
+                } else {
+                    std::lock_guard<std::mutex> lock(shared.logMutex);
+                    std::cerr << "Failed to write " << outPath << ": " << SDL_GetError() << std::endl;
+                    shared.failures++;
+                }
+            }
+        }
+    } // StoryManager is destroyed here, before the renderer it references
+
+    destroyOffscreenTarget(target);
+}
+
+// --- Entry Point ---
+int runBatchRender(const std::vector<std::string>& storyFiles, const std::string& outputDir, int workerCount) {
+    if (storyFiles.empty()) {
+        std::cerr << "Batch render: no story files given." << std::endl;
+        return 1;
+    }
+    // No window: the workers draw with software renderers into surfaces, so SDL needs no subsystems
+    if (!SDL_Init(0)) {
+        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+    if (!TTF_Init()) {
+        std::cerr << "SDL_ttf could not initialize! TTF_Error: " << SDL_GetError() << std::endl;
+        SDL_Quit();
+        return 1;
+    }
+
+    if (workerCount <= 0) {
+        workerCount = SDL_GetNumLogicalCPUCores();
+        if (workerCount <= 0) workerCount = 1;
+    }
+
+    BatchShared shared;
+    shared.storyFiles = &storyFiles;
+    shared.outputDir = outputDir;
+    shared.nextLine.reset(new std::atomic<size_t>[storyFiles.size()]);
+    for (size_t i = 0; i < storyFiles.size(); ++i) {
+        shared.nextLine[i] = 0;
+    }
+    checkStoryFiles(shared);
+
+    Uint64 startTicks = SDL_GetTicks();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(batchWorker, std::ref(shared), i);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    flushDiagnostics(); // Load warnings come before the summary
+
+    std::cout << "Batch render: wrote " << shared.linesWritten << " PNG(s) from " << storyFiles.size()
+              << " story file(s) with " << workerCount << " worker(s) in " << (SDL_GetTicks() - startTicks)
+              << " ms, " << shared.failures << " failure(s)." << std::endl;
+
+    TTF_Quit();
+    SDL_Quit();
+    return shared.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+// batch_render.h - Offscreen "render every line to PNG" batch mode for script QA
+#pragma once
+#include <string>           // For std::string
+#include <vector>           // For std::vector
+
+// Renders every dialog line of the given story files, fully revealed with its name box and
+// choice panel, into an offscreen software-rendered surface and writes one PNG per line.
+// storyFiles: Story scripts to walk, in order.
+// outputDir: Existing directory the PNGs are written into (named <story>_<line>.png).
+// workerCount: Number of worker threads, each with its own renderer, fonts and StoryManager.
+//              0 or less uses one worker per logical CPU core.
+// Returns 0 on success, non-zero if initialization failed or any line could not be written.
+int runBatchRender(const std::vector<std::string>& storyFiles, const std::string& outputDir, int workerCount);
@@ -0,0 +1,559 @@
+// benchmarks.cpp - Implementation of the command-line micro-benchmarks
+#include "benchmarks.h"     // Include the corresponding header
+#include "story_vm.h"       // For the story compiler and interpreter
+#include "story_tokenizer.h" // For StoryTokenizer
+#include "StoryManager.h"   // For StoryManager::loadStory
+#include <SDL3/SDL.h>       // For SDL_GetTicksNS
+#include <iostream>         // For std::cout, std::cerr
+#include <sstream>          // For std::istringstream (the old parse loop)
+#include <fstream>          // For std::ofstream
+#include <filesystem>       // For std::filesystem::temp_directory_path
+#include <string>           // For std::string, std::to_string
+#include <algorithm>        // For std::min
+#include <vector>           // For std::vector
+
+// --- Story VM Benchmark ---
+int runStoryVmBenchmark(int instructionCount) {
+    if (instructionCount < 1000) instructionCount = 1000;
+    const int VARIABLE_COUNT = 64;
+
+    StoryProgram program;
+    StoryVariables variables;
+    std::string error;
+
+    // One long enter block: mostly [ADD]/[SET], with an [IF] every few statements. The [IF]s test
+    // for negative values, which only ever grow, so they are evaluated but never jump.
+    std::vector<StoryInstr> block;
+    for (int i = 0; (int)block.size() < instructionCount; ++i) {
+        std::string a = "v" + std::to_string(i % VARIABLE_COUNT);
+        std::string b = "v" + std::to_string((i * 7 + 3) % VARIABLE_COUNT);
+        std::string statement;
+        switch (i % 4) {
+            case 0: statement = "[ADD " + a + " " + std::to_string(i % 5 + 1) + "]"; break;
+            case 1: statement = "[SET " + a + " " + b + " >= " + std::to_string(i % 50) + "]"; break;
+            case 2: statement = "[IF " + a + " < 0 && !" + b + " -> " + std::to_string(i) + "]"; break;
+            default: statement = "[SET " + a + " (" + a + " > " + b + ") || (" + b + " == 3)]"; break;
+        }
+        if (!compileStoryStatement(statement, block, program, variables, error)) {
+            std::cerr << "Warning: Benchmark statement failed to compile: " << statement << " (" << error << ")" << std::endl;
+            return 1;
+        }
+    }
+    Uint32 blockStart = appendStoryBlock(program, block);
+    const size_t blockInstructions = block.size() + 1; // Plus END
+
+    // Choice conditions, compiled separately like the [IF] suffixes on choices
+    std::vector<Uint32> conditions;
+    size_t conditionInstructions = 0;
+    for (int i = 0; conditionInstructions < (size_t)instructionCount; ++i) {
+        std::string a = "v" + std::to_string(i % VARIABLE_COUNT);
+        std::string b = "v" + std::to_string((i * 13 + 5) % VARIABLE_COUNT);
+        std::string expression = a + " >= " + std::to_string(i % 40) + " && (" + b + " != 2 || !" + a + ")";
+        size_t before = program.code.size();
+        Uint32 start = compileStoryCondition(expression, program, variables, error);
+        if (start == STORY_NO_CODE) {
+            std::cerr << "Warning: Benchmark condition failed to compile: " << expression << " (" << error << ")" << std::endl;
+            return 1;
+        }
+        conditions.push_back(start);
+        conditionInstructions += program.code.size() - before;
+    }
+
+    std::cout << "Story VM benchmark: " << variables.names.size() << " variables, "
+              << blockInstructions << " statement instructions, " << conditions.size() << " conditions ("
+              << conditionInstructions << " instructions), " << program.code.size() * sizeof(StoryInstr) / 1024
+              << " KiB of code" << std::endl;
+
+    const int RUNS = 20;
+
+    // Statement blocks
+    variables.resetValues();
+    Uint64 startNS = SDL_GetTicksNS();
+    int jumps = 0;
+    for (int run = 0; run < RUNS; ++run) {
+        if (runStoryCode(program, blockStart, variables.values.data()) >= 0) jumps++;
+    }
+    Uint64 blockNS = SDL_GetTicksNS() - startNS;
+
+    // Conditions
+    startNS = SDL_GetTicksNS();
+    size_t visible = 0;
+    for (int run = 0; run < RUNS; ++run) {
+        for (Uint32 condition : conditions) {
+            if (evaluateStoryCondition(program, condition, variables.values.data())) visible++;
+        }
+    }
+    Uint64 conditionNS = SDL_GetTicksNS() - startNS;
+
+    double blockTotal = (double)blockInstructions * RUNS;
+    double conditionTotal = (double)conditionInstructions * RUNS;
+    std::cout << "  statements: " << blockNS / 1000000.0 << " ms for " << (Uint64)blockTotal << " instructions ("
+              << (blockNS > 0 ? blockTotal * 1e3 / (double)blockNS : 0.0) << " M instr/s, " << jumps << " jumps)" << std::endl;
+    std::cout << "  conditions: " << conditionNS / 1000000.0 << " ms for " << (Uint64)conditionTotal << " instructions ("
+              << (conditionNS > 0 ? conditionTotal * 1e3 / (double)conditionNS : 0.0) << " M instr/s, "
+              << visible << " true)" << std::endl;
+    return 0;
+}
+
+// --- Story Parse Benchmark ---
+namespace {
+
+// What a parse pass found, compared between the two parsers so both are known to do the same work
+struct ParseTally {
+    size_t dialogLines = 0;
+    size_t tags = 0;          // Only the tokenizer counts these; the old parser kept no tally
+    size_t choices = 0;
+    long long targetSum = 0;  // Every numeric choice target
+    size_t dialogBytes = 0;   // Dialog and choice texts
+
+    bool matches(const ParseTally& o) const {
+        return dialogLines == o.dialogLines && choices == o.choices &&
+               targetSum == o.targetSum && dialogBytes == o.dialogBytes;
+    }
+};
+
+// A script of `lineCount` lines mixing speakers, dialog with markup, effect tags with arguments,
+// comments and choice blocks. Only syntax the old parser understood, so neither side of the
+// comparison spends its time on warnings.
+std::string makeSyntheticScript(int lineCount) {
+    std::string script;
+    script.reserve((size_t)lineCount * 40);
+    int lines = 0;
+    int dialogLines = 0;
+    auto add = [&](const std::string& line) { script += line; script += '\n'; lines++; };
+    for (int i = 0; lines < lineCount; ++i) {
+        add("# Scene " + std::to_string(i));
+        add("[SHAKE " + std::to_string(200 + i % 300) + " " + std::to_string(i % 9 + 1) + "]");
+        add("'Alice' \"Line " + std::to_string(i) + " has {b}some{/b} markup and a {pulse}pulsing{/pulse} word.\"");
+        dialogLines++;
+        add("[PULSE 800 2.5 255 255 255 255 255 " + std::to_string(i % 256) + " 0 255]");
+        add("[FLOAT]");
+        add("\"Plain narration, number " + std::to_string(i) + ", a little longer than the lines around it.\"");
+        dialogLines++;
+        add("");
+        add("[TEAR 300 12.5 " + std::to_string(i % 7 + 1) + "]");
+        add("[JITTER]");
+        add("'Bob' \"Short reply " + std::to_string(i) + ".\"");
+        dialogLines++;
+        add("[");
+        add("    \"Go on\" -> " + std::to_string(dialogLines - 1));
+        add("    \"Go back\" -> " + std::to_string(dialogLines > 3 ? dialogLines - 3 : 0));
+        add("]");
+    }
+    return script;
+}
+
+// The parse loop of loadStory before the tokenizer, kept as it was so the benchmark measures
+// against the real thing. Left out: opening the file (both sides read from memory here), the
+// choice text textures and the jitter/physics word layout, which need a renderer and font.
+namespace baseline {
+
+struct Choice {
+    std::string text;
+    int nextDialogIndex;
+    std::string nextFile;
+};
+
+struct DialogLine {
+    std::string speakerName;
+    std::string dialogText;
+    std::vector<Choice> choices;
+    bool hasChoices;
+
+    bool applyJitter;
+    bool applyFall;
+    bool applyFloat;
+    bool applyPulse;
+    Uint64 pulseDurationMs;
+    float pulseFrequencyHz;
+    SDL_Color pulseColor1;
+    SDL_Color pulseColor2;
+    bool applyShake;
+    Uint64 shakeDuration;
+    float shakeIntensity;
+    bool applyTear;
+    Uint32 tearDuration;
+    float tearMaxOffsetX;
+    float tearLineDensity;
+    bool physicsActive;
+};
+
+void loadStory(std::istream& file, const std::string& filename, std::vector<DialogLine>& dialogLines) {
+    dialogLines.clear();
+
+    std::string line;
+    std::string currentSpeaker = "";
+    int rawLineNumber = 0;
+
+    // Temporary flags and parameters for the *next* dialog line to be loaded
+    bool nextLineShouldJitter = false;
+    bool nextLineShouldFall = false;
+    bool nextLineShouldFloat = false;
+    bool nextLineShouldPulse = false;
+    Uint64 nextLinePulseDuration = 1500;
+    float nextLinePulseFrequency = 2.0f;
+    SDL_Color nextLinePulseColor1 = {255,255,255,255};
+    SDL_Color nextLinePulseColor2 = {255,100,100,255};
+
+    bool nextLineShouldShake = false;
+    Uint64 nextLineShakeDuration = 0;
+    float nextLineShakeIntensity = 0.0f;
+
+    bool nextLineShouldTear = false;
+    Uint32 nextLineTearDuration = 0;
+    float nextLineTearMaxOffsetX = 0.0f;
+    float nextLineTearLineDensity = 0.0f;
+
+
+    while (std::getline(file, line)) {
+        rawLineNumber++;
+        size_t firstChar = line.find_first_not_of(" \t\r\n");
+        if (firstChar == std::string::npos) {
+            continue; // Skip empty or whitespace-only lines
+        }
+        std::string trimmedLine = line.substr(firstChar);
+
+        // Skip lines that start with a '#' comment character
+        if (trimmedLine.rfind("#", 0) == 0) {
+            continue;
+        }
+
+        // --- Handle Special Tags ---
+        if (trimmedLine == "[") { // Start of a choice block
+            if (dialogLines.empty()) {
+                std::cerr << "Warning: Choice block found without preceding dialog on line " << rawLineNumber << " in " << filename << std::endl;
+                continue;
+            }
+
+            DialogLine& lastDialog = dialogLines.back(); // Choices belong to the most recently added dialog line
+            lastDialog.hasChoices = true;
+
+            // Reset all "next line should" flags and parameters for the *next* dialog line (after choices)
+            // This ensures effects don't carry over unintentionally if a choice leads to a new dialog line
+            nextLineShouldJitter = false;
+            nextLineShouldFall = false;
+            nextLineShouldFloat = false;
+            nextLineShouldPulse = false;
+            nextLinePulseDuration = 1500;
+            nextLinePulseFrequency = 2.0f;
+            nextLinePulseColor1 = {255,255,255,255};
+            nextLinePulseColor2 = {255,100,100,255};
+            nextLineShouldShake = false;
+            nextLineShakeDuration = 0;
+            nextLineShakeIntensity = 0.0f;
+            nextLineShouldTear = false;
+            nextLineTearDuration = 0;
+            nextLineTearMaxOffsetX = 0.0f;
+            nextLineTearLineDensity = 0.0f;
+
+            while (std::getline(file, line)) {
+                rawLineNumber++;
+                size_t choiceLineFirstChar = line.find_first_not_of(" \t\r\n");
+                if (choiceLineFirstChar == std::string::npos) continue;
+                trimmedLine = line.substr(choiceLineFirstChar);
+
+                if (trimmedLine == "]") break; // End of choice block
+                if (trimmedLine.rfind("#", 0) == 0) continue; // Skip comments in choice block
+
+                size_t firstQuote = trimmedLine.find('"');
+                size_t secondQuote = trimmedLine.find('"', firstQuote + 1);
+                size_t arrow = trimmedLine.find("->");
+
+                if (firstQuote == std::string::npos || secondQuote == std::string::npos || arrow == std::string::npos ||
+                    firstQuote >= secondQuote || secondQuote >= arrow) {
+                    std::cerr << "Warning: Malformed choice line " << rawLineNumber << " in " << filename << ": " << line << std::endl;
+                    continue;
+                }
+
+                Choice c;
+                c.text = trimmedLine.substr(firstQuote + 1, secondQuote - (firstQuote + 1));
+                std::string targetString = trimmedLine.substr(arrow + 2);
+                size_t colonPos = targetString.find(':');
+
+                if (colonPos != std::string::npos) {
+                    c.nextFile = targetString.substr(0, colonPos);
+                    try { c.nextDialogIndex = std::stoi(targetString.substr(colonPos + 1)); }
+                    catch (...) { std::cerr << "Invalid choice index in " << filename << " on line " << rawLineNumber << std::endl; c.nextDialogIndex = 0; }
+                } else {
+                    c.nextDialogIndex = 0;
+                    try {
+                        size_t end;
+                        int val = std::stoi(targetString, &end);
+                        if (end == targetString.length()) {
+                            c.nextDialogIndex = val;
+                            c.nextFile = "";
+                        } else {
+                            c.nextFile = targetString;
+                            c.nextDialogIndex = 0;
+                        }
+                    }
+                    catch (...) {
+                        std::cerr << "Invalid choice target in " << filename << " on line " << rawLineNumber << ": " << targetString << std::endl;
+                        c.nextDialogIndex = 0;
+                        c.nextFile = "";
+                    }
+                }
+
+                lastDialog.choices.push_back(c);
+            }
+            continue;
+        }
+        else if (trimmedLine == "[JITTER]") { nextLineShouldJitter = true; continue; }
+        else if (trimmedLine == "[FALL]") { nextLineShouldFall = true; continue; }
+        else if (trimmedLine == "[FLOAT]") { nextLineShouldFloat = true; continue; }
+        else if (trimmedLine.rfind("[PULSE", 0) == 0) {
+            size_t closeBracketPos = trimmedLine.find(']');
+            if (closeBracketPos == std::string::npos) {
+                std::cerr << "Warning: Malformed [PULSE] tag on line " << rawLineNumber << ": Missing ']' -> " << line << std::endl; continue;
+            }
+            std::string tagContent = trimmedLine.substr(0, closeBracketPos + 1);
+            std::istringstream iss(tagContent);
+            std::string tagStr;
+            int r1, g1, b1, a1, r2, g2, b2, a2;
+            Uint64 duration;
+            float frequency;
+            iss >> tagStr;
+            if (iss >> duration >> frequency >> r1 >> g1 >> b1 >> a1 >> r2 >> g2 >> b2 >> a2) {
+                 nextLineShouldPulse = true;
+                 nextLinePulseDuration = duration;
+                 nextLinePulseFrequency = frequency;
+                 nextLinePulseColor1 = {(Uint8)r1, (Uint8)g1, (Uint8)b1, (Uint8)a1};
+                 nextLinePulseColor2 = {(Uint8)r2, (Uint8)g2, (Uint8)b2, (Uint8)a2};
+            } else { std::cerr << "Warning: Malformed [PULSE] parameters on line " << rawLineNumber << ": " << line << std::endl; }
+            continue;
+        }
+        else if (trimmedLine.rfind("[SHAKE", 0) == 0) {
+            size_t closeBracketPos = trimmedLine.find(']');
+            if (closeBracketPos == std::string::npos) {
+                std::cerr << "Warning: Malformed [SHAKE] tag on line " << rawLineNumber << ": Missing ']' -> " << line << std::endl; continue;
+            }
+            std::string tagContent = trimmedLine.substr(0, closeBracketPos + 1);
+            std::istringstream iss(tagContent);
+            std::string tagStr;
+            Uint64 duration;
+            float intensity;
+            iss >> tagStr;
+            if (iss >> duration >> intensity) {
+                 nextLineShouldShake = true;
+                 nextLineShakeDuration = duration;
+                 nextLineShakeIntensity = intensity;
+            } else { std::cerr << "Warning: Malformed [SHAKE] parameters on line " << rawLineNumber << ": " << line << std::endl; }
+            continue;
+        }
+        else if (trimmedLine.rfind("[TEAR", 0) == 0) {
+            size_t closeBracketPos = trimmedLine.find(']');
+            if (closeBracketPos == std::string::npos) {
+                std::cerr << "Warning: Malformed [TEAR] tag on line " << rawLineNumber << ": Missing ']' -> " << line << std::endl; continue;
+            }
+            std::string tagContent = trimmedLine.substr(0, closeBracketPos + 1);
+            std::istringstream iss(tagContent);
+            std::string tagStr;
+            Uint32 duration;
+            float maxOffsetX;
+            float density;
+            iss >> tagStr;
+            if (iss >> duration >> maxOffsetX >> density) {
+                 nextLineShouldTear = true;
+                 nextLineTearDuration = duration;
+                 nextLineTearMaxOffsetX = maxOffsetX;
+                 nextLineTearLineDensity = density;
+            } else { std::cerr << "Warning: Malformed [TEAR] parameters on line " << rawLineNumber << ": " << line << std::endl; }
+            continue;
+        }
+
+
+        size_t speakerQuoteEnd = trimmedLine.find('\'', 1);
+        if (trimmedLine.front() == '\'' && speakerQuoteEnd != std::string::npos) {
+            currentSpeaker = trimmedLine.substr(1, speakerQuoteEnd - 1);
+            trimmedLine = trimmedLine.substr(speakerQuoteEnd + 1);
+            size_t recheckedFirstChar = trimmedLine.find_first_not_of(" \t\r\n");
+            if (recheckedFirstChar != std::string::npos) trimmedLine = trimmedLine.substr(recheckedFirstChar);
+            else trimmedLine = "";
+        }
+
+        size_t dialogQuoteEnd = trimmedLine.find('"', 1);
+        if (trimmedLine.front() == '"' && dialogQuoteEnd != std::string::npos) {
+            DialogLine dl;
+            dl.speakerName = currentSpeaker;
+            dl.dialogText = trimmedLine.substr(1, dialogQuoteEnd - 1);
+            dl.hasChoices = false;
+
+            dl.applyJitter = nextLineShouldJitter;
+            dl.applyFall = nextLineShouldFall;
+            dl.applyFloat = nextLineShouldFloat;
+            dl.applyPulse = nextLineShouldPulse;
+            dl.pulseDurationMs = nextLinePulseDuration;
+            dl.pulseFrequencyHz = nextLinePulseFrequency;
+            dl.pulseColor1 = nextLinePulseColor1;
+            dl.pulseColor2 = nextLinePulseColor2;
+            dl.applyShake = nextLineShouldShake;
+            dl.shakeDuration = nextLineShakeDuration;
+            dl.shakeIntensity = nextLineShakeIntensity;
+            dl.applyTear = nextLineShouldTear;
+            dl.tearDuration = nextLineTearDuration;
+            dl.tearMaxOffsetX = nextLineTearMaxOffsetX;
+            dl.tearLineDensity = nextLineTearLineDensity;
+            dl.physicsActive = false;
+
+
+            dialogLines.push_back(dl);
+
+            // Reset "next line should" flags and parameters for the *next* iteration
+            nextLineShouldJitter = false;
+            nextLineShouldFall = false;
+            nextLineShouldFloat = false;
+            nextLineShouldPulse = false;
+            nextLinePulseDuration = 1500;
+            nextLinePulseFrequency = 2.0f;
+            nextLinePulseColor1 = {255,255,255,255};
+            nextLinePulseColor2 = {255,100,100,255};
+            nextLineShouldShake = false;
+            nextLineShakeDuration = 0;
+            nextLineShakeIntensity = 0.0f;
+            nextLineShouldTear = false;
+            nextLineTearDuration = 0;
+            nextLineTearMaxOffsetX = 0.0f;
+            nextLineTearLineDensity = 0.0f;
+        } else {
+            std::cerr << "Warning: Unrecognized line format on line " << rawLineNumber << " in " << filename << ": " << line << std::endl;
+        }
+    }
+}
+
+} // namespace baseline
+
+// The tokenizer alone, walking the script the way loadStory does now (no DialogLines built)
+ParseTally parseWithTokenizer(std::string_view script) {
+    ParseTally tally;
+    StoryTokenizer tokenizer(script);
+    StoryToken token;
+    StoryChoiceToken choice;
+    bool inChoices = false;
+    while (tokenizer.next(token)) {
+        switch (token.kind) {
+            case STORY_LINE_CHOICE_OPEN:
+                inChoices = true;
+                break;
+            case STORY_LINE_CHOICE_CLOSE:
+                inChoices = false;
+                break;
+            case STORY_LINE_TAG: {
+                std::string_view args;
+                float value;
+                if (getStoryTagArgs(token, args)) {
+                    while (parseStoryNumber(args, value)) {}
+                }
+                tally.tags++;
+                break;
+            }
+            case STORY_LINE_DIALOG:
+            case STORY_LINE_OTHER:
+                if (inChoices) {
+                    std::string_view file, label;
+                    int lineIndex = 0;
+                    if (parseStoryChoiceLine(token.text, choice)) {
+                        if (parseStoryTarget(choice.target, file, label, lineIndex) && file.empty() && label.empty()) tally.targetSum += lineIndex;
+                        tally.dialogBytes += choice.text.size();
+                        tally.choices++;
+                    }
+                    break;
+                }
+                if (token.kind == STORY_LINE_DIALOG) {
+                    tally.dialogBytes += token.dialog.size();
+                    tally.dialogLines++;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return tally;
+}
+
+ParseTally tallyBaseline(const std::vector<baseline::DialogLine>& dialogLines) {
+    ParseTally tally;
+    for (const baseline::DialogLine& dl : dialogLines) {
+        tally.dialogLines++;
+        tally.dialogBytes += dl.dialogText.size();
+        for (const baseline::Choice& c : dl.choices) {
+            if (c.nextFile.empty()) tally.targetSum += c.nextDialogIndex;
+            tally.dialogBytes += c.text.size();
+            tally.choices++;
+        }
+    }
+    return tally;
+}
+
+} // namespace
+
+int runStoryParseBenchmark(int lineCount) {
+    if (lineCount < 1000) lineCount = 1000;
+
+    const std::string script = makeSyntheticScript(lineCount);
+    const double megabytes = (double)script.size() / (1024.0 * 1024.0);
+    std::cout << "Story parse benchmark: " << lineCount << " lines, " << megabytes << " MiB" << std::endl;
+
+    // Best of a few runs each, so one slow run (page faults, a busy core) doesn't decide it
+    const int RUNS = 3;
+    Uint64 baselineNS = ~0ull;
+    Uint64 tokenizerNS = ~0ull;
+    std::vector<baseline::DialogLine> baselineLines;
+    ParseTally tokenizerTally;
+    for (int run = 0; run < RUNS; ++run) {
+        std::istringstream in(script);
+        Uint64 startNS = SDL_GetTicksNS();
+        baseline::loadStory(in, "story_parse_benchmark.txt", baselineLines);
+        baselineNS = std::min(baselineNS, SDL_GetTicksNS() - startNS);
+
+        startNS = SDL_GetTicksNS();
+        tokenizerTally = parseWithTokenizer(script);
+        tokenizerNS = std::min(tokenizerNS, SDL_GetTicksNS() - startNS);
+    }
+    const ParseTally baselineTally = tallyBaseline(baselineLines);
+    if (!baselineTally.matches(tokenizerTally)) {
+        std::cerr << "Warning: Benchmark parsers disagree (" << baselineTally.dialogLines << " vs "
+                  << tokenizerTally.dialogLines << " dialog lines, " << baselineTally.choices << " vs "
+                  << tokenizerTally.choices << " choices)" << std::endl;
+        return 1;
+    }
+
+    auto report = [&](const char* name, Uint64 ns) {
+        const double seconds = (double)ns / 1e9;
+        std::cout << "  " << name << ": " << ns / 1000000.0 << " ms ("
+                  << (seconds > 0.0 ? lineCount / seconds / 1e6 : 0.0) << " M lines/s, "
+                  << (seconds > 0.0 ? megabytes / seconds : 0.0) << " MiB/s)" << std::endl;
+    };
+    std::cout << "  " << tokenizerTally.dialogLines << " dialog lines, " << tokenizerTally.tags << " tags, "
+              << tokenizerTally.choices << " choices" << std::endl;
+    report("old loadStory parse loop", baselineNS);
+    report("tokenizer alone", tokenizerNS);
+
+    // The whole loader on the same script, without fonts (choices and names aren't laid out).
+    // It builds DialogLines like the old loop did, and also reads the file from disk, which the
+    // old loop above was spared; this is the like-for-like comparison.
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "story_parse_benchmark.txt";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << script;
+        if (!out) {
+            std::cerr << "Warning: Could not write benchmark script " << path.string() << std::endl;
+            return 1;
+        }
+    }
+    StoryManager story(nullptr, nullptr, nullptr, nullptr);
+    story.setStreamingThreshold(~0ull); // Load it all, like a script under the threshold
+    const Uint64 startNS = SDL_GetTicksNS();
+    const bool loaded = story.loadStory(path.string());
+    const Uint64 loadNS = SDL_GetTicksNS() - startNS;
+    report("loadStory", loadNS);
+    std::error_code removeError;
+    std::filesystem::remove(path, removeError);
+    if (!loaded) return 1;
+    if (story.getDialogLineCount() != baselineTally.dialogLines) {
+        std::cerr << "Warning: loadStory found " << story.getDialogLineCount() << " dialog lines, the old parser "
+                  << baselineTally.dialogLines << std::endl;
+        return 1;
+    }
+    std::cout << "  loadStory vs old parse loop: " << (loadNS > 0 ? (double)baselineNS / (double)loadNS : 0.0) << "x" << std::endl;
+    return 0;
+}
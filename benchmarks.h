@@ -0,0 +1,15 @@
+// benchmarks.h - Command-line micro-benchmarks for engine hot paths
+#pragma once
+
+// --- Story VM Benchmark ---
+// Compiles a synthetic script of at least `instructionCount` bytecode instructions (statements
+// and choice conditions, through the same compiler loadStory uses), then times the interpreter.
+// Prints instructions per second and returns 0, or 1 if the synthetic script failed to compile.
+int runStoryVmBenchmark(int instructionCount);
+
+// --- Story Parse Benchmark ---
+// Generates a synthetic script of `lineCount` lines and times the parse loop of the old loadStory
+// (kept in benchmarks.cpp as it was), the story tokenizer alone, and a whole loadStory of the
+// script. Prints lines and MiB per second; returns 0, or 1 if the parsers disagree or the script
+// can't be loaded.
+int runStoryParseBenchmark(int lineCount);
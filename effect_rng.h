@@ -0,0 +1,71 @@
+// effect_rng.h - Small, fast, deterministic random number streams for effects
+#pragma once
+#include <SDL3/SDL.h>       // For Uint32, Uint64
+#include <string>           // For std::string
+
+// --- Effect IDs ---
+// Mixed into the seed so every effect on a line gets its own independent stream.
+enum EffectRngId : Uint32 {
+    EFFECT_RNG_NONE = 0,     // For effects that draw no random numbers
+    EFFECT_RNG_JITTER = 1,
+    EFFECT_RNG_PHYSICS = 2,
+    EFFECT_RNG_SHAKE = 3,
+    EFFECT_RNG_TEAR = 4
+};
+
+// --- EffectRng ---
+// xoshiro128** generator. Each effect owns one of these instead of sharing the global rand(),
+// so effects never contend on one RNG and a given seed always reproduces the same sequence.
+struct EffectRng {
+    Uint32 s[4] = {0x9E3779B9u, 0x243F6A88u, 0xB7E15162u, 0x85A308D3u};
+
+    // Seeds the four state words from one 64-bit value via splitmix64 (never yields all-zero state).
+    void seed(Uint64 value) {
+        for (int i = 0; i < 4; i += 2) {
+            value += 0x9E3779B97F4A7C15ull;
+            Uint64 z = value;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z = z ^ (z >> 31);
+            s[i] = (Uint32)z;
+            s[i + 1] = (Uint32)(z >> 32);
+        }
+    }
+
+    Uint32 next() {
+        const Uint32 result = rotl(s[1] * 5, 7) * 9;
+        const Uint32 t = s[1] << 9;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 11);
+        return result;
+    }
+
+    // Uniform float in [0, 1), built from the top 24 bits.
+    float nextFloat() {
+        return (float)(next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Uniform float in [minValue, maxValue).
+    float range(float minValue, float maxValue) {
+        return minValue + nextFloat() * (maxValue - minValue);
+    }
+
+private:
+    static Uint32 rotl(Uint32 x, int k) { return (x << k) | (x >> (32 - k)); }
+};
+
+// Builds a seed from the story file, dialog line index and effect, so a given line's effects
+// look the same on every run no matter what happened before it.
+inline Uint64 makeEffectSeed(const std::string& storyFile, size_t lineIndex, EffectRngId effect) {
+    Uint64 hash = 0xCBF29CE484222325ull; // FNV-1a over the file name
+    for (unsigned char c : storyFile) {
+        hash = (hash ^ c) * 0x100000001B3ull;
+    }
+    hash ^= (Uint64)lineIndex * 0x9E3779B97F4A7C15ull;
+    hash ^= (Uint64)effect << 56;
+    return hash;
+}
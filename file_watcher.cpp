@@ -0,0 +1,123 @@
+// file_watcher.cpp - Implementation of the story file watcher
+#include "file_watcher.h"   // Include the corresponding header
+#include <algorithm>        // For std::find
+#include <filesystem>       // For std::filesystem::path, last_write_time
+#include <iostream>         // For std::cerr
+#ifdef __linux__
+#include <sys/inotify.h>    // For inotify_init1, inotify_add_watch, inotify_event
+#include <unistd.h>         // For read, close
+#endif
+
+namespace {
+
+// Modification time as a plain number, or -1 if the file can't be read (e.g. mid-rename)
+Sint64 getModifiedTime(const std::string& path) {
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(path, error);
+    return error ? -1 : (Sint64)time.time_since_epoch().count();
+}
+
+void addChanged(const std::string& path, std::vector<std::string>& changed) {
+    if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+        changed.push_back(path); // An editor's save is several events; report it once
+    }
+}
+
+} // namespace
+
+// --- FileWatcher ---
+FileWatcher::~FileWatcher() {
+    close();
+}
+
+void FileWatcher::open() {
+    close();
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        std::cerr << "Warning: inotify unavailable, polling watched files instead" << std::endl;
+    }
+#endif
+    opened = true;
+}
+
+void FileWatcher::watch(const std::string& path) {
+    if (!opened || path.empty()) return;
+    for (const WatchedFile& file : files) {
+        if (file.path == path) return;
+    }
+
+    const std::filesystem::path fsPath(path);
+    WatchedFile file;
+    file.path = path;
+    file.name = fsPath.filename().string();
+    file.watchDescriptor = -1;
+    file.modifiedTime = getModifiedTime(path);
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        const std::string directory = fsPath.has_parent_path() ? fsPath.parent_path().string() : ".";
+        // Closed after writing, or renamed into place; directories already watched return their descriptor
+        file.watchDescriptor = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (file.watchDescriptor < 0) {
+            std::cerr << "Warning: Could not watch " << directory << " for changes to " << path << std::endl;
+        }
+    }
+#endif
+    files.push_back(file);
+}
+
+void FileWatcher::poll(Uint64 nowNS, std::vector<std::string>& changed) {
+    if (!opened) return;
+
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        for (;;) {
+            const ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) break; // EAGAIN: nothing more this poll
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = (const inotify_event*)(buffer + offset);
+                offset += (ssize_t)(sizeof(inotify_event) + event->len);
+                if (event->mask & IN_Q_OVERFLOW) {
+                    for (const WatchedFile& file : files) addChanged(file.path, changed); // Events lost: assume all
+                    continue;
+                }
+                if (event->len == 0) continue;
+                for (const WatchedFile& file : files) {
+                    if (file.watchDescriptor == event->wd && file.name == event->name) {
+                        addChanged(file.path, changed);
+                    }
+                }
+            }
+        }
+        // Files whose directory couldn't be watched fall through to polling
+        bool anyUnwatched = false;
+        for (const WatchedFile& file : files) {
+            if (file.watchDescriptor < 0) anyUnwatched = true;
+        }
+        if (!anyUnwatched) return;
+    }
+#endif
+
+    if (nowNS - lastPollNS < POLL_INTERVAL_NS) return;
+    lastPollNS = nowNS;
+    for (WatchedFile& file : files) {
+        if (file.watchDescriptor >= 0) continue;
+        const Sint64 modifiedTime = getModifiedTime(file.path);
+        if (modifiedTime >= 0 && modifiedTime != file.modifiedTime) {
+            file.modifiedTime = modifiedTime;
+            addChanged(file.path, changed);
+        }
+    }
+}
+
+void FileWatcher::close() {
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        ::close(inotifyFd); // Drops every watch with it
+    }
+#endif
+    inotifyFd = -1;
+    files.clear();
+    opened = false;
+}
@@ -0,0 +1,44 @@
+// file_watcher.h - Notices when watched files are saved, for hot reloading story scripts
+#pragma once
+#include <SDL3/SDL.h>       // For Uint64, Sint64, SDL_NS_PER_MS
+#include <string>           // For std::string
+#include <vector>           // For std::vector
+
+// --- FileWatcher ---
+// On Linux the watcher uses inotify and costs one non-blocking read per poll. Elsewhere, or if
+// inotify is unavailable, it compares modification times a few times a second.
+// Editors often save by writing a temporary file and renaming it over the original, so inotify
+// watches each file's directory and matches the events by file name.
+class FileWatcher {
+public:
+    ~FileWatcher();
+
+    // Starts watching (with inotify if it's available, by polling otherwise).
+    void open();
+
+    // Adds a file to the watched set. Cheap to repeat: files already watched are skipped.
+    void watch(const std::string& path);
+
+    // Appends each watched file saved since the last poll (once, as passed to watch()) to
+    // `changed`. Never blocks. nowNS: current time, for pacing the polling fallback.
+    void poll(Uint64 nowNS, std::vector<std::string>& changed);
+
+    void close();
+
+    bool isOpen() const { return opened; }
+
+private:
+    struct WatchedFile {
+        std::string path;      // As given to watch()
+        std::string name;      // File name within its directory
+        int watchDescriptor;   // inotify watch of the directory, or -1
+        Sint64 modifiedTime;   // Polling fallback: last seen modification time
+    };
+
+    static const Uint64 POLL_INTERVAL_NS = 250 * SDL_NS_PER_MS; // Polling fallback only
+
+    bool opened = false;
+    int inotifyFd = -1;        // -1 when polling
+    Uint64 lastPollNS = 0;
+    std::vector<WatchedFile> files;
+};
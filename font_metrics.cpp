@@ -0,0 +1,67 @@
+// font_metrics.cpp - Implementation of the cached word measurement tables
+#include "font_metrics.h"   // Include the corresponding header
+#include <algorithm>        // For std::min, std::max
+
+void FontMetrics::bind(TTF_Font* newFont) {
+    if (!newFont) {
+        font = nullptr;
+        return;
+    }
+    const float newSize = TTF_GetFontSize(newFont);
+    const TTF_FontStyleFlags newStyle = TTF_GetFontStyle(newFont);
+    if (newFont == font && newSize == size && newStyle == style) return;
+
+    font = newFont;
+    size = newSize;
+    style = newStyle;
+    height = TTF_GetFontHeight(font);
+    wordWidths.clear();
+
+    for (int i = 0; i < GLYPH_COUNT; ++i) {
+        int advance = 0;
+        if (!TTF_GetGlyphMetrics(font, (Uint32)(FIRST_GLYPH + i), nullptr, nullptr, nullptr, nullptr, &advance)) {
+            advance = 0;
+        }
+        advances[i] = advance;
+    }
+    spaceWidth = advances[' ' - FIRST_GLYPH];
+
+    for (int previous = 0; previous < GLYPH_COUNT; ++previous) {
+        for (int current = 0; current < GLYPH_COUNT; ++current) {
+            int k = 0;
+            if (!TTF_GetGlyphKerning(font, (Uint32)(FIRST_GLYPH + previous), (Uint32)(FIRST_GLYPH + current), &k)) {
+                k = 0; // The font has no kerning
+            }
+            kerning[previous][current] = (Sint8)std::max(-128, std::min(127, k));
+        }
+    }
+}
+
+int FontMetrics::measure(std::string_view text) {
+    if (!font || text.empty()) return 0;
+
+    // Printable ASCII: sum the cached advances and pair kerning
+    int width = 0;
+    int previous = -1;
+    size_t i = 0;
+    for (; i < text.size(); ++i) {
+        const int c = (unsigned char)text[i];
+        if (c < FIRST_GLYPH || c >= FIRST_GLYPH + GLYPH_COUNT) break;
+        const int glyph = c - FIRST_GLYPH;
+        if (previous >= 0) width += kerning[previous][glyph];
+        width += advances[glyph];
+        previous = glyph;
+    }
+    if (i == text.size()) return width;
+
+    // Anything else is shaped by SDL_ttf once per distinct word
+    lookupWord.assign(text.data(), text.size());
+    auto it = wordWidths.find(lookupWord);
+    if (it != wordWidths.end()) return it->second;
+
+    int measured = 0;
+    TTF_GetStringSize(font, text.data(), text.size(), &measured, nullptr);
+    if (wordWidths.size() >= MAX_CACHED_WORDS) wordWidths.clear();
+    wordWidths.emplace(lookupWord, measured);
+    return measured;
+}
@@ -0,0 +1,43 @@
+// font_metrics.h - Cached glyph advances and kerning for measuring words without shaping them
+#pragma once
+#include <SDL3/SDL.h>       // For Uint64, Sint8
+#include <SDL3_ttf/SDL_ttf.h> // For TTF_Font, TTF_FontStyleFlags
+#include <string>           // For std::string
+#include <string_view>      // For std::string_view
+#include <unordered_map>    // For std::unordered_map
+
+// One FontMetrics per combination of TTF_STYLE_BOLD and TTF_STYLE_ITALIC, indexed by those bits
+const int FONT_METRICS_STYLES = 4;
+
+// --- FontMetrics ---
+// Word layout only needs widths. For printable ASCII those are sums of glyph advances plus pair
+// kerning, read from tables built once per font, size and style; any other word is measured with
+// TTF_GetStringSize once and remembered by its bytes, so a script's repeated words cost a table
+// lookup each. The tables and the word cache belong to the bound font, size and style.
+class FontMetrics {
+public:
+    // Uses `font` for the following calls, rebuilding the tables if the font, its size or its style
+    // changed since the last bind (otherwise this is a few compares).
+    void bind(TTF_Font* font);
+
+    // Width of `text` on one line, in pixels.
+    int measure(std::string_view text);
+
+    int getSpaceWidth() const { return spaceWidth; }
+    int getHeight() const { return height; }
+
+private:
+    static const int FIRST_GLYPH = 0x20; // Printable ASCII: ' ' ... '~'
+    static const int GLYPH_COUNT = 0x7F - FIRST_GLYPH;
+    static const size_t MAX_CACHED_WORDS = 65536; // The word cache starts over past this
+
+    TTF_Font* font = nullptr;
+    float size = 0.0f;
+    TTF_FontStyleFlags style = 0;
+    int spaceWidth = 0;
+    int height = 0;
+    int advances[GLYPH_COUNT] = {};
+    Sint8 kerning[GLYPH_COUNT][GLYPH_COUNT] = {}; // kerning[previous][current]
+    std::unordered_map<std::string, int> wordWidths; // Word -> width
+    std::string lookupWord;                        // Reused for lookups, so a hit doesn't allocate
+};
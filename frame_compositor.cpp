@@ -0,0 +1,105 @@
+// frame_compositor.cpp - Implementation of the retained frame compositor
+#include "frame_compositor.h" // Include the corresponding header
+#include <iostream>         // For std::cerr
+#include <cmath>            // For std::floor, std::ceil
+#include <algorithm>        // For std::min, std::max
+#include "render_stats.h"   // For counted draw calls and texture creation
+
+// Dirty rects are grown by this many pixels so antialiased text edges and 1px borders that
+// straddle a rect's edge are redrawn too.
+static const int DIRTY_MARGIN = 2;
+
+FrameCompositor::FrameCompositor()
+    : renderer(nullptr), frame(nullptr), width(0), height(0), fullRedraw(true), hasDirty(false),
+      dirtyBounds{0, 0, 0, 0}, framesRedrawn(0), framesSkipped(0), pixelsRedrawn(0) {}
+
+FrameCompositor::~FrameCompositor() {
+    destroy();
+}
+
+bool FrameCompositor::create(SDL_Renderer* targetRenderer, int frameWidth, int frameHeight) {
+    destroy();
+    renderer = targetRenderer;
+    width = frameWidth;
+    height = frameHeight;
+    frame = countedCreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+    if (!frame) {
+        std::cerr << "Warning: Retained compositing unavailable, redrawing full frames! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    SDL_SetTextureBlendMode(frame, SDL_BLENDMODE_NONE); // The frame replaces the window contents
+    fullRedraw = true;
+    return true;
+}
+
+void FrameCompositor::destroy() {
+    if (frame) {
+        countedDestroyTexture(frame);
+        frame = nullptr;
+    }
+}
+
+bool FrameCompositor::resize(int frameWidth, int frameHeight) {
+    if (!renderer) return false;
+    return create(renderer, frameWidth, frameHeight);
+}
+
+void FrameCompositor::invalidate() {
+    fullRedraw = true;
+}
+
+void FrameCompositor::addDirtyRect(const SDL_FRect& rect) {
+    if (rect.w <= 0.0f || rect.h <= 0.0f) return;
+    int x0 = (int)std::floor(rect.x) - DIRTY_MARGIN;
+    int y0 = (int)std::floor(rect.y) - DIRTY_MARGIN;
+    int x1 = (int)std::ceil(rect.x + rect.w) + DIRTY_MARGIN;
+    int y1 = (int)std::ceil(rect.y + rect.h) + DIRTY_MARGIN;
+    if (hasDirty) {
+        x0 = std::min(x0, dirtyBounds.x);
+        y0 = std::min(y0, dirtyBounds.y);
+        x1 = std::max(x1, dirtyBounds.x + dirtyBounds.w);
+        y1 = std::max(y1, dirtyBounds.y + dirtyBounds.h);
+    }
+    dirtyBounds = {x0, y0, x1 - x0, y1 - y0};
+    hasDirty = true;
+}
+
+bool FrameCompositor::beginFrame(SDL_Color background) {
+    SDL_Rect clip = {0, 0, width, height};
+    if (!fullRedraw) {
+        if (!hasDirty) {
+            framesSkipped++;
+            return false;
+        }
+        // Only the part of the dirty bounds inside the frame
+        int x0 = std::max(dirtyBounds.x, 0);
+        int y0 = std::max(dirtyBounds.y, 0);
+        int x1 = std::min(dirtyBounds.x + dirtyBounds.w, width);
+        int y1 = std::min(dirtyBounds.y + dirtyBounds.h, height);
+        if (x1 <= x0 || y1 <= y0) {
+            hasDirty = false;
+            framesSkipped++;
+            return false;
+        }
+        clip = {x0, y0, x1 - x0, y1 - y0};
+    }
+
+    SDL_SetRenderTarget(renderer, frame);
+    SDL_SetRenderClipRect(renderer, &clip);
+    SDL_SetRenderDrawColor(renderer, background.r, background.g, background.b, background.a);
+    SDL_FRect clearRect = {(float)clip.x, (float)clip.y, (float)clip.w, (float)clip.h};
+    countedRenderFillRect(renderer, &clearRect); // RenderClear would ignore the clip rect
+
+    pixelsRedrawn += (Uint64)clip.w * (Uint64)clip.h;
+    framesRedrawn++;
+    fullRedraw = false;
+    hasDirty = false;
+    return true;
+}
+
+void FrameCompositor::endFrame() {
+    SDL_SetRenderClipRect(renderer, nullptr);
+    SDL_SetRenderTarget(renderer, nullptr);
+    countedRenderTexture(renderer, frame, nullptr, nullptr);
+    SDL_RenderPresent(renderer);
+}
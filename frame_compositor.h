@@ -0,0 +1,57 @@
+// frame_compositor.h - Retained frame texture redrawn only inside dirty rectangles
+#pragma once
+#include <SDL3/SDL.h>       // For SDL_Renderer, SDL_Texture, SDL_FRect, SDL_Rect, SDL_Color
+
+// --- FrameCompositor ---
+// Keeps the composed scene in a render-target texture that persists between frames. Each frame,
+// only the bounds of the reported dirty rectangles are cleared and redrawn (the renderer's clip
+// rect discards everything else), and nothing is presented at all when no rectangle was reported.
+// invalidate() forces a full redraw, for resizes, expose events and frames where shake or tear
+// moves everything.
+//
+// Typical frame:
+//     if (story.collectDirtyRects(rects)) compositor.invalidate();
+//     for (const SDL_FRect& r : rects) compositor.addDirtyRect(r);
+//     if (compositor.beginFrame(background)) { story.render(...); compositor.endFrame(); }
+class FrameCompositor {
+public:
+    FrameCompositor();
+    ~FrameCompositor();
+
+    // Creates the frame texture. Returns false if the renderer can't render to textures,
+    // in which case the caller should keep redrawing whole frames.
+    bool create(SDL_Renderer* renderer, int width, int height);
+    void destroy();
+    bool isActive() const { return frame != nullptr; }
+
+    // Recreates the texture for a new window size (which also forces a full redraw).
+    bool resize(int width, int height);
+
+    void invalidate();
+    void addDirtyRect(const SDL_FRect& rect);
+
+    // Starts drawing into the frame texture, clipped to the dirty bounds which are cleared to
+    // `background` first. Returns false (and draws nothing) if nothing is dirty.
+    bool beginFrame(SDL_Color background);
+
+    // Restores the window as render target, copies the frame texture to it and presents.
+    void endFrame();
+
+    // --- Stats ---
+    Uint64 getFramesRedrawn() const { return framesRedrawn; }
+    Uint64 getFramesSkipped() const { return framesSkipped; }
+    Uint64 getPixelsRedrawn() const { return pixelsRedrawn; }
+
+private:
+    SDL_Renderer* renderer;
+    SDL_Texture* frame;
+    int width;
+    int height;
+    bool fullRedraw;
+    bool hasDirty;
+    SDL_Rect dirtyBounds;    // Union of the dirty rects, in whole pixels
+
+    Uint64 framesRedrawn;
+    Uint64 framesSkipped;
+    Uint64 pixelsRedrawn;
+};
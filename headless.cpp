@@ -0,0 +1,57 @@
+// headless.cpp - Implementation of offscreen render targets
+#include "headless.h"       // Include the corresponding header
+#include <mutex>            // For std::mutex (font loading)
+#include "text_ui.h"        // For fontstr
+
+// FreeType's library handle is shared by all fonts, so fonts are opened and closed one at a time.
+static std::mutex fontMutex;
+
+bool createOffscreenTarget(OffscreenTarget& target, int width, int height) {
+    target.surface = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
+    target.renderer = target.surface ? SDL_CreateSoftwareRenderer(target.surface) : nullptr;
+    target.textEngine = target.renderer ? TTF_CreateRendererTextEngine(target.renderer) : nullptr;
+    {
+        std::lock_guard<std::mutex> lock(fontMutex);
+        target.dialogFont = TTF_OpenFont(fontstr, 24);     // Same sizes as initSDL in main.cpp
+        target.nameFont = TTF_OpenFont("Nasa21.ttf", 20);
+    }
+
+    if (!target.surface || !target.renderer || !target.textEngine || !target.dialogFont || !target.nameFont) {
+        destroyOffscreenTarget(target);
+        return false;
+    }
+
+    SDL_SetRenderDrawBlendMode(target.renderer, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+void destroyOffscreenTarget(OffscreenTarget& target) {
+    {
+        std::lock_guard<std::mutex> lock(fontMutex);
+        if (target.dialogFont) TTF_CloseFont(target.dialogFont);
+        if (target.nameFont) TTF_CloseFont(target.nameFont);
+    }
+    if (target.textEngine) TTF_DestroyRendererTextEngine(target.textEngine);
+    if (target.renderer) SDL_DestroyRenderer(target.renderer);
+    if (target.surface) SDL_DestroySurface(target.surface);
+    target = OffscreenTarget();
+}
+
+void clearOffscreenTarget(OffscreenTarget& target) {
+    SDL_SetRenderDrawColor(target.renderer, 0x20, 0x20, 0x20, 0xFF); // Same background as the main loop
+    SDL_RenderClear(target.renderer);
+}
+
+Uint64 hashSurfacePixels(SDL_Surface* surface) {
+    Uint64 hash = 0xCBF29CE484222325ull;
+    if (!surface || !surface->pixels) return hash;
+
+    const int rowBytes = surface->w * 4; // Offscreen targets are always 32-bit RGBA
+    const Uint8* row = (const Uint8*)surface->pixels;
+    for (int y = 0; y < surface->h; ++y, row += surface->pitch) {
+        for (int x = 0; x < rowBytes; ++x) {
+            hash = (hash ^ row[x]) * 0x100000001B3ull;
+        }
+    }
+    return hash;
+}
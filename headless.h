@@ -0,0 +1,29 @@
+// headless.h - Offscreen (software-rendered) targets shared by batch rendering and replay
+#pragma once
+#include <SDL3/SDL.h>       // For SDL_Surface, SDL_Renderer, Uint64
+#include <SDL3_ttf/SDL_ttf.h> // For TTF_Font, TTF_TextEngine
+
+// --- OffscreenTarget ---
+// A complete private rendering stack drawing into a memory surface instead of a window.
+// Every thread that renders gets its own, since renderers and fonts are not shared across threads.
+struct OffscreenTarget {
+    SDL_Surface* surface = nullptr;
+    SDL_Renderer* renderer = nullptr;
+    TTF_TextEngine* textEngine = nullptr;
+    TTF_Font* dialogFont = nullptr;
+    TTF_Font* nameFont = nullptr;
+};
+
+// Creates the surface, software renderer, text engine and fonts (same fonts and sizes as initSDL).
+// Safe to call from several threads at once. On failure everything created so far is released.
+bool createOffscreenTarget(OffscreenTarget& target, int width, int height);
+
+// Releases everything created by createOffscreenTarget. Safe to call on a partially created target.
+void destroyOffscreenTarget(OffscreenTarget& target);
+
+// Clears the target to the main loop's background color before a frame is rendered into it.
+void clearOffscreenTarget(OffscreenTarget& target);
+
+// 64-bit FNV-1a hash of the visible pixels of a surface (row padding is skipped),
+// used to compare frames bit-for-bit between runs.
+Uint64 hashSurfacePixels(SDL_Surface* surface);
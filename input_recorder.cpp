@@ -0,0 +1,243 @@
+// input_recorder.cpp - Implementation of input recording and headless replay
+#include "input_recorder.h" // Include the corresponding header
+#include <iostream>         // For std::cout, std::cerr
+#include <sstream>          // For std::istringstream
+#include <vector>           // For std::vector
+#include <cinttypes>        // For PRIx64
+#include <cstdio>           // For std::fprintf
+
+#include "StoryManager.h"   // The replayed story
+#include "headless.h"       // For OffscreenTarget, hashSurfacePixels
+#include "text_ui.h"        // For winWidth, winHeight
+#include "sim_clock.h"      // For FixedStepClock
+#include "backlog_view.h"   // For BacklogView (it takes input from the story while open)
+#include "story_diagnostics.h" // For flushDiagnostics
+
+// --- InputRecorder ---
+bool InputRecorder::open(const std::string& path, const std::string& storyFile, int width, int height) {
+    out.open(path, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open input recording for writing: " << path << std::endl;
+        return false;
+    }
+    out << "VNREC 2 " << width << ' ' << height << ' ' << storyFile << '\n';
+    return true;
+}
+
+void InputRecorder::recordFrame(Uint64 frameTimeNS) {
+    if (out.is_open()) {
+        out << "F " << frameTimeNS << '\n';
+    }
+}
+
+void InputRecorder::recordEvent(const SDL_Event& event) {
+    if (!out.is_open()) return;
+
+    switch (event.type) {
+        case SDL_EVENT_KEY_DOWN:
+        case SDL_EVENT_KEY_UP:
+            out << "E " << event.type << ' ' << event.key.key << ' ' << event.key.mod << " 0 "
+                << (event.key.repeat ? 1 : 0) << " 0\n";
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            out << "E " << event.type << " 0 0 " << (int)event.button.button << ' '
+                << event.button.x << ' ' << event.button.y << '\n';
+            break;
+        case SDL_EVENT_MOUSE_WHEEL:
+            out << "E " << event.type << " 0 0 0 " << event.wheel.x << ' ' << event.wheel.y << '\n';
+            break;
+        case SDL_EVENT_WINDOW_RESIZED:
+            out << "E " << event.type << " 0 0 0 " << event.window.data1 << ' ' << event.window.data2 << '\n';
+            break;
+        case SDL_EVENT_QUIT:
+            out << "E " << event.type << " 0 0 0 0 0\n";
+            break;
+        default:
+            break; // Not something the story reacts to
+    }
+}
+
+void InputRecorder::close() {
+    if (out.is_open()) {
+        out.flush();
+        out.close();
+    }
+}
+
+// --- Replay ---
+struct ReplayFrame {
+    Uint64 timeNS;
+    std::vector<SDL_Event> events;
+};
+
+// Rebuilds an SDL_Event from one "E ..." record. Returns false for malformed records.
+static bool parseRecordedEvent(std::istringstream& iss, SDL_Event& event) {
+    Uint32 type, key, mod, button;
+    float x, y;
+    if (!(iss >> type >> key >> mod >> button >> x >> y)) {
+        return false;
+    }
+
+    SDL_zero(event);
+    event.type = type;
+    switch (type) {
+        case SDL_EVENT_KEY_DOWN:
+        case SDL_EVENT_KEY_UP:
+            event.key.key = key;
+            event.key.mod = (SDL_Keymod)mod;
+            event.key.down = (type == SDL_EVENT_KEY_DOWN);
+            event.key.repeat = (x != 0.0f);
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            event.button.button = (Uint8)button;
+            event.button.down = (type == SDL_EVENT_MOUSE_BUTTON_DOWN);
+            event.button.x = x;
+            event.button.y = y;
+            break;
+        case SDL_EVENT_MOUSE_WHEEL:
+            event.wheel.x = x;
+            event.wheel.y = y;
+            break;
+        case SDL_EVENT_WINDOW_RESIZED:
+            event.window.data1 = (Sint32)x;
+            event.window.data2 = (Sint32)y;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+int runReplay(const std::string& recordingPath, const std::string& hashOutputPath) {
+    std::ifstream in(recordingPath);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open input recording: " << recordingPath << std::endl;
+        return 1;
+    }
+
+    // --- Parse the whole recording up front so replay timing only measures the frames ---
+    std::string line;
+    std::string magic, storyFile;
+    int version = 0, width = 0, height = 0;
+    if (!std::getline(in, line)) {
+        std::cerr << "Empty input recording: " << recordingPath << std::endl;
+        return 1;
+    }
+    {
+        std::istringstream header(line);
+        header >> magic >> version >> width >> height;
+        std::getline(header >> std::ws, storyFile);
+    }
+    if (magic != "VNREC" || version != 2 || width <= 0 || height <= 0 || storyFile.empty()) {
+        std::cerr << "Unsupported input recording header in " << recordingPath << ": " << line << std::endl;
+        return 1;
+    }
+
+    std::vector<ReplayFrame> frames;
+    int recordLine = 1;
+    while (std::getline(in, line)) {
+        recordLine++;
+        std::istringstream iss(line);
+        char kind;
+        if (!(iss >> kind)) continue;
+        if (kind == 'F') {
+            ReplayFrame frame;
+            if (iss >> frame.timeNS) frames.push_back(frame);
+        } else if (kind == 'E' && !frames.empty()) {
+            SDL_Event event;
+            if (parseRecordedEvent(iss, event)) frames.back().events.push_back(event);
+            else std::cerr << "Warning: Malformed event on line " << recordLine << " of " << recordingPath << std::endl;
+        }
+    }
+
+    // --- Headless playback ---
+    // No window: the replay draws with a software renderer into a surface, so SDL needs no subsystems
+    if (!SDL_Init(0)) {
+        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+    if (!TTF_Init()) {
+        std::cerr << "SDL_ttf could not initialize! TTF_Error: " << SDL_GetError() << std::endl;
+        SDL_Quit();
+        return 1;
+    }
+    winWidth = width;
+    winHeight = height;
+
+    OffscreenTarget target;
+    if (!createOffscreenTarget(target, width, height)) {
+        std::cerr << "Failed to create offscreen replay target: " << SDL_GetError() << std::endl;
+        TTF_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    FILE* hashOut = hashOutputPath.empty() ? nullptr : std::fopen(hashOutputPath.c_str(), "w");
+    Uint64 runHash = 0xCBF29CE484222325ull;
+    size_t framesPlayed = 0;
+    Uint64 replayStartNS = SDL_GetTicksNS();
+    int result = 0;
+    {
+        StoryManager storyManager(target.renderer, target.dialogFont, target.nameFont, target.textEngine);
+        BacklogView backlogView; // Destroyed with its textures before the target
+        FixedStepClock simClock;
+        simClock.reset(frames.empty() ? 0 : frames.front().timeNS);
+        storyManager.setClock(simClock.simTimeNS);
+        if (!storyManager.loadStory(storyFile)) {
+            result = 1;
+        } else {
+            for (const ReplayFrame& frame : frames) {
+                // Same per-frame sequence as the interactive loop in main.cpp
+                bool quit = false;
+                for (const SDL_Event& event : frame.events) {
+                    if (event.type == SDL_EVENT_QUIT) {
+                        quit = true;
+                    }
+                    if (event.type == SDL_EVENT_WINDOW_RESIZED) {
+                        // The offscreen surface keeps its recorded size; layout still follows the event.
+                        winWidth = event.window.data1;
+                        winHeight = event.window.data2;
+                        storyManager.handleWindowResize(winWidth, winHeight);
+                    }
+                    if (!backlogView.handleInput(event)) {
+                        storyManager.handleInput(event);
+                    }
+                }
+
+                simClock.advance(frame.timeNS);
+                while (simClock.step()) {
+                    storyManager.fixedUpdate(simClock.simTimeNS, simClock.stepSeconds());
+                }
+
+                clearOffscreenTarget(target);
+                storyManager.render(simClock.renderTimeNS(), simClock.alpha());
+                backlogView.render(target.renderer, target.dialogFont, storyManager);
+                SDL_FlushRenderer(target.renderer);
+
+                Uint64 frameHash = hashSurfacePixels(target.surface);
+                runHash = (runHash ^ frameHash) * 0x100000001B3ull;
+                if (hashOut) std::fprintf(hashOut, "%zu %016" PRIx64 "\n", framesPlayed, frameHash);
+                framesPlayed++;
+
+                if (quit) break;
+            }
+        }
+    }
+    Uint64 replayNS = SDL_GetTicksNS() - replayStartNS;
+
+    if (hashOut) std::fclose(hashOut);
+    destroyOffscreenTarget(target);
+    TTF_Quit();
+    SDL_Quit();
+    flushDiagnostics(); // Load warnings come before the summary
+
+    if (result == 0) {
+        char hashText[17];
+        std::snprintf(hashText, sizeof(hashText), "%016" PRIx64, runHash);
+        std::cout << "Replay: " << framesPlayed << " frame(s) of " << storyFile << " in "
+                  << (replayNS / 1000000.0) << " ms, run hash " << hashText << std::endl;
+    }
+    return result;
+}
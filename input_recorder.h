@@ -0,0 +1,42 @@
+// input_recorder.h - Input recording and deterministic headless replay
+#pragma once
+#include <SDL3/SDL.h>       // For SDL_Event, Uint64
+#include <string>           // For std::string
+#include <fstream>          // For std::ofstream
+
+// --- Recording Format ---
+// A plain text file, one record per line:
+//   VNREC 2 <width> <height> <story file>    header (story file is the rest of the line)
+//   F <frameTimeNS>                          starts a frame at the given real time (SDL_GetTicksNS)
+//   E <type> <key> <mod> <button> <x> <y>    an input event handled during the last frame
+// Only the event types StoryManager and the main loop react to are recorded.
+
+// --- InputRecorder ---
+// Logs every frame's clock and its input events while the game runs interactively.
+class InputRecorder {
+public:
+    // Opens the recording file and writes the header. Returns false if the file can't be created.
+    bool open(const std::string& path, const std::string& storyFile, int width, int height);
+
+    // Starts a new frame. Call once per frame, before recording that frame's events.
+    // The replay feeds these times through the same FixedStepClock, reproducing every step.
+    void recordFrame(Uint64 frameTimeNS);
+
+    // Records one input event for the current frame (ignored if the type isn't replayable).
+    void recordEvent(const SDL_Event& event);
+
+    // Flushes and closes the file.
+    void close();
+
+    bool isOpen() const { return out.is_open(); }
+
+private:
+    std::ofstream out;
+};
+
+// Replays a recording in headless mode: feeds the recorded clock and events to a StoryManager
+// rendering into an offscreen software target and hashes every frame's pixels.
+// Two replays of the same recording produce identical hashes.
+// hashOutputPath: If non-empty, one "<frame> <hash>" line per frame is written there.
+// Returns 0 on success, non-zero if the recording or the offscreen target could not be set up.
+int runReplay(const std::string& recordingPath, const std::string& hashOutputPath);
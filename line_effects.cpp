@@ -0,0 +1,305 @@
+// line_effects.cpp - Built-in effect types, tag parsing and the per-line effect instances
+#include "line_effects.h"   // Include the corresponding header
+#include <algorithm>        // For std::copy, std::min
+#include "story_tokenizer.h" // For parseStoryNumber, isStoryArgsEnd
+
+// --- Built-in Effect Types ---
+namespace {
+
+// [JITTER]: the words shake in place once the line is revealed
+bool jitterUpdate(EffectInstance& effect, EffectStage& stage, float) {
+    if (stage.revealed) stage.wordsShown = true;
+    applyJitter(stage.words, effect.rng);
+    return true; // Lasts as long as the line
+}
+
+// [FALL] / [FLOAT]: once the line is revealed (and has no choices) the words pop off and fly until
+// every one has settled. phase: 0 waiting for the reveal, 1 flying.
+bool physicsUpdate(EffectInstance& effect, EffectStage& stage, float stepSeconds,
+                   void (*launch)(std::vector<RenderedWord>&, EffectRng&)) {
+    if (effect.phase == 0) {
+        if (!stage.revealed || stage.choicesShown || stage.words.empty()) return true;
+        launch(stage.words, effect.rng);
+        stage.wordsShown = true;
+        effect.phase = 1;
+    }
+    updatePhysicsWords(stage.words, stepSeconds);
+    for (const RenderedWord& word : stage.words) {
+        if (word.active) return true;
+    }
+    return false; // Everything landed; the words stay where they are
+}
+
+bool fallUpdate(EffectInstance& effect, EffectStage& stage, float stepSeconds) {
+    return physicsUpdate(effect, stage, stepSeconds, applyfallEffect);
+}
+
+bool floatUpdate(EffectInstance& effect, EffectStage& stage, float stepSeconds) {
+    return physicsUpdate(effect, stage, stepSeconds, applyfloatEffect);
+}
+
+// [PULSE ms hz r g b a r g b a]: the line's color cycles between two colors. The line's {pulse}
+// spans take its frequency and colors too (they keep cycling for as long as the line is shown).
+SDL_Color paramColor(const float* params) {
+    return {(Uint8)params[0], (Uint8)params[1], (Uint8)params[2], (Uint8)params[3]};
+}
+
+void pulseStart(EffectInstance& effect, EffectStage& stage) {
+    const float* p = effect.params;
+    initTextColorPulse(stage.linePulse, stage.ticks, (Uint64)p[0], p[1], paramColor(p + 2), paramColor(p + 6));
+    if (isTextColorPulseActive(stage.spanPulse)) {
+        initTextColorPulse(stage.spanPulse, stage.ticks, 0, p[1], paramColor(p + 2), paramColor(p + 6));
+    }
+}
+
+bool pulseUpdate(EffectInstance&, EffectStage& stage, float) {
+    getPulsingTextColor(stage.linePulse, stage.ticks); // Ends the pulse once its duration is over
+    return isTextColorPulseActive(stage.linePulse);
+}
+
+void pulseStop(EffectInstance&, EffectStage& stage) {
+    deactivateTextColorPulse(stage.linePulse);
+}
+
+void pulseRender(const EffectInstance&, EffectStage& stage, EffectFrame& frame) {
+    if (isTextColorPulseActive(stage.linePulse)) {
+        frame.textColor = getPulsingTextColor(stage.linePulse, stage.ticks);
+    }
+}
+
+// [SHAKE ms intensity]: everything on screen shakes, fading out over the duration
+void shakeStart(EffectInstance& effect, EffectStage& stage) {
+    initScreenShake(stage.screen, stage.ticks, (Uint32)effect.params[0], effect.params[1], effect.seed);
+}
+
+bool shakeUpdate(EffectInstance&, EffectStage& stage, float) {
+    updateScreenShake(stage.screen, stage.ticks);
+    return isScreenShakeActive(stage.screen);
+}
+
+void shakeStop(EffectInstance&, EffectStage& stage) {
+    initScreenShake(stage.screen, stage.ticks, 0, 0.0f, 0); // A zero duration ends on the next update
+    updateScreenShake(stage.screen, stage.ticks);
+}
+
+void shakeRender(const EffectInstance&, EffectStage& stage, EffectFrame& frame) {
+    if (!isScreenShakeActive(stage.screen)) return;
+    frame.offset = getScreenShakeOffset(stage.screen);
+    frame.moving = true;
+}
+
+// [TEAR ms maxOffsetX density]: the screen below a jumping line shifts sideways
+void tearStart(EffectInstance& effect, EffectStage& stage) {
+    initScreenTear(stage.screen, stage.ticks, (Uint32)effect.params[0], effect.params[1], effect.params[2], effect.seed);
+}
+
+bool tearUpdate(EffectInstance&, EffectStage& stage, float) {
+    updateScreenTear(stage.screen, stage.ticks);
+    return isScreenTearActive(stage.screen);
+}
+
+void tearStop(EffectInstance&, EffectStage& stage) {
+    initScreenTear(stage.screen, stage.ticks, 0, 0.0f, 0.0f, 0); // A zero duration ends on the next update
+    updateScreenTear(stage.screen, stage.ticks);
+}
+
+void tearRender(const EffectInstance&, EffectStage& stage, EffectFrame& frame) {
+    if (!isScreenTearActive(stage.screen)) return;
+    frame.splitY = stage.screen.currentTearLineY;
+    frame.splitOffsetX = stage.screen.currentTearOffsetX;
+    frame.moving = true;
+}
+
+// Per-glyph effects on the typewriter text, evaluated while drawing (see renderAnimatedShapedText)
+float getEffectSeconds(const EffectInstance& effect, const EffectStage& stage) {
+    return (stage.ticks > effect.startTicks) ? (float)(stage.ticks - effect.startTicks) / 1000.0f : 0.0f;
+}
+
+// [WAVE amplitude hz]: the letters ride a sine wave that travels along the line
+void waveRender(const EffectInstance& effect, EffectStage& stage, EffectFrame& frame) {
+    frame.glyphs.waveAmplitude = effect.params[0];
+    frame.glyphs.wavePhase = getEffectSeconds(effect, stage) * effect.params[1];
+}
+
+// [LETTERSHAKE amplitude]: every letter jumps on its own, a few times a second
+void letterShakeRender(const EffectInstance& effect, EffectStage& stage, EffectFrame& frame) {
+    const Uint64 LETTER_SHAKE_STEP_MS = 50;
+    frame.glyphs.shakeAmplitude = effect.params[0];
+    frame.glyphs.shakeStep = (Uint32)((stage.ticks - std::min(stage.ticks, effect.startTicks)) / LETTER_SHAKE_STEP_MS);
+}
+
+// [RAINBOW hz]: the hue cycles along the line and over time
+void rainbowRender(const EffectInstance& effect, EffectStage& stage, EffectFrame& frame) {
+    frame.glyphs.rainbow = true;
+    frame.glyphs.rainbowPhase = getEffectSeconds(effect, stage) * effect.params[0];
+}
+
+const size_t MAX_EFFECT_TYPES = 0xFFFF; // Type indices are stored as Uint16
+
+std::vector<EffectType>& getRegistry() {
+    static std::vector<EffectType> registry = {
+        {"JITTER", 0, EFFECT_USES_WORDS, EFFECT_RNG_JITTER, nullptr, jitterUpdate, nullptr, nullptr},
+        {"FALL", 0, EFFECT_USES_WORDS, EFFECT_RNG_PHYSICS, nullptr, fallUpdate, nullptr, nullptr},
+        {"FLOAT", 0, EFFECT_USES_WORDS, EFFECT_RNG_PHYSICS, nullptr, floatUpdate, nullptr, nullptr},
+        {"PULSE", 10, 0, EFFECT_RNG_NONE, pulseStart, pulseUpdate, pulseStop, pulseRender},
+        {"SHAKE", 2, 0, EFFECT_RNG_SHAKE, shakeStart, shakeUpdate, shakeStop, shakeRender},
+        {"TEAR", 3, 0, EFFECT_RNG_TEAR, tearStart, tearUpdate, tearStop, tearRender},
+        {"WAVE", 2, 0, EFFECT_RNG_NONE, nullptr, nullptr, nullptr, waveRender},
+        {"LETTERSHAKE", 1, 0, EFFECT_RNG_NONE, nullptr, nullptr, nullptr, letterShakeRender},
+        {"RAINBOW", 1, 0, EFFECT_RNG_NONE, nullptr, nullptr, nullptr, rainbowRender},
+    };
+    return registry;
+}
+
+} // namespace
+
+// --- Registry ---
+int registerEffectType(const EffectType& type) {
+    std::vector<EffectType>& registry = getRegistry();
+    if (!type.tag || findEffectType(type.tag) >= 0 || registry.size() >= MAX_EFFECT_TYPES ||
+        type.paramCount < 0 || type.paramCount > EFFECT_MAX_PARAMS) {
+        return -1;
+    }
+    registry.push_back(type);
+    return (int)registry.size() - 1;
+}
+
+int findEffectType(std::string_view tag) {
+    const std::vector<EffectType>& registry = getRegistry();
+    for (size_t i = 0; i < registry.size(); ++i) {
+        if (tag == registry[i].tag) return (int)i;
+    }
+    return -1;
+}
+
+const EffectType& getEffectType(Uint16 index) {
+    return getRegistry()[index];
+}
+
+// --- Tag Parsing ---
+bool EffectSpec::operator==(const EffectSpec& other) const {
+    if (type != other.type) return false;
+    for (int i = 0; i < EFFECT_MAX_PARAMS; ++i) {
+        if (params[i] != other.params[i]) return false;
+    }
+    return true;
+}
+
+std::string_view getEffectTagName(std::string_view line) {
+    if (line.empty() || line.front() != '[') return {};
+    const size_t nameEnd = line.find_first_of(" \t]", 1);
+    return line.substr(1, (nameEnd == std::string_view::npos ? line.size() : nameEnd) - 1);
+}
+
+bool isEffectTag(std::string_view line) {
+    const std::string_view name = getEffectTagName(line);
+    return !name.empty() && findEffectType(name) >= 0;
+}
+
+bool parseEffectTag(std::string_view line, EffectSpec& spec, std::string& error) {
+    const std::string_view name = getEffectTagName(line);
+    const int typeIndex = findEffectType(name);
+    if (typeIndex < 0) {
+        error = "unknown effect tag";
+        return false;
+    }
+    const size_t closeBracketPos = line.find(']');
+    if (closeBracketPos == std::string_view::npos) {
+        error = "missing ']'";
+        return false;
+    }
+
+    const EffectType& type = getEffectType((Uint16)typeIndex);
+    spec = EffectSpec();
+    spec.type = (Uint16)typeIndex;
+
+    // The numbers between the name and ']', separated by whitespace
+    std::string_view args = line.substr(1 + name.size(), closeBracketPos - 1 - name.size());
+    int count = 0;
+    while (!isStoryArgsEnd(args)) {
+        float value;
+        if (count >= type.paramCount || !parseStoryNumber(args, value) ||
+            (!args.empty() && args.front() != ' ' && args.front() != '\t')) {
+            count = -1; // Not a number, or one too many
+            break;
+        }
+        spec.params[count++] = value;
+    }
+    if (count != type.paramCount) {
+        error = "malformed parameters: " + std::string(line.substr(0, closeBracketPos + 1));
+        return false;
+    }
+    return true;
+}
+
+void addEffectSpec(std::vector<EffectSpec>& specs, const EffectSpec& spec) {
+    for (EffectSpec& existing : specs) {
+        if (existing.type == spec.type) {
+            existing = spec;
+            return;
+        }
+    }
+    specs.push_back(spec);
+}
+
+bool effectSpecsUseWords(const std::vector<EffectSpec>& specs) {
+    for (const EffectSpec& spec : specs) {
+        if (getEffectType(spec.type).flags & EFFECT_USES_WORDS) return true;
+    }
+    return false;
+}
+
+// --- Running Effects ---
+void startLineEffects(EffectStage& stage, const std::vector<EffectSpec>& specs, Uint64 ticks,
+                      const std::string& storyFile, size_t lineIndex) {
+    stopLineEffects(stage);
+    stage.ticks = ticks;
+    for (const EffectSpec& spec : specs) {
+        const EffectType& type = getEffectType(spec.type);
+        EffectInstance effect;
+        effect.type = spec.type;
+        std::copy(spec.params, spec.params + EFFECT_MAX_PARAMS, effect.params);
+        effect.startTicks = ticks;
+        effect.seed = makeEffectSeed(storyFile, lineIndex, type.rngId);
+        effect.rng.seed(effect.seed);
+        effect.phase = 0;
+        if (type.start) type.start(effect, stage);
+        stage.active.push_back(effect);
+    }
+}
+
+void updateLineEffects(EffectStage& stage, Uint64 ticks, float stepSeconds) {
+    stage.ticks = ticks;
+    for (size_t i = 0; i < stage.active.size();) {
+        EffectInstance& effect = stage.active[i];
+        const EffectType& type = getEffectType(effect.type);
+        if (!type.update || type.update(effect, stage, stepSeconds)) {
+            ++i;
+            continue;
+        }
+        // Finished: the last instance takes its slot (instances don't depend on their order)
+        if (type.stop) type.stop(effect, stage);
+        stage.active[i] = stage.active.back();
+        stage.active.pop_back();
+    }
+}
+
+void stopLineEffects(EffectStage& stage) {
+    for (EffectInstance& effect : stage.active) {
+        const EffectType& type = getEffectType(effect.type);
+        if (type.stop) type.stop(effect, stage);
+    }
+    stage.active.clear();
+    stage.wordsShown = false;
+}
+
+EffectFrame getEffectFrame(EffectStage& stage, Uint64 ticks, SDL_Color textColor) {
+    EffectFrame frame;
+    frame.textColor = textColor;
+    stage.ticks = ticks;
+    for (const EffectInstance& effect : stage.active) {
+        const EffectType& type = getEffectType(effect.type);
+        if (type.render) type.render(effect, stage, frame);
+    }
+    return frame;
+}
@@ -0,0 +1,122 @@
+// line_effects.h - Registry of dialog line effect tags and the running effects of the line on screen
+#pragma once
+#include <SDL3/SDL.h>       // For Uint16, Uint32, Uint64, SDL_FPoint, SDL_Color
+#include <string>           // For std::string
+#include <string_view>      // For std::string_view
+#include <vector>           // For std::vector
+#include "effect_rng.h"     // For EffectRng, EffectRngId
+#include "rich_text.h"      // For GlyphAnimation
+#include "text_effects.h"   // For RenderedWord, TextEffectsContext
+#include "visual_effects.h" // For ScreenEffectsContext
+
+// Numbers an effect tag can carry; [PULSE ms hz r g b a r g b a] is the longest built-in one
+const int EFFECT_MAX_PARAMS = 10;
+
+// --- Effect Specs ---
+// One effect tag in front of a line, parsed once at load: the registered type and its numbers.
+struct EffectSpec {
+    Uint16 type = 0;                      // Index into the effect registry
+    float params[EFFECT_MAX_PARAMS] = {}; // The tag's numbers in order; the rest stay 0
+
+    bool operator==(const EffectSpec& other) const;
+};
+
+// --- Effect Stage ---
+// An effect that is running on the current line. Instances are copied out of the line's specs when
+// it starts, so reloading the story tables (streaming) never leaves them pointing at freed data.
+struct EffectInstance {
+    Uint16 type;
+    float params[EFFECT_MAX_PARAMS];
+    Uint64 startTicks; // Story clock when the instance started, in milliseconds
+    Uint64 seed;      // makeEffectSeed() of the story file, line and the type's stream
+    EffectRng rng;    // Seeded from `seed` when the instance starts
+    int phase;        // Free for the effect's own bookkeeping (0 on start)
+};
+
+// What effects act on. Hooks write the shared state here and render() reads it back, so the
+// StoryManager only ever walks the active instances. One per StoryManager.
+struct EffectStage {
+    ScreenEffectsContext screen;     // Shake and tear
+    TextEffectsContext linePulse;    // Color of the whole line
+    TextEffectsContext spanPulse;    // Color of the line's {pulse} spans
+    std::vector<RenderedWord> words; // The line's words, laid out by the StoryManager when a type has EFFECT_USES_WORDS
+    bool wordsShown = false;         // Set by word effects once the words take over from the typewriter text
+    bool revealed = false;           // The line is fully revealed (set before each update)
+    bool choicesShown = false;       // The line's choice panel is up (set before each update)
+    Uint64 ticks = 0;                // Story clock of the current start/update, in milliseconds
+    std::vector<EffectInstance> active; // Dense: finished instances are swapped out
+};
+
+// What the active effects do to one rendered frame.
+struct EffectFrame {
+    SDL_FPoint offset = {0.0f, 0.0f}; // Moves everything (screen shake)
+    float splitY = 0.0f;              // Rows at or below splitY move by splitOffsetX (screen tear)
+    float splitOffsetX = 0.0f;
+    SDL_Color textColor = {255, 255, 255, 255};
+    GlyphAnimation glyphs;            // Per-glyph motion and color of the typewriter text (wave, letter shake, rainbow)
+    bool moving = false;              // Something moves the whole layout, so partial redraws won't do
+};
+
+// --- Effect Types ---
+// Type flags
+const Uint32 EFFECT_USES_WORDS = 1u << 0; // Needs EffectStage::words for the line
+
+// A registered effect. Hooks left null are skipped.
+struct EffectType {
+    const char* tag;        // Name inside the brackets, e.g. "SHAKE" for [SHAKE ms intensity]
+    int paramCount;         // Numbers the tag must carry (at most EFFECT_MAX_PARAMS)
+    Uint32 flags;           // EFFECT_* flags
+    EffectRngId rngId;      // Which of the line's random streams the instance is seeded from
+    void (*start)(EffectInstance& effect, EffectStage& stage);
+    bool (*update)(EffectInstance& effect, EffectStage& stage, float stepSeconds); // false: finished, drop it
+    void (*stop)(EffectInstance& effect, EffectStage& stage);
+    void (*render)(const EffectInstance& effect, EffectStage& stage, EffectFrame& frame);
+};
+
+// Adds an effect type and returns its index, or -1 if the tag is taken or the registry is full.
+// The built-in types ([JITTER], [FALL], [FLOAT], [PULSE], [SHAKE], [TEAR], [WAVE], [LETTERSHAKE],
+// [RAINBOW]) are always present.
+// Register before loading stories; the registry is read without locking afterwards.
+int registerEffectType(const EffectType& type);
+
+// Index of the type with this tag name, or -1.
+int findEffectType(std::string_view tag);
+
+const EffectType& getEffectType(Uint16 index);
+
+// --- Tag Parsing ---
+// The name of a "[NAME ...]" tag line ("NAME"), or empty if the line doesn't start with '['.
+std::string_view getEffectTagName(std::string_view line);
+
+// Whether the line is a tag of a registered effect type.
+bool isEffectTag(std::string_view line);
+
+// Parses an effect tag line into `spec`. Returns false with a message in `error` if the ']' is
+// missing or the numbers don't match the type's parameter count.
+bool parseEffectTag(std::string_view line, EffectSpec& spec, std::string& error);
+
+// Adds `spec` to a line's specs; a tag of the same type given earlier is replaced.
+void addEffectSpec(std::vector<EffectSpec>& specs, const EffectSpec& spec);
+
+// Whether any of the specs needs the line's words.
+bool effectSpecsUseWords(const std::vector<EffectSpec>& specs);
+
+// --- Running Effects ---
+// Stops whatever runs on the stage, then starts one instance per spec at `ticks`, seeded from the
+// story file and line so the line looks the same on every run.
+void startLineEffects(EffectStage& stage, const std::vector<EffectSpec>& specs, Uint64 ticks,
+                      const std::string& storyFile, size_t lineIndex);
+
+// Steps every active instance once and drops the ones that finished.
+void updateLineEffects(EffectStage& stage, Uint64 ticks, float stepSeconds);
+
+// Stops and drops every active instance, and hands the text back to the typewriter.
+void stopLineEffects(EffectStage& stage);
+
+// Collects what the active instances do to a frame drawn at `ticks`, starting from `textColor`.
+EffectFrame getEffectFrame(EffectStage& stage, Uint64 ticks, SDL_Color textColor);
+
+// Horizontal offset of something drawn at `y` in this frame (the tear split).
+inline float getFrameXOffset(const EffectFrame& frame, float y) {
+    return (y >= frame.splitY) ? frame.splitOffsetX : 0.0f;
+}
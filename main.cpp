@@ -7,13 +7,22 @@
 #include <SDL3/SDL.h>       // For core SDL functions
 #include <SDL3/SDL_rect.h>  // For SDL_FRect
 #include <SDL3_ttf/SDL_ttf.h> // For TTF_Init, TTF_OpenFont, TTF_CloseFont, TTF_TextEngine, etc.
-#include <cstdlib>          // For srand, rand
+#include <cstdlib>          // For atoi
 #include <cmath>            // For std::fabs
-#include <ctime>            // For time (to seed rand)
 
 // --- Include your custom modules ---
 #include "StoryManager.h"   // The new story management class
-#include "visual_effects.h" // For global screen effect update functions
+#include "batch_render.h"   // For the offscreen --batch-render QA mode
+#include "input_recorder.h" // For --record / --replay
+#include "voice_blips.h"    // For typewriter voice blips
+#include "sim_clock.h"      // For FixedStepClock
+#include "benchmarks.h"     // For --bench-vm, --bench-parse
+#include "file_watcher.h"   // For FileWatcher (--watch)
+#include "save_state.h"     // For SaveSlotWriter, readSaveSlot
+#include "backlog_view.h"   // For BacklogView
+#include "frame_compositor.h" // For --retained dirty-rect compositing
+#include "render_stats.h"   // For per-frame draw call and texture counters
+#include "story_diagnostics.h" // For flushDiagnostics
 #include "text_ui.h"        // For global constants and common UI functions (if still needed directly)
                             // Note: renderText, drawDialogBoxUI, renderNameBox are now used by StoryManager,
                             // but constants like winWidth, winHeight, textPadding are still here.
@@ -48,12 +57,71 @@ SDL_Color choiceBorderColor = {150, 150, 255, 255}; // Lighter blue, opaque
 // --- Function Declarations ---
 bool initSDL();
 void closeSDL();
+void saveToSlot(StoryManager& storyManager, SaveSlotWriter& saveWriter, std::vector<Uint8>& snapshotBytes, int slot);
+void loadFromSlot(StoryManager& storyManager, SaveSlotWriter& saveWriter, std::vector<Uint8>& snapshotBytes, int slot);
 
 
 // --- Main Application Entry Point ---
 int main(int argc, char* argv[]) {
-    // Seed the random number generator ONCE at the start of the program
-    srand((unsigned int)time(NULL));
+    // Batch QA mode: --batch-render <outputDir> [--jobs N] <story files...>
+    // Renders every line of the given stories to PNGs offscreen and exits without opening a window.
+    if (argc >= 2 && std::string(argv[1]) == "--batch-render") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " --batch-render <outputDir> [--jobs N] <story files...>" << std::endl;
+            return 1;
+        }
+        std::string outputDir = argv[2];
+        int jobs = 0; // 0 = one worker per CPU core
+        std::vector<std::string> storyFiles;
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--jobs" && i + 1 < argc) {
+                jobs = std::atoi(argv[++i]);
+            } else {
+                storyFiles.push_back(arg);
+            }
+        }
+        return runBatchRender(storyFiles, outputDir, jobs);
+    }
+
+    // Headless replay: --replay <recording> [--hash-out <file>]
+    // Replays a recorded session offscreen and prints a hash of every rendered frame.
+    if (argc >= 3 && std::string(argv[1]) == "--replay") {
+        std::string hashOutputPath;
+        if (argc >= 5 && std::string(argv[3]) == "--hash-out") {
+            hashOutputPath = argv[4];
+        }
+        return runReplay(argv[2], hashOutputPath);
+    }
+
+    // Story VM benchmark: --bench-vm [instructionCount]
+    if (argc >= 2 && std::string(argv[1]) == "--bench-vm") {
+        return runStoryVmBenchmark(argc >= 3 ? std::atoi(argv[2]) : 200000);
+    }
+
+    // Story parser benchmark: --bench-parse [lineCount]
+    if (argc >= 2 && std::string(argv[1]) == "--bench-parse") {
+        return runStoryParseBenchmark(argc >= 3 ? std::atoi(argv[2]) : 1000000);
+    }
+
+    // Interactive options
+    std::string recordingPath; // --record <file>: log frame clocks and input for later replay
+    bool forceStreaming = false; // --stream: use the streaming loader even for small scripts
+    bool retainedCompositing = false; // --retained: redraw only the parts of the frame that changed
+    bool watchStoryFiles = false; // --watch: reload the story file whenever it's saved
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) {
+            recordingPath = argv[++i];
+        } else if (arg == "--stream") {
+            forceStreaming = true;
+        } else if (arg == "--retained") {
+            retainedCompositing = true;
+        } else if (arg == "--watch") {
+            watchStoryFiles = true;
+        }
+    }
+    const std::string initialStoryFile = "story_test_effects.txt";
 
     // 1. Initialize SDL and its extensions
     if (!initSDL()) {
@@ -65,28 +133,76 @@ int main(int argc, char* argv[]) {
     // Pass the globally initialized SDL pointers to the StoryManager
     StoryManager storyManager(gRenderer, gDialogFont, gNameFont, gTextEngine);
 
+    // Voice blips are optional: without an audio device the story simply runs silent
+    VoiceBlipPlayer voicePlayer;
+    if (voicePlayer.open()) {
+        storyManager.setVoiceBlipPlayer(&voicePlayer);
+    }
+
+    InputRecorder recorder;
+    if (!recordingPath.empty()) {
+        recorder.open(recordingPath, initialStoryFile, winWidth, winHeight);
+    }
+
+    // Physics and effects run on a fixed step; rendering interpolates between steps
+    FixedStepClock simClock;
+    simClock.reset(SDL_GetTicksNS());
+
     // 3. Load the initial story file
-    if (!storyManager.loadStory("story_test_effects.txt")) {
+    storyManager.setClock(simClock.simTimeNS);
+    if (forceStreaming) {
+        storyManager.setStreamingThreshold(0);
+    }
+    // Lines read in earlier sessions can be skipped. Not while recording: a replay starts with
+    // nothing read, and has to skip exactly what the recorded session did.
+    const std::string readLinesPath = "read_lines.dat";
+    const bool persistReadLines = recordingPath.empty();
+    if (persistReadLines) {
+        storyManager.loadReadLines(readLinesPath);
+    }
+    if (!storyManager.loadStory(initialStoryFile)) {
         std::cerr << "Failed to load initial story file. Exiting." << std::endl;
+        storyManager.releaseStoryResources(); // Before the text engine goes away
         closeSDL();
         return 1;
     }
 
-    Uint64 lastFrameTime = SDL_GetTicks();
+    // Retained mode keeps the last frame in a texture; without render-target support it stays off
+    FrameCompositor compositor;
+    if (retainedCompositing) {
+        compositor.create(gRenderer, winWidth, winHeight);
+    }
+    std::vector<SDL_FRect> dirtyRects;
+
+    // Hot reload for writers: edits show up in the running game without losing the current line
+    FileWatcher storyWatcher;
+    std::vector<std::string> changedFiles;
+    if (watchStoryFiles) {
+        storyWatcher.open();
+    }
+    const SDL_Color backgroundColor = {0x20, 0x20, 0x20, 0xFF};
+
+    // Save slots: F5 quick-saves and F9 quick-loads; Ctrl+1..9 saves to a numbered slot, Alt+1..9 loads it.
+    // Loading is off while recording: a replay doesn't read save files, so it couldn't follow one.
+    const bool slotLoadsEnabled = recordingPath.empty();
+    SaveSlotWriter saveWriter;
+    std::vector<Uint8> snapshotBytes; // Reused by every save and load
+
+    // Backlog of earlier lines: B or the mouse wheel opens it over the story
+    BacklogView backlogView;
+    bool backlogWasOpen = false;
+
     bool running = true;
     SDL_Event event;
 
     // --- Main Game Loop ---
     while (running) {
-        Uint64 currentTicks = SDL_GetTicks();
-        float deltaTime = (currentTicks - lastFrameTime) / 1000.0f; // Delta time in seconds
-        lastFrameTime = currentTicks;
-
-        // Cap delta time to prevent large jumps on lag, improving physics stability
-        if (deltaTime > 0.05f) deltaTime = 0.05f;
+        Uint64 nowNS = SDL_GetTicksNS();
+        recorder.recordFrame(nowNS);
 
         // --- Event Handling ---
         while (SDL_PollEvent(&event)) {
+            recorder.recordEvent(event);
             if (event.type == SDL_EVENT_QUIT) {
                 running = false; // User requested quit
             }
@@ -97,38 +213,135 @@ int main(int argc, char* argv[]) {
                 winHeight = newH; // Update global height
                 // Inform StoryManager about the resize so it can re-render textures etc.
                 storyManager.handleWindowResize(newW, newH);
+                if (compositor.isActive()) {
+                    compositor.resize(newW, newH);
+                }
+            }
+            if (event.type == SDL_EVENT_WINDOW_EXPOSED) {
+                compositor.invalidate(); // The window contents may have been lost
+            }
+            if (event.type == SDL_EVENT_KEY_DOWN && !event.key.repeat) {
+                const SDL_Keycode key = event.key.key;
+                const bool digit = key >= SDLK_1 && key <= SDLK_9;
+                if (key == SDLK_F5) {
+                    saveToSlot(storyManager, saveWriter, snapshotBytes, 0);
+                } else if (digit && (event.key.mod & SDL_KMOD_CTRL)) {
+                    saveToSlot(storyManager, saveWriter, snapshotBytes, (int)(key - SDLK_1) + 1);
+                } else if (key == SDLK_F9 || (digit && (event.key.mod & SDL_KMOD_ALT))) {
+                    if (slotLoadsEnabled) {
+                        loadFromSlot(storyManager, saveWriter, snapshotBytes, (key == SDLK_F9) ? 0 : (int)(key - SDLK_1) + 1);
+                    } else {
+                        std::cerr << "Warning: Loading saves is disabled while recording" << std::endl;
+                    }
+                }
+            }
+            // The backlog takes the input while it's open; otherwise StoryManager handles it
+            if (!backlogView.handleInput(event)) {
+                storyManager.handleInput(event);
             }
-            // Delegate input handling to StoryManager
-            storyManager.handleInput(event);
         }
 
-        // --- Update Game State ---
-        // Update global screen-wide effects first
-        updateScreenShake(currentTicks);
-        updateScreenTear(currentTicks);
+        if (storyWatcher.isOpen()) {
+            storyWatcher.watch(storyManager.getCurrentStoryFile()); // Files reached through choices are watched from then on
+            changedFiles.clear();
+            storyWatcher.poll(nowNS, changedFiles);
+            for (const std::string& path : changedFiles) {
+                storyManager.reloadStory(path); // Only the file on screen is re-parsed
+            }
+        }
 
-        // Delegate story update logic to StoryManager
-        storyManager.update(currentTicks, deltaTime);
+        // --- Update Game State ---
+        // Run as many fixed steps as the elapsed time covers (possibly none on high-refresh displays).
+        // StoryManager advances its typewriter, physics and screen-wide effects in each step.
+        simClock.advance(nowNS);
+        while (simClock.step()) {
+            storyManager.fixedUpdate(simClock.simTimeNS, simClock.stepSeconds());
+        }
 
         // --- Rendering ---
+        if (compositor.isActive()) {
+            // Retained: redraw only what changed into the persistent frame, present only if anything did
+            dirtyRects.clear();
+            if (storyManager.collectDirtyRects(simClock.renderTimeNS(), dirtyRects, simClock.alpha())) {
+                compositor.invalidate();
+            }
+            if (backlogView.isOpen() || backlogWasOpen) {
+                compositor.invalidate(); // The backlog covers most of the frame; redraw it whole while it's up
+            }
+            backlogWasOpen = backlogView.isOpen();
+            for (const SDL_FRect& rect : dirtyRects) {
+                compositor.addDirtyRect(rect);
+            }
+            if (compositor.beginFrame(backgroundColor)) {
+                storyManager.render(simClock.renderTimeNS(), simClock.alpha());
+                backlogView.render(gRenderer, gDialogFont, storyManager);
+                compositor.endFrame();
+                endRenderStatsFrame();
+            } else {
+                SDL_Delay(1); // Nothing to present, so no vsync wait: don't spin
+            }
+            continue;
+        }
+
         // Clear the screen
-        SDL_SetRenderDrawColor(gRenderer, 0x20, 0x20, 0x20, 0xFF); // Dark background
+        SDL_SetRenderDrawColor(gRenderer, backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a); // Dark background
         SDL_RenderClear(gRenderer);
 
         // Delegate rendering of story elements to StoryManager
-        storyManager.render(currentTicks);
+        storyManager.render(simClock.renderTimeNS(), simClock.alpha());
+        backlogView.render(gRenderer, gDialogFont, storyManager);
 
         // Present the rendered frame to the screen
         SDL_RenderPresent(gRenderer);
+        endRenderStatsFrame();
+    }
+
+    printRenderStats(std::cout);
+
+    if (compositor.isActive()) {
+        std::cout << "Retained compositing: " << compositor.getFramesRedrawn() << " frames redrawn, "
+                  << compositor.getFramesSkipped() << " skipped, "
+                  << compositor.getPixelsRedrawn() / std::max<Uint64>(1, compositor.getFramesRedrawn()) << " pixels per redraw" << std::endl;
     }
+    compositor.destroy(); // Before the renderer goes away
+    backlogView.destroy();
 
     // 4. Clean up SDL resources when the game loop ends
+    saveWriter.close(); // Saves still being written finish first
+    if (persistReadLines) {
+        storyManager.saveReadLines(readLinesPath); // Warns itself if it can't
+    }
+    recorder.close();
+    flushDiagnostics(); // Warnings still queued are written before exiting
+    storyManager.setVoiceBlipPlayer(nullptr);
+    voicePlayer.close();
+    storyManager.releaseStoryResources(); // Before the text engine goes away
     closeSDL();
 
     return 0;
 }
 
 
+// --- Save Slots ---
+// Snapshots the story and hands the bytes to the writer thread; the frame never waits on the disk.
+void saveToSlot(StoryManager& storyManager, SaveSlotWriter& saveWriter, std::vector<Uint8>& snapshotBytes, int slot) {
+    snapshotBytes.clear();
+    storyManager.saveSnapshot(snapshotBytes);
+    saveWriter.post(slot, snapshotBytes);
+}
+
+void loadFromSlot(StoryManager& storyManager, SaveSlotWriter& saveWriter, std::vector<Uint8>& snapshotBytes, int slot) {
+    saveWriter.flush(); // A save of the slot may still be on its way to the disk
+    if (!readSaveSlot(slot, snapshotBytes)) {
+        std::cerr << "Warning: No save in " << getSaveSlotPath(slot) << std::endl;
+        return;
+    }
+    if (storyManager.loadSnapshot(snapshotBytes.data(), snapshotBytes.size())) {
+        std::cout << "Loaded " << getSaveSlotPath(slot) << std::endl;
+    }
+}
+
+
 // --- SDL Initialization ---
 // This function remains in main.cpp as it sets up global SDL resources.
 bool initSDL() {
@@ -161,7 +374,7 @@ bool initSDL() {
         return false;
     }
 
-    // Create a TTF_TextEngine (required for TTF_RenderText_Blended_Wrapped in SDL3_ttf)
+    // Create a TTF_TextEngine: the story keeps its names, choices and effect words as TTF_Text objects drawn through it
     gTextEngine = TTF_CreateRendererTextEngine(gRenderer);
     if (gTextEngine == nullptr) {
         std::cerr << "Failed to create TTF_TextEngine: " << SDL_GetError() << std::endl;
@@ -201,6 +414,4 @@ void closeSDL() {
     // Quit SDL_ttf and SDL subsystems
     TTF_Quit();
     SDL_Quit();
-
-    // Note: StoryManager's destructor will handle its internal resource cleanup (e.g., choice textures)
 }
@@ -0,0 +1,60 @@
+// read_tracker.cpp - Implementation of read line tracking and its file
+#include "read_tracker.h"   // Include the corresponding header
+#include <filesystem>       // For std::filesystem::exists
+#include <iostream>         // For std::cerr
+#include "save_state.h"     // For SnapshotWriter, SnapshotReader, readFileBytes, writeFileAtomically
+
+static const char READ_LINES_MAGIC[4] = {'V', 'N', 'R', 'D'};
+static const Uint32 READ_LINES_VERSION = 1;
+
+// --- ReadTracker ---
+ReadLineSet& ReadTracker::getFile(const std::string& file) {
+    return files[file];
+}
+
+bool ReadTracker::load(const std::string& path) {
+    files.clear();
+    std::vector<Uint8> bytes;
+    if (!readFileBytes(path, bytes)) {
+        if (!std::filesystem::exists(path)) return true; // Nothing read yet
+        std::cerr << "Warning: Could not read " << path << "; no lines count as read" << std::endl;
+        return false;
+    }
+
+    SnapshotReader in(bytes.data(), bytes.size());
+    bool valid = true;
+    for (char c : READ_LINES_MAGIC) {
+        if (in.u8() != (Uint8)c) valid = false;
+    }
+    valid = valid && in.u32() == READ_LINES_VERSION;
+    const Uint32 fileCount = valid ? in.count(8) : 0;
+    for (Uint32 i = 0; i < fileCount && in.ok(); ++i) {
+        ReadLineSet& lines = files[in.str()];
+        lines.words.resize(in.count(8));
+        for (Uint64& word : lines.words) word = in.u64();
+    }
+    if (!valid || !in.ok() || !in.atEnd()) {
+        std::cerr << "Warning: " << path << " is not a read lines file of this version; no lines count as read" << std::endl;
+        files.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ReadTracker::save(const std::string& path) const {
+    std::vector<Uint8> bytes;
+    SnapshotWriter out(bytes);
+    for (char c : READ_LINES_MAGIC) out.u8((Uint8)c);
+    out.u32(READ_LINES_VERSION);
+    out.u32((Uint32)files.size());
+    for (const auto& file : files) {
+        out.str(file.first);
+        out.u32((Uint32)file.second.words.size());
+        for (Uint64 word : file.second.words) out.u64(word);
+    }
+    if (!writeFileAtomically(path, bytes)) {
+        std::cerr << "Warning: Could not write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+// read_tracker.h - Which dialog lines the player has read, per story file, kept between sessions
+#pragma once
+#include <SDL3/SDL.h>       // For Uint64
+#include <string>           // For std::string
+#include <vector>           // For std::vector
+#include <unordered_map>    // For std::unordered_map
+
+// --- ReadLineSet ---
+// One bit per dialog line of a file: a 100,000-line script takes 12.5 KB.
+struct ReadLineSet {
+    std::vector<Uint64> words;
+
+    bool isRead(size_t line) const {
+        return line / 64 < words.size() && (words[line / 64] >> (line % 64)) & 1;
+    }
+
+    void markRead(size_t line) {
+        if (line / 64 >= words.size()) words.resize(line / 64 + 1, 0);
+        words[line / 64] |= (Uint64)1 << (line % 64);
+    }
+};
+
+// --- ReadTracker ---
+// Read lines by story file name. The file is "VNRD", a version, then each story file's name and
+// bit words, little-endian like the save snapshots.
+class ReadTracker {
+public:
+    // The set of a story file, created empty on first use. The reference stays valid until load().
+    ReadLineSet& getFile(const std::string& file);
+
+    // Replaces what's tracked with a file written by save(). A missing file leaves nothing read
+    // (the first session); an unreadable one is reported and also leaves nothing read.
+    bool load(const std::string& path);
+
+    // Writes everything tracked, replacing the file in one step.
+    bool save(const std::string& path) const;
+
+private:
+    std::unordered_map<std::string, ReadLineSet> files;
+};
@@ -0,0 +1,112 @@
+// render_stats.cpp - Implementation of the renderer resource counters
+#include "render_stats.h"   // Include the corresponding header
+#include <ostream>          // For std::ostream
+#include <algorithm>        // For std::max
+
+static thread_local RenderStats stats;
+
+// --- Frames ---
+static void addCounters(RenderCounters& into, const RenderCounters& c) {
+    into.drawCalls += c.drawCalls;
+    into.textRenders += c.textRenders;
+    into.texturesCreated += c.texturesCreated;
+    into.texturesDestroyed += c.texturesDestroyed;
+    into.bytesUploaded += c.bytesUploaded;
+}
+
+static void maxCounters(RenderCounters& into, const RenderCounters& c) {
+    into.drawCalls = std::max(into.drawCalls, c.drawCalls);
+    into.textRenders = std::max(into.textRenders, c.textRenders);
+    into.texturesCreated = std::max(into.texturesCreated, c.texturesCreated);
+    into.texturesDestroyed = std::max(into.texturesDestroyed, c.texturesDestroyed);
+    into.bytesUploaded = std::max(into.bytesUploaded, c.bytesUploaded);
+}
+
+void endRenderStatsFrame() {
+    stats.lastFrame = stats.current;
+    addCounters(stats.total, stats.current);
+    maxCounters(stats.peak, stats.current);
+    stats.current = RenderCounters();
+    stats.frames++;
+}
+
+const RenderStats& getRenderStats() {
+    return stats;
+}
+
+void resetRenderStats() {
+    stats = RenderStats();
+}
+
+void printRenderStats(std::ostream& out) {
+    const RenderCounters& t = stats.total;
+    const RenderCounters& p = stats.peak;
+    const double frames = (double)std::max<Uint64>(1, stats.frames);
+    out << "Render stats over " << stats.frames << " frames (average / peak per frame): "
+        << t.drawCalls / frames << " / " << p.drawCalls << " draw calls, "
+        << t.textRenders / frames << " / " << p.textRenders << " text renders, "
+        << t.texturesCreated / frames << " / " << p.texturesCreated << " textures created, "
+        << t.texturesDestroyed / frames << " / " << p.texturesDestroyed << " destroyed, "
+        << t.bytesUploaded / frames / 1024.0 << " / " << p.bytesUploaded / 1024.0 << " KiB uploaded" << std::endl;
+}
+
+// --- Counted Calls ---
+SDL_Texture* countedCreateTextureFromSurface(SDL_Renderer* renderer, SDL_Surface* surface) {
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    if (texture) {
+        stats.current.texturesCreated++;
+        stats.current.bytesUploaded += (Uint64)surface->pitch * (Uint64)surface->h;
+    }
+    return texture;
+}
+
+SDL_Texture* countedCreateTexture(SDL_Renderer* renderer, SDL_PixelFormat format, SDL_TextureAccess access, int w, int h) {
+    SDL_Texture* texture = SDL_CreateTexture(renderer, format, access, w, h);
+    if (texture) {
+        stats.current.texturesCreated++; // No pixels are uploaded
+    }
+    return texture;
+}
+
+void countedDestroyTexture(SDL_Texture* texture) {
+    if (texture) {
+        stats.current.texturesDestroyed++;
+    }
+    SDL_DestroyTexture(texture);
+}
+
+bool countedRenderTexture(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_FRect* srcrect, const SDL_FRect* dstrect) {
+    stats.current.drawCalls++;
+    return SDL_RenderTexture(renderer, texture, srcrect, dstrect);
+}
+
+bool countedRenderFillRect(SDL_Renderer* renderer, const SDL_FRect* rect) {
+    stats.current.drawCalls++;
+    return SDL_RenderFillRect(renderer, rect);
+}
+
+bool countedRenderRect(SDL_Renderer* renderer, const SDL_FRect* rect) {
+    stats.current.drawCalls++;
+    return SDL_RenderRect(renderer, rect);
+}
+
+bool countedRenderGeometry(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Vertex* vertices, int numVertices,
+                           const int* indices, int numIndices) {
+    stats.current.drawCalls++;
+    return SDL_RenderGeometry(renderer, texture, vertices, numVertices, indices, numIndices);
+}
+
+SDL_Surface* countedRenderText_Blended(TTF_Font* font, const char* text, size_t length, SDL_Color fg) {
+    stats.current.textRenders++;
+    return TTF_RenderText_Blended(font, text, length, fg);
+}
+
+SDL_Surface* countedRenderText_Blended_Wrapped(TTF_Font* font, const char* text, size_t length, SDL_Color fg, int wrapWidth) {
+    stats.current.textRenders++;
+    return TTF_RenderText_Blended_Wrapped(font, text, length, fg, wrapWidth);
+}
+
+bool countedDrawRendererText(TTF_Text* text, float x, float y) {
+    stats.current.drawCalls++;
+    return TTF_DrawRendererText(text, x, y);
+}
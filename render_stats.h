@@ -0,0 +1,55 @@
+// render_stats.h - Counted wrappers over the renderer calls, with per-frame resource counters
+#pragma once
+#include <SDL3/SDL.h>       // For SDL_Renderer, SDL_Texture, SDL_Surface, SDL_FRect, Uint64
+#include <SDL3_ttf/SDL_ttf.h> // For TTF_Font, TTF_Render*
+#include <iosfwd>           // For std::ostream
+
+// --- Counters ---
+// Every draw, rasterization and texture creation in the project goes through the wrappers below,
+// so texture churn shows up as numbers instead of guesses. Counters are per thread (the batch
+// renderer's workers each count their own frames) and cost one increment per call.
+struct RenderCounters {
+    Uint64 drawCalls = 0;          // SDL_RenderTexture / FillRect / Rect / Geometry, TTF_DrawRendererText
+    Uint64 textRenders = 0;        // TTF_Render* rasterizations
+    Uint64 texturesCreated = 0;
+    Uint64 texturesDestroyed = 0;
+    Uint64 bytesUploaded = 0;      // Surface pixel bytes copied into new textures
+};
+
+struct RenderStats {
+    RenderCounters current;        // Since the last endRenderStatsFrame()
+    RenderCounters lastFrame;
+    RenderCounters total;
+    RenderCounters peak;           // Largest value of each counter in any single frame
+    Uint64 frames = 0;
+};
+
+// Closes the current frame: it becomes lastFrame and is added to the totals and peaks.
+// Work done between frames (story loading, resizes) is counted in the next frame.
+void endRenderStatsFrame();
+
+// This thread's counters.
+const RenderStats& getRenderStats();
+
+void resetRenderStats();
+
+// One-line summary of the totals and per-frame averages and peaks.
+void printRenderStats(std::ostream& out);
+
+// --- Counted Calls ---
+// Same signatures and results as the SDL/SDL_ttf functions they wrap.
+SDL_Texture* countedCreateTextureFromSurface(SDL_Renderer* renderer, SDL_Surface* surface);
+SDL_Texture* countedCreateTexture(SDL_Renderer* renderer, SDL_PixelFormat format, SDL_TextureAccess access, int w, int h);
+void countedDestroyTexture(SDL_Texture* texture);
+
+bool countedRenderTexture(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_FRect* srcrect, const SDL_FRect* dstrect);
+bool countedRenderFillRect(SDL_Renderer* renderer, const SDL_FRect* rect);
+bool countedRenderRect(SDL_Renderer* renderer, const SDL_FRect* rect);
+bool countedRenderGeometry(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Vertex* vertices, int numVertices,
+                           const int* indices, int numIndices);
+
+SDL_Surface* countedRenderText_Blended(TTF_Font* font, const char* text, size_t length, SDL_Color fg);
+SDL_Surface* countedRenderText_Blended_Wrapped(TTF_Font* font, const char* text, size_t length, SDL_Color fg, int wrapWidth);
+
+// TTF_Text objects keep their glyphs in the text engine's atlas, so drawing one is a draw call but no rasterization
+bool countedDrawRendererText(TTF_Text* text, float x, float y);
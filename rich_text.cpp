@@ -0,0 +1,548 @@
+// rich_text.cpp - Implementation of dialog markup parsing and shaped text
+#include "rich_text.h"      // Include the corresponding header
+#include <iostream>         // For std::cerr
+#include <cmath>            // For std::ceil, std::sin, std::floor, std::fabs
+#include <cstdlib>          // For std::strtoul
+#include <cctype>           // For std::isxdigit
+#include <algorithm>        // For std::min, std::max, std::upper_bound
+#include "render_stats.h"   // For counted draw calls and texture creation
+#include "utf8_text.h"      // For decodeUtf8, isBreakAnywhereCodepoint
+
+// --- Markup Parsing ---
+namespace {
+
+enum SpanKind { SPAN_COLOR, SPAN_BOLD, SPAN_ITALIC, SPAN_PULSE };
+
+struct OpenSpan {
+    SpanKind kind;
+    SDL_Color color;
+};
+
+// The style in effect for the given stack of open spans (innermost color wins)
+TextStyleRun styleOf(const std::vector<OpenSpan>& spans) {
+    TextStyleRun style = {0, 0, {255, 255, 255, 255}, false, TTF_STYLE_NORMAL, false};
+    for (const auto& span : spans) {
+        switch (span.kind) {
+            case SPAN_COLOR:  style.color = span.color; style.hasColor = true; break;
+            case SPAN_BOLD:   style.fontStyle |= TTF_STYLE_BOLD; break;
+            case SPAN_ITALIC: style.fontStyle |= TTF_STYLE_ITALIC; break;
+            case SPAN_PULSE:  style.pulse = true; break;
+        }
+    }
+    return style;
+}
+
+bool sameStyle(const TextStyleRun& a, const TextStyleRun& b) {
+    if (a.hasColor != b.hasColor || a.fontStyle != b.fontStyle || a.pulse != b.pulse) return false;
+    return !a.hasColor || (a.color.r == b.color.r && a.color.g == b.color.g && a.color.b == b.color.b && a.color.a == b.color.a);
+}
+
+bool parseHexColor(const std::string& hex, SDL_Color& color) {
+    if ((hex.size() != 7 && hex.size() != 9) || hex[0] != '#') return false;
+    for (size_t i = 1; i < hex.size(); ++i) {
+        if (!std::isxdigit((unsigned char)hex[i])) return false;
+    }
+    unsigned long value = std::strtoul(hex.c_str() + 1, nullptr, 16);
+    if (hex.size() == 7) value = (value << 8) | 0xFF; // Opaque unless alpha is given
+    color = {(Uint8)(value >> 24), (Uint8)(value >> 16), (Uint8)(value >> 8), (Uint8)value};
+    return true;
+}
+
+} // namespace
+
+bool parseRichText(std::string_view markup, std::string& plain, std::vector<TextStyleRun>& runs,
+                   std::vector<TextTiming>& timings, std::string& error) {
+    plain.clear();
+    runs.clear();
+    timings.clear();
+    error.clear();
+
+    std::vector<OpenSpan> spans;
+    int openSpeed = 0;
+    int openInstant = 0;
+    TextStyleRun currentStyle = styleOf(spans);
+
+    auto fail = [&](const std::string& message) {
+        if (error.empty()) error = message; // Keep the first problem; parsing carries on
+    };
+
+    for (size_t i = 0; i < markup.size(); ) {
+        char c = markup[i];
+        if (c == '{' && i + 1 < markup.size() && markup[i + 1] == '{') {
+            c = '{'; // Escaped brace: falls through to the literal character below
+            i++;
+        } else if (c == '{') {
+            size_t close = markup.find('}', i + 1);
+            if (close == std::string::npos) {
+                fail("missing '}' after '{'");
+                c = '{'; // Keep the rest as literal text
+            } else {
+                std::string tag(markup.substr(i + 1, close - i - 1));
+                i = close + 1;
+
+                if (tag == "b") spans.push_back({SPAN_BOLD, {}});
+                else if (tag == "i") spans.push_back({SPAN_ITALIC, {}});
+                else if (tag == "pulse") spans.push_back({SPAN_PULSE, {}});
+                else if (tag.rfind("color=", 0) == 0) {
+                    SDL_Color color;
+                    if (parseHexColor(tag.substr(6), color)) spans.push_back({SPAN_COLOR, color});
+                    else { fail("invalid color in {" + tag + "}"); spans.push_back({SPAN_COLOR, {255, 255, 255, 255}}); }
+                } else if (tag.rfind("pause=", 0) == 0 || tag.rfind("speed=", 0) == 0) {
+                    char* end = nullptr;
+                    unsigned long ms = std::strtoul(tag.c_str() + 6, &end, 10);
+                    if (end == tag.c_str() + 6 || *end != '\0') {
+                        fail("invalid duration in {" + tag + "}");
+                    } else if (tag[0] == 'p') {
+                        timings.push_back({(Uint32)plain.size(), TEXT_TIMING_PAUSE, (Uint32)ms});
+                    } else {
+                        timings.push_back({(Uint32)plain.size(), TEXT_TIMING_SPEED, (Uint32)ms});
+                        openSpeed++;
+                    }
+                } else if (tag == "/speed") {
+                    if (openSpeed == 0) fail("{/speed} without a matching opening tag");
+                    else { timings.push_back({(Uint32)plain.size(), TEXT_TIMING_SPEED_END, 0}); openSpeed--; }
+                } else if (tag == "instant") {
+                    timings.push_back({(Uint32)plain.size(), TEXT_TIMING_INSTANT, 0});
+                    openInstant++;
+                } else if (tag == "/instant") {
+                    if (openInstant == 0) fail("{/instant} without a matching opening tag");
+                    else { timings.push_back({(Uint32)plain.size(), TEXT_TIMING_INSTANT_END, 0}); openInstant--; }
+                } else if (tag == "/b" || tag == "/i" || tag == "/pulse" || tag == "/color") {
+                    SpanKind kind = (tag == "/b") ? SPAN_BOLD : (tag == "/i") ? SPAN_ITALIC : (tag == "/pulse") ? SPAN_PULSE : SPAN_COLOR;
+                    size_t s = spans.size();
+                    while (s > 0 && spans[s - 1].kind != kind) s--;
+                    if (s == 0) fail("{" + tag + "} without a matching opening tag");
+                    else spans.erase(spans.begin() + (s - 1));
+                } else {
+                    fail("unknown tag {" + tag + "}");
+                }
+                currentStyle = styleOf(spans);
+                continue;
+            }
+        }
+
+        // Literal character: start a new run whenever the style changed since the last one
+        if (runs.empty() || !sameStyle(runs.back(), currentStyle)) {
+            if (!runs.empty()) runs.back().end = (Uint32)plain.size();
+            runs.push_back(currentStyle);
+            runs.back().start = (Uint32)plain.size();
+        }
+        plain += c;
+        i++;
+    }
+    if (!runs.empty()) runs.back().end = (Uint32)plain.size();
+
+    if (!spans.empty() || openSpeed > 0 || openInstant > 0) fail("unclosed span at the end of the line");
+    return error.empty();
+}
+
+// --- Reveal Timeline ---
+void buildRevealTimeline(std::string_view text, const Uint32* graphemeStarts, size_t graphemeCount,
+                         const std::vector<TextTiming>& timings, float charDelayMs, std::vector<Uint32>& timeline) {
+    const size_t base = timeline.size();
+    timeline.resize(base + graphemeCount, 0);
+
+    double t = 0.0;                  // Microseconds
+    double delay = charDelayMs * 1000.0;
+    std::vector<double> speedStack;  // Delays to return to at each {/speed}
+    int instantDepth = 0;
+    bool instantStepTaken = false;   // An {instant} span takes one step as a whole
+    size_t mark = 0;
+
+    for (size_t g = 0; g < graphemeCount; ++g) {
+        const size_t start = graphemeStarts[g];
+        const size_t end = graphemeStarts[g + 1];
+        // Marks inside a cluster take effect at the next one
+        for (; mark < timings.size() && timings[mark].charIndex <= start; ++mark) {
+            const TextTiming& timing = timings[mark];
+            switch (timing.kind) {
+                case TEXT_TIMING_PAUSE:       t += timing.value * 1000.0; break;
+                case TEXT_TIMING_SPEED:       speedStack.push_back(delay); delay = timing.value * 1000.0; break;
+                case TEXT_TIMING_SPEED_END:   if (!speedStack.empty()) { delay = speedStack.back(); speedStack.pop_back(); } break;
+                case TEXT_TIMING_INSTANT:     if (instantDepth++ == 0) instantStepTaken = false; break;
+                case TEXT_TIMING_INSTANT_END: if (instantDepth > 0) instantDepth--; break;
+            }
+        }
+
+        if (instantDepth == 0 || !instantStepTaken) {
+            t += delay;
+            instantStepTaken = instantDepth > 0;
+        }
+        timeline[base + g] = (Uint32)std::min(t, 4294967295.0);
+
+        // Punctuation holds back the next word, but not the rest of "..." or "?!"
+        const char c = text[end - 1];
+        const bool beforeSpace = end < text.size() && (text[end] == ' ' || text[end] == '\t');
+        if (instantDepth == 0 && beforeSpace) {
+            if (c == '.' || c == '!' || c == '?') t += delay * REVEAL_SENTENCE_PAUSE_DELAYS;
+            else if (c == ',' || c == ';' || c == ':') t += delay * REVEAL_CLAUSE_PAUSE_DELAYS;
+        }
+    }
+}
+
+size_t countRevealedGraphemes(const Uint32* timeline, size_t graphemeCount, Uint64 elapsedNS) {
+    const Uint64 elapsedUs = elapsedNS / 1000;
+    if (elapsedUs >= 0xFFFFFFFFu) return graphemeCount;
+    return (size_t)(std::upper_bound(timeline, timeline + graphemeCount, (Uint32)elapsedUs) - timeline);
+}
+
+Uint64 getGraphemeRevealOffsetNS(const Uint32* timeline, size_t graphemeCount, size_t grapheme) {
+    if (graphemeCount == 0) return 0;
+    return (Uint64)timeline[std::min(grapheme, graphemeCount - 1)] * 1000;
+}
+
+// --- Layout ---
+namespace {
+
+bool isWrapSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// Marks the cluster boundaries of text, so atoms and partial reveals never split a character
+void markClusterStarts(std::string_view text, const Uint32* graphemeStarts, size_t graphemeCount,
+                       std::vector<char>& clusterStart) {
+    clusterStart.assign(text.size() + 1, 0);
+    for (size_t g = 0; g <= graphemeCount; ++g) clusterStart[graphemeStarts[g]] = 1;
+}
+
+// Sets the font style only when it changes, and puts the original back when done
+class FontStyleScope {
+public:
+    explicit FontStyleScope(TTF_Font* font) : font(font), original(TTF_GetFontStyle(font)), active(original) {}
+    ~FontStyleScope() { use(original); }
+    void use(TTF_FontStyleFlags style) {
+        if (style != active) {
+            TTF_SetFontStyle(font, style);
+            active = style;
+        }
+    }
+
+private:
+    TTF_Font* font;
+    TTF_FontStyleFlags original;
+    TTF_FontStyleFlags active;
+};
+
+} // namespace
+
+void layoutRichText(TTF_Font* font, FontMetrics* styleMetrics, std::string_view text,
+                    const Uint32* graphemeStarts, size_t graphemeCount,
+                    const TextStyleRun* runs, size_t runCount, int wrapWidth, TextLayout& out) {
+    out.atoms.clear();
+    out.words.clear();
+    out.wrapWidth = wrapWidth;
+    out.rowCount = 0;
+    out.width = 0.0f;
+    if (!font) return;
+    out.lineHeight = TTF_GetFontLineSkip(font);
+    out.fontHeight = TTF_GetFontHeight(font);
+    if (text.empty() || runCount == 0) return;
+
+    std::vector<char> clusterStart;
+    markClusterStarts(text, graphemeStarts, graphemeCount, clusterStart);
+    auto clusterEnd = [&](Uint32 i, Uint32 limit) {
+        do { i++; } while (i < limit && !clusterStart[i]);
+        return i;
+    };
+    auto isBreakAnywhereAt = [&](Uint32 i) {
+        size_t pos = i;
+        return (unsigned char)text[i] >= 0x80 && isBreakAnywhereCodepoint(decodeUtf8(text, pos));
+    };
+
+    // 1. Split runs into atoms and measure them in their run's style, from the cached metrics
+    FontStyleScope style(font);
+    bool afterBreakAnywhere = false;
+    for (Uint32 r = 0; r < (Uint32)runCount; ++r) {
+        style.use(runs[r].fontStyle);
+        FontMetrics& metrics = styleMetrics[runs[r].fontStyle & (FONT_METRICS_STYLES - 1)];
+        metrics.bind(font);
+        for (Uint32 i = runs[r].start; i < runs[r].end; ) {
+            const bool space = isWrapSpace(text[i]);
+            const bool breakAnywhere = !space && isBreakAnywhereAt(i);
+            Uint32 j = clusterEnd(i, runs[r].end);
+            if (!breakAnywhere) {
+                while (j < runs[r].end && isWrapSpace(text[j]) == space && (space || !isBreakAnywhereAt(j))) {
+                    j = clusterEnd(j, runs[r].end);
+                }
+            }
+            const float w = (float)metrics.measure(text.substr(i, j - i));
+            out.atoms.push_back({i, j, r, space, !space && (breakAnywhere || afterBreakAnywhere), w, 0.0f, 0});
+            afterBreakAnywhere = breakAnywhere;
+            i = j;
+        }
+    }
+
+    // 2. Greedy word wrap. A word may span several runs ("{b}bo{/b}ld"), so it is measured as a
+    //    whole before deciding whether it fits; spaces stay at the end of the row they follow.
+    std::vector<LayoutAtom>& atoms = out.atoms;
+    float x = 0.0f;
+    int row = 0;
+    for (size_t a = 0; a < atoms.size(); ) {
+        if (atoms[a].space) {
+            atoms[a].x = x;
+            atoms[a].row = row;
+            x += atoms[a].width;
+            a++;
+            continue;
+        }
+        size_t b = a;
+        float wordWidth = 0.0f;
+        while (b < atoms.size() && !atoms[b].space && (b == a || !atoms[b].breakBefore)) wordWidth += atoms[b++].width;
+        if (wrapWidth > 0 && x + wordWidth > (float)wrapWidth && x > 0.0f) {
+            row++;
+            x = 0.0f;
+        }
+        out.words.push_back({atoms[a].start, atoms[b - 1].end, x, row, wordWidth});
+        out.width = std::max(out.width, x + wordWidth);
+        for (; a < b; ++a) {
+            atoms[a].x = x;
+            atoms[a].row = row;
+            x += atoms[a].width;
+        }
+    }
+    out.rowCount = row + 1;
+}
+
+// --- Shaping ---
+bool shapeRichText(SDL_Renderer* renderer, TTF_Font* font, std::string_view text,
+                   const Uint32* graphemeStarts, size_t graphemeCount,
+                   const TextStyleRun* runs, const TextLayout& layout, ShapedText& out) {
+    destroyShapedText(out);
+    if (!renderer || !font || text.empty() || layout.atoms.empty()) {
+        return true; // Nothing to draw
+    }
+
+    // 3. Merge neighbouring atoms of the same run and row into pieces
+    out.lineHeight = layout.lineHeight;
+    const int fontHeight = layout.fontHeight;
+    for (const LayoutAtom& atom : layout.atoms) {
+        if (!out.pieces.empty()) {
+            ShapedPiece& last = out.pieces.back();
+            if (last.run == atom.run && last.y == (float)(atom.row * out.lineHeight)) {
+                last.end = atom.end;
+                last.w = atom.x + atom.width - last.x;
+                continue;
+            }
+        }
+        ShapedPiece piece;
+        piece.start = atom.start;
+        piece.end = atom.end;
+        piece.run = atom.run;
+        piece.x = atom.x;
+        piece.y = (float)(atom.row * out.lineHeight);
+        piece.w = atom.width;
+        piece.h = (float)fontHeight;
+        out.pieces.push_back(piece);
+    }
+
+    float maxRight = 0.0f;
+    for (const auto& piece : out.pieces) maxRight = std::max(maxRight, piece.x + piece.w);
+    out.width = std::max(1, (int)std::ceil(maxRight));
+    out.height = std::max(1, (layout.rowCount - 1) * out.lineHeight + std::max(fontHeight, out.lineHeight));
+
+    std::vector<char> clusterStart;
+    markClusterStarts(text, graphemeStarts, graphemeCount, clusterStart);
+    FontStyleScope style(font);
+
+    // 4. Rasterize every piece in white into one canvas, recording prefix widths for partial reveal
+    SDL_Surface* canvas = SDL_CreateSurface(out.width, out.height, SDL_PIXELFORMAT_ARGB8888);
+    if (!canvas) {
+        std::cerr << "Unable to create shaped text canvas! SDL_Error: " << SDL_GetError() << std::endl;
+        out.pieces.clear();
+        return false;
+    }
+    SDL_FillSurfaceRect(canvas, nullptr, 0); // Fully transparent
+
+    const SDL_Color white = {255, 255, 255, 255};
+    for (auto& piece : out.pieces) {
+        style.use(runs[piece.run].fontStyle);
+        const char* pieceText = text.data() + piece.start;
+        const size_t length = piece.end - piece.start;
+
+        piece.prefixWidth.assign(length + 1, 0.0f);
+        size_t glyphStart = 0;
+        for (size_t i = 1; i <= length; ++i) {
+            if (i < length && !clusterStart[piece.start + i]) {
+                piece.prefixWidth[i] = piece.prefixWidth[i - 1]; // Mid-cluster: the reveal never stops here
+                continue;
+            }
+            int w = 0;
+            TTF_GetStringSize(font, pieceText, i, &w, nullptr);
+            piece.prefixWidth[i] = (float)w;
+
+            // The cluster that just ended becomes a glyph cell, cut from the piece at the same widths
+            if (!isWrapSpace(pieceText[glyphStart])) {
+                const float glyphX = piece.prefixWidth[glyphStart];
+                out.glyphs.push_back({piece.start + (Uint32)glyphStart, piece.run, piece.x + glyphX, piece.y,
+                                      piece.prefixWidth[i] - glyphX, piece.h});
+            }
+            glyphStart = i;
+        }
+
+        bool allSpace = true;
+        for (size_t i = 0; i < length && allSpace; ++i) allSpace = isWrapSpace(pieceText[i]);
+        if (allSpace) continue;
+
+        SDL_Surface* pieceSurface = countedRenderText_Blended(font, pieceText, length, white);
+        if (!pieceSurface) {
+            std::cerr << "Unable to render shaped text piece! SDL_Error: " << SDL_GetError() << std::endl;
+            continue;
+        }
+        SDL_SetSurfaceBlendMode(pieceSurface, SDL_BLENDMODE_NONE); // Copy coverage as is
+        SDL_Rect dst = {(int)piece.x, (int)piece.y, pieceSurface->w, pieceSurface->h};
+        SDL_BlitSurface(pieceSurface, nullptr, canvas, &dst);
+        SDL_DestroySurface(pieceSurface);
+    }
+
+    out.texture = countedCreateTextureFromSurface(renderer, canvas);
+    SDL_DestroySurface(canvas);
+    if (!out.texture) {
+        std::cerr << "Unable to create shaped text texture! SDL_Error: " << SDL_GetError() << std::endl;
+        out.pieces.clear();
+        return false;
+    }
+    SDL_SetTextureBlendMode(out.texture, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+void renderShapedText(SDL_Renderer* renderer, ShapedText& shaped, const std::vector<SDL_Color>& runColors,
+                      size_t visibleBytes, float x, float y) {
+    if (!shaped.texture) return;
+
+    shaped.vertices.clear();
+    shaped.indices.clear();
+    const float invWidth = 1.0f / (float)shaped.width;
+    const float invHeight = 1.0f / (float)shaped.height;
+
+    for (const auto& piece : shaped.pieces) {
+        if (piece.start >= visibleBytes) break; // Pieces are in text order
+        const size_t visibleEnd = std::min((size_t)piece.end, visibleBytes);
+        const float w = piece.prefixWidth[visibleEnd - piece.start];
+        if (w <= 0.0f) continue;
+
+        const SDL_Color c = (piece.run < runColors.size()) ? runColors[piece.run] : SDL_Color{255, 255, 255, 255};
+        const SDL_FColor color = {c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, c.a / 255.0f};
+        const float u0 = piece.x * invWidth, u1 = (piece.x + w) * invWidth;
+        const float v0 = piece.y * invHeight, v1 = (piece.y + piece.h) * invHeight;
+        const int base = (int)shaped.vertices.size();
+        shaped.vertices.push_back({{x + piece.x, y + piece.y}, color, {u0, v0}});
+        shaped.vertices.push_back({{x + piece.x + w, y + piece.y}, color, {u1, v0}});
+        shaped.vertices.push_back({{x + piece.x + w, y + piece.y + piece.h}, color, {u1, v1}});
+        shaped.vertices.push_back({{x + piece.x, y + piece.y + piece.h}, color, {u0, v1}});
+        const int quad[6] = {base, base + 1, base + 2, base, base + 2, base + 3};
+        shaped.indices.insert(shaped.indices.end(), quad, quad + 6);
+    }
+
+    if (!shaped.indices.empty()) {
+        countedRenderGeometry(renderer, shaped.texture, shaped.vertices.data(), (int)shaped.vertices.size(),
+                           shaped.indices.data(), (int)shaped.indices.size());
+    }
+}
+
+// Cheap integer hash (lowbias32) for the per-letter shake: a glyph's offset is a pure function of
+// its index and the shake step, so no random state is kept per glyph.
+static Uint32 hashGlyph(Uint32 index, Uint32 step) {
+    Uint32 h = index * 0x9E3779B9u ^ step * 0x85EBCA6Bu;
+    h ^= h >> 16; h *= 0x7FEB352Du;
+    h ^= h >> 15; h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return h;
+}
+
+// Fully saturated color at `hue` turns (0..1), as 0..1 floats
+static void hueToRgb(float hue, float& r, float& g, float& b) {
+    const float h = (hue - std::floor(hue)) * 6.0f;
+    r = std::min(1.0f, std::max(0.0f, std::fabs(h - 3.0f) - 1.0f));
+    g = std::min(1.0f, std::max(0.0f, 2.0f - std::fabs(h - 2.0f)));
+    b = std::min(1.0f, std::max(0.0f, 2.0f - std::fabs(h - 4.0f)));
+}
+
+void renderAnimatedShapedText(SDL_Renderer* renderer, ShapedText& shaped, const std::vector<SDL_Color>& runColors,
+                              size_t visibleBytes, float x, float y, const GlyphAnimation& animation) {
+    if (!shaped.texture) return;
+
+    shaped.vertices.clear();
+    shaped.indices.clear();
+    shaped.vertices.reserve(shaped.glyphs.size() * 4);
+    shaped.indices.reserve(shaped.glyphs.size() * 6);
+    const float invWidth = 1.0f / (float)shaped.width;
+    const float invHeight = 1.0f / (float)shaped.height;
+    const float TWO_PI = 6.28318531f;
+    const float waveStep = (animation.waveGlyphs > 0.0f) ? TWO_PI / animation.waveGlyphs : 0.0f;
+    const float waveOffset = TWO_PI * animation.wavePhase;
+    const float hueStep = (animation.rainbowGlyphs > 0.0f) ? 1.0f / animation.rainbowGlyphs : 0.0f;
+    const float shakeScale = animation.shakeAmplitude / 32767.5f;
+
+    // One pass over the glyph cells; every term is a few multiplies, so animating a long line costs
+    // about as much as building the static quads
+    const size_t glyphCount = shaped.glyphs.size();
+    for (size_t i = 0; i < glyphCount; ++i) {
+        const ShapedGlyph& glyph = shaped.glyphs[i];
+        if (glyph.start >= visibleBytes) break; // Glyphs are in text order
+
+        float dx = 0.0f, dy = 0.0f;
+        if (animation.waveAmplitude != 0.0f) {
+            dy += animation.waveAmplitude * std::sin(waveOffset - (float)i * waveStep);
+        }
+        if (animation.shakeAmplitude != 0.0f) {
+            const Uint32 h = hashGlyph((Uint32)i, animation.shakeStep);
+            dx += (float)(h & 0xFFFF) * shakeScale - animation.shakeAmplitude;
+            dy += (float)(h >> 16) * shakeScale - animation.shakeAmplitude;
+        }
+
+        const SDL_Color c = (glyph.run < runColors.size()) ? runColors[glyph.run] : SDL_Color{255, 255, 255, 255};
+        SDL_FColor color = {c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, c.a / 255.0f};
+        if (animation.rainbow) {
+            hueToRgb(animation.rainbowPhase + (float)i * hueStep, color.r, color.g, color.b);
+        }
+
+        const float left = x + glyph.x + dx, top = y + glyph.y + dy;
+        const float u0 = glyph.x * invWidth, u1 = (glyph.x + glyph.w) * invWidth;
+        const float v0 = glyph.y * invHeight, v1 = (glyph.y + glyph.h) * invHeight;
+        const int base = (int)shaped.vertices.size();
+        shaped.vertices.push_back({{left, top}, color, {u0, v0}});
+        shaped.vertices.push_back({{left + glyph.w, top}, color, {u1, v0}});
+        shaped.vertices.push_back({{left + glyph.w, top + glyph.h}, color, {u1, v1}});
+        shaped.vertices.push_back({{left, top + glyph.h}, color, {u0, v1}});
+        const int quad[6] = {base, base + 1, base + 2, base, base + 2, base + 3};
+        shaped.indices.insert(shaped.indices.end(), quad, quad + 6);
+    }
+
+    if (!shaped.indices.empty()) {
+        countedRenderGeometry(renderer, shaped.texture, shaped.vertices.data(), (int)shaped.vertices.size(),
+                           shaped.indices.data(), (int)shaped.indices.size());
+    }
+}
+
+float getGlyphAnimationReach(const GlyphAnimation& animation) {
+    return std::fabs(animation.waveAmplitude) + std::fabs(animation.shakeAmplitude);
+}
+
+SDL_FRect getShapedTextBounds(const ShapedText& shaped, size_t fromByte, size_t toByte) {
+    bool found = false;
+    float x0 = 0.0f, y0 = 0.0f, x1 = 0.0f, y1 = 0.0f;
+    for (const auto& piece : shaped.pieces) {
+        if (piece.end <= fromByte || piece.start >= toByte) continue;
+        const float left = piece.x + piece.prefixWidth[std::max(fromByte, (size_t)piece.start) - piece.start];
+        const float right = piece.x + piece.prefixWidth[std::min(toByte, (size_t)piece.end) - piece.start];
+        if (!found) {
+            x0 = left; y0 = piece.y; x1 = right; y1 = piece.y + piece.h;
+            found = true;
+        } else {
+            x0 = std::min(x0, left); y0 = std::min(y0, piece.y);
+            x1 = std::max(x1, right); y1 = std::max(y1, piece.y + piece.h);
+        }
+    }
+    return found ? SDL_FRect{x0, y0, x1 - x0, y1 - y0} : SDL_FRect{0.0f, 0.0f, 0.0f, 0.0f};
+}
+
+void destroyShapedText(ShapedText& shaped) {
+    if (shaped.texture) {
+        countedDestroyTexture(shaped.texture);
+        shaped.texture = nullptr;
+    }
+    shaped.pieces.clear();
+    shaped.glyphs.clear();
+    shaped.width = 0;
+    shaped.height = 0;
+}
@@ -0,0 +1,194 @@
+// rich_text.h - Inline dialog markup, styled runs and cached shaped text
+#pragma once
+#include <SDL3/SDL.h>       // For SDL_Color, SDL_Texture, SDL_Vertex, Uint32
+#include <SDL3_ttf/SDL_ttf.h> // For TTF_Font, TTF_STYLE_*
+#include <string>           // For std::string
+#include <string_view>      // For std::string_view
+#include <vector>           // For std::vector
+#include "font_metrics.h"   // For FontMetrics (cached widths used by the layout)
+
+// --- Markup ---
+// Written inside the quoted dialog text:
+//   {color=#RRGGBB} ... {/color}   (or #RRGGBBAA)
+//   {b} ... {/b}   {i} ... {/i}    bold / italic
+//   {pulse} ... {/pulse}           span cycles between the line's pulse colors
+//   {pause=ms}                     typewriter waits this long before the next character
+//   {speed=ms} ... {/speed}        per-character delay inside the span
+//   {instant} ... {/instant}       span appears all at once
+//   {{                             a literal '{'
+// Tags nest; each closing tag ends the innermost open span of its kind.
+
+// A stretch of the plain text with one style. A line's runs are contiguous and cover the
+// whole text (a line without markup has a single run).
+struct TextStyleRun {
+    Uint32 start;            // Byte range in the plain text
+    Uint32 end;
+    SDL_Color color;         // Only used if hasColor
+    bool hasColor;           // Otherwise the line's current text color applies
+    Uint8 fontStyle;         // TTF_STYLE_NORMAL / BOLD / ITALIC
+    bool pulse;              // {pulse} span
+};
+
+// A change in typewriter pacing before the character at charIndex.
+enum TextTimingKind : Uint8 {
+    TEXT_TIMING_PAUSE,          // Wait `value` ms
+    TEXT_TIMING_SPEED,          // Per-character delay becomes `value` ms
+    TEXT_TIMING_SPEED_END,      // Back to the line's delay
+    TEXT_TIMING_INSTANT,        // Following characters appear together
+    TEXT_TIMING_INSTANT_END
+};
+
+struct TextTiming {
+    Uint32 charIndex;        // Byte index in the plain text
+    Uint8 kind;              // TextTimingKind
+    Uint32 value;
+};
+
+// Strips the markup from `markup` into `plain`, producing runs and timing marks (sorted by index).
+// The outputs are overwritten, so callers can reuse them as scratch buffers across lines.
+// Returns false with a message in `error` for malformed or unclosed tags; the outputs are still
+// usable (bad tags are dropped, unclosed spans run to the end of the line).
+bool parseRichText(std::string_view markup, std::string& plain, std::vector<TextStyleRun>& runs,
+                   std::vector<TextTiming>& timings, std::string& error);
+
+// --- Reveal Timeline ---
+// Each line's pacing is compiled once at load into a non-decreasing array with one entry per
+// grapheme cluster (see utf8_text.h): timeline[g] is the time (microseconds after the line starts)
+// at which cluster g appears, so an accented letter, a CJK character or an emoji sequence is never
+// cut in the middle. Clusters come one per delay, punctuation followed by a space adds a pause of a
+// few delays and an {instant} span appears whole in one step. Any point of the reveal is a binary
+// search, so skipping ahead costs the same as advancing one step.
+
+// Pause after . ! ? and after , ; : in units of the current per-character delay
+const float REVEAL_SENTENCE_PAUSE_DELAYS = 6.0f;
+const float REVEAL_CLAUSE_PAUSE_DELAYS = 3.0f;
+
+// Appends graphemeCount entries to `timeline` (several lines' timelines can share one array).
+// graphemeStarts holds graphemeCount + 1 byte offsets into text, as built by appendGraphemeStarts.
+void buildRevealTimeline(std::string_view text, const Uint32* graphemeStarts, size_t graphemeCount,
+                         const std::vector<TextTiming>& timings, float charDelayMs, std::vector<Uint32>& timeline);
+
+// How many of a line's clusters are visible elapsedNS after it started.
+size_t countRevealedGraphemes(const Uint32* timeline, size_t graphemeCount, Uint64 elapsedNS);
+
+// Time after the line started at which cluster `grapheme` appears.
+Uint64 getGraphemeRevealOffsetNS(const Uint32* timeline, size_t graphemeCount, size_t grapheme);
+
+// --- Layout ---
+// The single word wrapper for dialog text: a line is laid out once per (text, font, width) and
+// every way of drawing it reads the same result. The shaped typewriter text rasterizes its
+// atoms, and the jitter/physics effects create their words at the layout's word positions, so
+// switching to an effect doesn't move any text. Rows break at spaces, and between the clusters of
+// scripts written without spaces.
+
+// A stretch of one run that is either all spaces or all non-spaces; the unit of wrapping.
+struct LayoutAtom {
+    Uint32 start;            // Byte range in the plain text
+    Uint32 end;
+    Uint32 run;              // Index of the run the atom belongs to
+    bool space;
+    bool breakBefore;        // A row may start here even though no space precedes it (CJK)
+    float width;
+    float x;                 // Position in its row
+    int row;
+};
+
+// Non-space atoms that wrap together (a word can span several runs).
+struct LayoutWord {
+    Uint32 start;            // Byte range in the plain text
+    Uint32 end;
+    float x;
+    int row;
+    float width;
+};
+
+struct TextLayout {
+    int wrapWidth = 0;
+    int lineHeight = 0;      // Distance between rows
+    int fontHeight = 0;      // Height of a row's glyphs
+    int rowCount = 0;
+    float width = 0.0f;      // Widest row
+    std::vector<LayoutAtom> atoms; // In text order, covering the text
+    std::vector<LayoutWord> words; // In text order
+};
+
+// Lays `text` out at wrapWidth (0 = no wrapping) with the run styles. Widths come from
+// styleMetrics, an array of FONT_METRICS_STYLES entries indexed by a run's bold/italic bits,
+// each bound to `font` in that style as needed. graphemeStarts holds graphemeCount + 1 cluster
+// offsets as built by appendGraphemeStarts.
+void layoutRichText(TTF_Font* font, FontMetrics* styleMetrics, std::string_view text,
+                    const Uint32* graphemeStarts, size_t graphemeCount,
+                    const TextStyleRun* runs, size_t runCount, int wrapWidth, TextLayout& out);
+
+// --- Shaped Text ---
+// A line wrapped and rasterized once: all pieces are drawn in white into a single texture,
+// then tinted per run with vertex colors, so a line with many spans is still one draw call.
+struct ShapedPiece {
+    Uint32 start;            // Byte range in the plain text
+    Uint32 end;
+    Uint32 run;              // Index of the run the piece belongs to
+    float x, y;              // Position relative to the text origin, which is also its place in the texture
+    float w, h;
+    std::vector<float> prefixWidth; // prefixWidth[i]: width of the piece's first i bytes (for partial reveal)
+};
+
+// One visible grapheme cluster of the shaped text: its cell in the texture, for per-glyph effects.
+struct ShapedGlyph {
+    Uint32 start;            // Byte offset of the cluster in the plain text
+    Uint32 run;
+    float x, y;              // Position relative to the text origin (and in the texture)
+    float w, h;
+};
+
+struct ShapedText {
+    SDL_Texture* texture = nullptr;
+    int width = 0;
+    int height = 0;
+    int lineHeight = 0;
+    std::vector<ShapedPiece> pieces;
+    std::vector<ShapedGlyph> glyphs; // Non-space clusters in text order
+
+    // Scratch buffers for renderShapedText, kept to avoid per-frame allocations
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+// Rasterizes `text` as laid out by layoutRichText (same text, font, clusters and runs).
+// Any previous contents of `out` are destroyed first. Returns false if rasterizing failed.
+bool shapeRichText(SDL_Renderer* renderer, TTF_Font* font, std::string_view text,
+                   const Uint32* graphemeStarts, size_t graphemeCount,
+                   const TextStyleRun* runs, const TextLayout& layout, ShapedText& out);
+
+// Draws the first visibleBytes bytes of shaped text at (x, y), tinting each run with
+// runColors[run], in a single SDL_RenderGeometry call.
+void renderShapedText(SDL_Renderer* renderer, ShapedText& shaped, const std::vector<SDL_Color>& runColors,
+                      size_t visibleBytes, float x, float y);
+
+// Per-glyph animation for renderAnimatedShapedText. Phases are in turns, so the caller decides how
+// time maps to motion; a default-constructed animation draws the text static.
+struct GlyphAnimation {
+    float waveAmplitude = 0.0f;  // Sine wave along the text: pixels up and down
+    float wavePhase = 0.0f;
+    float waveGlyphs = 8.0f;     // Glyphs per wave length
+    float shakeAmplitude = 0.0f; // Per-letter shake: pixels each way, a new random offset every shakeStep
+    Uint32 shakeStep = 0;
+    float rainbowPhase = 0.0f;   // Hue cycling; replaces the run colors (keeping their alpha) when rainbow is set
+    float rainbowGlyphs = 12.0f; // Glyphs per full turn of the hue
+    bool rainbow = false;
+
+    bool isAnimated() const { return waveAmplitude != 0.0f || shakeAmplitude != 0.0f || rainbow; }
+};
+
+// Draws the first visibleBytes bytes of shaped text like renderShapedText, but as one quad per
+// glyph moved and colored by `animation`, still in a single SDL_RenderGeometry call.
+void renderAnimatedShapedText(SDL_Renderer* renderer, ShapedText& shaped, const std::vector<SDL_Color>& runColors,
+                              size_t visibleBytes, float x, float y, const GlyphAnimation& animation);
+
+// How far any glyph can move from its place under `animation`, in pixels (for dirty rects).
+float getGlyphAnimationReach(const GlyphAnimation& animation);
+
+// Bounds of the text between two reveal positions, relative to the text origin (for dirty rects).
+// Returns an empty rect if no piece overlaps the range.
+SDL_FRect getShapedTextBounds(const ShapedText& shaped, size_t fromByte, size_t toByte);
+
+void destroyShapedText(ShapedText& shaped);
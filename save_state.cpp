@@ -0,0 +1,196 @@
+// save_state.cpp - Implementation of save snapshot encoding and the save slot writer
+#include "save_state.h"     // Include the corresponding header
+#include <cstring>          // For std::memcpy
+#include <filesystem>       // For std::filesystem::rename, remove
+#include <fstream>          // For std::ifstream, std::ofstream
+#include <iostream>         // For std::cerr
+
+// --- SnapshotWriter ---
+void SnapshotWriter::u32(Uint32 value) {
+    const Uint8 b[4] = {(Uint8)value, (Uint8)(value >> 8), (Uint8)(value >> 16), (Uint8)(value >> 24)};
+    bytes.insert(bytes.end(), b, b + 4);
+}
+
+void SnapshotWriter::u64(Uint64 value) {
+    u32((Uint32)value);
+    u32((Uint32)(value >> 32));
+}
+
+void SnapshotWriter::f32(float value) {
+    Uint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    u32(bits);
+}
+
+void SnapshotWriter::str(std::string_view value) {
+    u32((Uint32)value.size());
+    bytes.insert(bytes.end(), value.begin(), value.end());
+}
+
+// --- SnapshotReader ---
+bool SnapshotReader::take(size_t count) {
+    if (!valid || size - pos < count) {
+        valid = false;
+        return false;
+    }
+    return true;
+}
+
+Uint8 SnapshotReader::u8() {
+    if (!take(1)) return 0;
+    return data[pos++];
+}
+
+Uint32 SnapshotReader::u32() {
+    if (!take(4)) return 0;
+    const Uint8* b = data + pos;
+    pos += 4;
+    return (Uint32)b[0] | ((Uint32)b[1] << 8) | ((Uint32)b[2] << 16) | ((Uint32)b[3] << 24);
+}
+
+Uint64 SnapshotReader::u64() {
+    const Uint64 low = u32();
+    return low | ((Uint64)u32() << 32);
+}
+
+float SnapshotReader::f32() {
+    const Uint32 bits = u32();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string SnapshotReader::str() {
+    const Uint32 length = u32();
+    if (!take(length)) return std::string();
+    std::string value((const char*)data + pos, length);
+    pos += length;
+    return value;
+}
+
+Uint32 SnapshotReader::count(size_t minEntryBytes) {
+    const Uint32 value = u32();
+    if (!valid || (Uint64)value * minEntryBytes > size - pos) {
+        valid = false;
+        return 0;
+    }
+    return value;
+}
+
+// --- Header ---
+static const char SNAPSHOT_MAGIC[4] = {'V', 'N', 'S', 'V'};
+
+void writeSnapshotHeader(SnapshotWriter& out) {
+    for (char c : SNAPSHOT_MAGIC) out.u8((Uint8)c);
+    out.u32(SAVE_SNAPSHOT_VERSION);
+}
+
+bool readSnapshotHeader(SnapshotReader& in) {
+    for (char c : SNAPSHOT_MAGIC) {
+        if (in.u8() != (Uint8)c) return false;
+    }
+    return in.u32() == SAVE_SNAPSHOT_VERSION && in.ok();
+}
+
+// --- Save Slots ---
+std::string getSaveSlotPath(int slot) {
+    return (slot == 0) ? "quicksave.sav" : "save" + std::to_string(slot) + ".sav";
+}
+
+bool readSaveSlot(int slot, std::vector<Uint8>& bytes) {
+    return readFileBytes(getSaveSlotPath(slot), bytes);
+}
+
+// --- Files ---
+bool readFileBytes(const std::string& path, std::vector<Uint8>& bytes) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    bytes.resize((size_t)file.tellg());
+    file.seekg(0);
+    file.read((char*)bytes.data(), (std::streamsize)bytes.size());
+    return (size_t)file.gcount() == bytes.size();
+}
+
+bool writeFileAtomically(const std::string& path, const std::vector<Uint8>& bytes) {
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        file.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+        file.flush();
+        if (!file) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error); // Replaces the old file in one step
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+// --- SaveSlotWriter ---
+SaveSlotWriter::~SaveSlotWriter() {
+    close();
+}
+
+void SaveSlotWriter::post(int slot, std::vector<Uint8>& bytes) {
+    if (slot < 0 || slot >= SAVE_SLOT_COUNT) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable()) {
+            stopping = false;
+            worker = std::thread(&SaveSlotWriter::run, this); // Started on first use
+        }
+        PendingSave& save = pending[slot];
+        save.bytes.swap(bytes); // The caller gets the old buffer back to reuse
+        bytes.clear();
+        if (!save.queued) { // Otherwise the older save still queued for the slot is dropped
+            save.queued = true;
+            posted++;
+        }
+    }
+    wake.notify_one();
+}
+
+void SaveSlotWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [&] { return written >= posted || !worker.joinable(); });
+}
+
+void SaveSlotWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!worker.joinable()) return;
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join(); // Writes whatever is still queued first
+}
+
+void SaveSlotWriter::run() {
+    std::vector<Uint8> bytes;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        int slot = -1;
+        wake.wait(lock, [&] {
+            for (int i = 0; i < SAVE_SLOT_COUNT && slot < 0; ++i) {
+                if (pending[i].queued) slot = i;
+            }
+            return slot >= 0 || stopping;
+        });
+        if (slot < 0) return; // Stopping with nothing left
+
+        // Take the slot's snapshot, then write it without holding the lock
+        bytes.swap(pending[slot].bytes);
+        pending[slot].queued = false;
+        lock.unlock();
+        if (!writeFileAtomically(getSaveSlotPath(slot), bytes)) {
+            std::cerr << "Warning: Could not write save slot " << slot << " to " << getSaveSlotPath(slot) << std::endl;
+        }
+        lock.lock();
+
+        written++;
+        drained.notify_all();
+    }
+}
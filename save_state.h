@@ -0,0 +1,120 @@
+// save_state.h - Compact binary save snapshots and the background writer for save slots
+#pragma once
+#include <SDL3/SDL.h>       // For Uint8, Uint32, Uint64, Sint32
+#include <string>           // For std::string
+#include <string_view>      // For std::string_view
+#include <vector>           // For std::vector
+#include <thread>           // For std::thread
+#include <mutex>            // For std::mutex
+#include <condition_variable> // For std::condition_variable
+
+// --- Snapshot Format ---
+// A snapshot is "VNSV", the format version, then the fields StoryManager::saveSnapshot writes,
+// all little-endian. Loading a snapshot of another version fails instead of guessing.
+const Uint32 SAVE_SNAPSHOT_VERSION = 1;
+
+// --- SnapshotWriter ---
+// Appends fields to a byte buffer. Reuse the buffer between saves to keep saving allocation free.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::vector<Uint8>& bytes) : bytes(bytes) {}
+
+    void u8(Uint8 value) { bytes.push_back(value); }
+    void u32(Uint32 value);
+    void u64(Uint64 value);
+    void i32(Sint32 value) { u32((Uint32)value); }
+    void f32(float value);
+    void str(std::string_view value); // Length, then the bytes
+
+private:
+    std::vector<Uint8>& bytes;
+};
+
+// --- SnapshotReader ---
+// Reads fields back in the order they were written. Reading past the end yields zeros and
+// clears ok(), so a truncated snapshot is caught once at the end instead of after every field.
+class SnapshotReader {
+public:
+    SnapshotReader(const Uint8* data, size_t size) : data(data), size(size) {}
+
+    Uint8 u8();
+    Uint32 u32();
+    Uint64 u64();
+    Sint32 i32() { return (Sint32)u32(); }
+    float f32();
+    std::string str();
+
+    // An entry count, checked against what is left: 0 (and not ok()) if that many entries of at
+    // least minEntryBytes each can't fit, so a corrupt count never allocates gigabytes.
+    Uint32 count(size_t minEntryBytes);
+
+    bool ok() const { return valid; }
+    bool atEnd() const { return pos == size; }
+
+private:
+    bool take(size_t count);
+
+    const Uint8* data;
+    size_t size;
+    size_t pos = 0;
+    bool valid = true;
+};
+
+// The magic and version in front of every snapshot. readSnapshotHeader returns false unless
+// they match this build's.
+void writeSnapshotHeader(SnapshotWriter& out);
+bool readSnapshotHeader(SnapshotReader& in);
+
+// --- Files ---
+// Reads a whole file into `bytes`. Returns false if it doesn't exist or can't be read.
+bool readFileBytes(const std::string& path, std::vector<Uint8>& bytes);
+
+// Writes `bytes` to a temporary file next to `path` and renames it over `path`, so the file is
+// always either the old or the new contents, even if the game dies mid-write.
+bool writeFileAtomically(const std::string& path, const std::vector<Uint8>& bytes);
+
+// --- Save Slots ---
+// Slot 0 is the quick-save slot; 1..SAVE_SLOT_COUNT-1 are numbered slots.
+const int SAVE_SLOT_COUNT = 10;
+
+// File a slot is saved to, in the working directory.
+std::string getSaveSlotPath(int slot);
+
+// Reads a whole slot file into `bytes`. Returns false if it doesn't exist or can't be read.
+bool readSaveSlot(int slot, std::vector<Uint8>& bytes);
+
+// --- SaveSlotWriter ---
+// Writes snapshots on a background thread so saving never waits on the disk. Each write goes to
+// a temporary file that is then renamed over the slot, so a crash mid-write leaves the previous
+// save intact. If a slot is saved again before the last one was written, only the newest is.
+class SaveSlotWriter {
+public:
+    ~SaveSlotWriter();
+
+    // Queues `bytes` (taken over, left empty) for the slot. Only takes a lock for a swap;
+    // the writer thread is started on first use.
+    void post(int slot, std::vector<Uint8>& bytes);
+
+    // Waits until everything posted so far is on disk.
+    void flush();
+
+    // Writes what is still queued, then stops the thread.
+    void close();
+
+private:
+    struct PendingSave {
+        bool queued = false;
+        std::vector<Uint8> bytes;
+    };
+
+    void run();
+
+    PendingSave pending[SAVE_SLOT_COUNT];
+    size_t posted = 0;
+    size_t written = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    std::thread worker;
+};
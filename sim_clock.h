@@ -0,0 +1,59 @@
+// sim_clock.h - Nanosecond fixed-timestep simulation clock
+#pragma once
+#include <SDL3/SDL.h>       // For Uint64, SDL_NS_PER_SECOND
+
+// --- FixedStepClock ---
+// Turns variable frame times into a whole number of fixed simulation steps, so physics and
+// effects advance identically at any frame rate. Leftover time stays in the accumulator and
+// is exposed as an interpolation factor for rendering between the last two steps.
+//
+// Typical frame:
+//     simClock.advance(SDL_GetTicksNS());
+//     while (simClock.step()) story.fixedUpdate(simClock.simTimeNS, simClock.stepSeconds());
+//     story.render(simClock.renderTimeNS(), simClock.alpha());
+struct FixedStepClock {
+    Uint64 stepNS = SDL_NS_PER_SECOND / 120; // Simulation rate: 120 steps per second
+    int maxStepsPerFrame = 8;                // After a long stall, drop time instead of spiralling
+    Uint64 simTimeNS = 0;                    // Clock time of the last completed step
+    Uint64 accumulatorNS = 0;                // Real time not yet simulated
+    Uint64 lastRealNS = 0;
+
+    // Starts the clock at the given real time with no pending steps.
+    void reset(Uint64 nowNS) {
+        simTimeNS = nowNS;
+        lastRealNS = nowNS;
+        accumulatorNS = 0;
+    }
+
+    // Adds the real time elapsed since the previous call to the accumulator.
+    void advance(Uint64 nowNS) {
+        if (nowNS > lastRealNS) {
+            accumulatorNS += nowNS - lastRealNS;
+        }
+        lastRealNS = nowNS;
+
+        const Uint64 maxBacklog = stepNS * (Uint64)maxStepsPerFrame;
+        if (accumulatorNS > maxBacklog) {
+            simTimeNS += accumulatorNS - maxBacklog; // Skip over the stall rather than simulate it
+            accumulatorNS = maxBacklog;
+        }
+    }
+
+    // Consumes one step from the accumulator. Returns false when less than a step is left.
+    bool step() {
+        if (accumulatorNS < stepNS) {
+            return false;
+        }
+        accumulatorNS -= stepNS;
+        simTimeNS += stepNS;
+        return true;
+    }
+
+    float stepSeconds() const { return (float)stepNS / (float)SDL_NS_PER_SECOND; }
+
+    // How far (0..1) the real time is past the last step, for interpolated rendering.
+    float alpha() const { return (float)accumulatorNS / (float)stepNS; }
+
+    // The time to render at: the last step plus the leftover accumulator.
+    Uint64 renderTimeNS() const { return simTimeNS + accumulatorNS; }
+};
@@ -0,0 +1,52 @@
+// spsc_queue.h - Fixed-capacity lock-free single-producer/single-consumer queue
+#pragma once
+#include <atomic>           // For std::atomic
+#include <cstddef>          // For size_t
+
+// --- SpscQueue ---
+// One thread pushes, one other thread pops; neither ever blocks or allocates.
+// Capacity must be a power of two. One slot is kept free to tell "full" from "empty".
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    // Producer side. Returns false (and drops the item) if the queue is full.
+    bool push(const T& item) {
+        const size_t tail = tailIndex.load(std::memory_order_relaxed);
+        const size_t next = (tail + 1) & (Capacity - 1);
+        if (next == headIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots[tail] = item;
+        tailIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if there was nothing to pop.
+    bool pop(T& item) {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[head];
+        headIndex.store((head + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Looks at the next item without removing it.
+    bool peek(T& item) const {
+        const size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[head];
+        return true;
+    }
+
+private:
+    // Head and tail live on separate cache lines so producer and consumer don't false-share.
+    alignas(64) std::atomic<size_t> headIndex{0}; // Next slot to pop (written by consumer)
+    alignas(64) std::atomic<size_t> tailIndex{0}; // Next slot to fill (written by producer)
+    alignas(64) T slots[Capacity];
+};
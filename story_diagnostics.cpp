@@ -0,0 +1,200 @@
+// story_diagnostics.cpp - Implementation of story diagnostics and the background writer
+#include "story_diagnostics.h" // Include the corresponding header
+#include <iostream>         // For std::cerr
+#include <sstream>          // For std::ostringstream
+#include <thread>           // For std::thread
+#include <mutex>            // For std::mutex
+#include <condition_variable> // For std::condition_variable
+
+// --- Background Writer ---
+namespace {
+
+class DiagnosticsWriter {
+public:
+    DiagnosticsWriter() : head(0), tail(0), dropped(0), written(0), posted(0), stopping(false) {}
+
+    ~DiagnosticsWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join(); // Drains whatever is still queued first
+    }
+
+    void post(const std::string& text) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!worker.joinable()) {
+                worker = std::thread(&DiagnosticsWriter::run, this); // Started on first use
+            }
+            if (tail - head == RING_SIZE) {
+                dropped++;
+                return;
+            }
+            ring[tail % RING_SIZE] = text;
+            tail++;
+            posted++;
+        }
+        wake.notify_one();
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        const size_t target = posted;
+        drained.wait(lock, [&] { return written >= target || !worker.joinable(); });
+    }
+
+private:
+    static const size_t RING_SIZE = 1024;
+
+    void run() {
+        std::string batch;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return head != tail || stopping; });
+            if (head == tail && stopping) return;
+
+            // Take everything queued, then write it without holding the lock
+            batch.clear();
+            size_t taken = 0;
+            while (head != tail) {
+                batch += ring[head % RING_SIZE];
+                ring[head % RING_SIZE].clear();
+                head++;
+                taken++;
+            }
+            if (dropped > 0) {
+                batch += "Warning: " + std::to_string(dropped) + " diagnostic messages dropped (output queue full)\n";
+                dropped = 0;
+            }
+
+            lock.unlock();
+            std::cerr << batch;
+            std::cerr.flush();
+            lock.lock();
+
+            written += taken;
+            drained.notify_all();
+        }
+    }
+
+    std::string ring[RING_SIZE];
+    size_t head;     // Next slot to write out
+    size_t tail;     // Next slot to fill
+    size_t dropped;  // Posts lost to a full ring since the last batch
+    size_t written;
+    size_t posted;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    std::thread worker;
+};
+
+DiagnosticsWriter& getWriter() {
+    static DiagnosticsWriter writer; // Joined at exit, after draining
+    return writer;
+}
+
+// Queues text for stderr; returns immediately.
+void postDiagnosticText(const std::string& text) {
+    getWriter().post(text);
+}
+
+} // namespace
+
+void flushDiagnostics() {
+    getWriter().flush();
+}
+
+// --- StoryDiagnostics ---
+const char* getDiagnosticCategoryName(DiagnosticCategory category) {
+    switch (category) {
+        case DIAG_FILE:         return "file";
+        case DIAG_CHOICE:       return "choice";
+        case DIAG_EFFECT_TAG:   return "effect tag";
+        case DIAG_STATEMENT:    return "statement";
+        case DIAG_VOICE:        return "voice";
+        case DIAG_LABEL:        return "label";
+        case DIAG_MARKUP:       return "markup";
+        case DIAG_UNRECOGNIZED: return "unrecognized line";
+        case DIAG_RESOURCE:     return "resource";
+        default:                return "other";
+    }
+}
+
+StoryDiagnostics::StoryDiagnostics() : muted(false), silenced(false) {
+    for (auto& count : counts) count = 0;
+    for (auto& count : runtimeCounts) count = 0;
+}
+
+// One report's lines of output: the report itself, and a note when it's the last one printed
+static std::string formatDiagnostic(DiagnosticCategory category, const std::string& file, int line,
+                                    const std::string& tag, const std::string& message, size_t countInCategory) {
+    std::ostringstream text;
+    text << "Warning: " << file;
+    if (line > 0) text << ":" << line;
+    text << ": " << tag << ": " << message << "\n";
+    if (countInCategory == StoryDiagnostics::PRINT_LIMIT_PER_CATEGORY) {
+        text << "Warning: " << file << ": further " << getDiagnosticCategoryName(category)
+             << " warnings are counted but not shown\n";
+    }
+    return text.str();
+}
+
+void StoryDiagnostics::beginLoad(const std::string& file) {
+    loadFile = file;
+    diagnostics.clear();
+    for (auto& count : counts) count = 0;
+}
+
+void StoryDiagnostics::report(DiagnosticCategory category, const std::string& file, int line,
+                              const std::string& tag, const std::string& message) {
+    if (muted || (silenced && category != DIAG_RESOURCE)) return;
+
+    const size_t countInCategory = ++counts[category];
+    if (diagnostics.size() < MAX_STORED) {
+        diagnostics.push_back({category, file, line, tag, message});
+    }
+
+    if (countInCategory <= PRINT_LIMIT_PER_CATEGORY) {
+        postDiagnosticText(formatDiagnostic(category, file, line, tag, message, countInCategory));
+    }
+}
+
+void StoryDiagnostics::reportRuntime(DiagnosticCategory category, const std::string& file, int line,
+                                     const std::string& tag, const std::string& message) {
+    if (silenced && category != DIAG_RESOURCE) return;
+
+    const size_t countInCategory = ++runtimeCounts[category];
+    if (countInCategory <= PRINT_LIMIT_PER_CATEGORY) {
+        postDiagnosticText(formatDiagnostic(category, file, line, tag, message, countInCategory));
+    }
+}
+
+void StoryDiagnostics::endLoad() {
+    const size_t total = getTotalCount();
+    if (total == 0) return;
+
+    std::ostringstream text;
+    text << "Warning: " << loadFile << ": " << total << " diagnostic" << (total == 1 ? "" : "s") << " (";
+    size_t hidden = 0;
+    bool first = true;
+    for (int c = 0; c < DIAG_CATEGORY_COUNT; ++c) {
+        if (counts[c] == 0) continue;
+        text << (first ? "" : ", ") << getDiagnosticCategoryName((DiagnosticCategory)c) << ": " << counts[c];
+        if (counts[c] > PRINT_LIMIT_PER_CATEGORY) hidden += counts[c] - PRINT_LIMIT_PER_CATEGORY;
+        first = false;
+    }
+    text << ")";
+    if (hidden > 0) text << ", " << hidden << " not shown";
+    text << "\n";
+    postDiagnosticText(text.str());
+}
+
+size_t StoryDiagnostics::getTotalCount() const {
+    size_t total = 0;
+    for (size_t count : counts) total += count;
+    return total;
+}
@@ -0,0 +1,89 @@
+// story_diagnostics.h - Structured, rate-limited story load diagnostics with a background writer
+#pragma once
+#include <string>           // For std::string
+#include <vector>           // For std::vector
+#include <cstddef>          // For size_t
+
+// --- Categories ---
+// Rate limiting and the end-of-load summary are per category.
+enum DiagnosticCategory {
+    DIAG_FILE,              // Story file could not be opened or indexed
+    DIAG_CHOICE,            // Choice blocks, choice lines and their targets
+    DIAG_EFFECT_TAG,        // [PULSE], [SHAKE], [TEAR]
+    DIAG_STATEMENT,         // [SET], [ADD], [IF] and choice conditions
+    DIAG_VOICE,             // [VOICE]
+    DIAG_LABEL,             // [LABEL] definitions
+    DIAG_MARKUP,            // Inline {tags} inside dialog text
+    DIAG_UNRECOGNIZED,      // Lines that are neither tags nor dialog
+    DIAG_RESOURCE,          // Textures/surfaces that failed to build while loading
+    DIAG_CATEGORY_COUNT
+};
+
+// Short lowercase name for summaries, e.g. "effect tag".
+const char* getDiagnosticCategoryName(DiagnosticCategory category);
+
+struct StoryDiagnostic {
+    DiagnosticCategory category;
+    std::string file;
+    int line;               // Raw file line number, 0 if not tied to a line
+    std::string tag;        // The construct involved, e.g. "[PULSE]" or "choice"
+    std::string message;
+};
+
+// --- StoryDiagnostics ---
+// Collects the diagnostics of one StoryManager's loads. Every report is kept for tools to query
+// (up to MAX_STORED), but only the first PRINT_LIMIT_PER_CATEGORY of each category per load are
+// printed; endLoad() prints a one-line summary with the full counts. Printing never blocks the
+// loader: text is handed to a background writer thread (see flushDiagnostics).
+class StoryDiagnostics {
+public:
+    static const size_t PRINT_LIMIT_PER_CATEGORY = 20;
+    static const size_t MAX_STORED = 65536;
+
+    StoryDiagnostics();
+
+    // Starts a new load: clears the stored diagnostics and counters.
+    void beginLoad(const std::string& file);
+
+    // Ends a load and queues its summary (nothing if there were no diagnostics).
+    void endLoad();
+
+    void report(DiagnosticCategory category, const std::string& file, int line,
+                const std::string& tag, const std::string& message);
+
+    // Problems found while the story plays (a jump to a file that's gone, a streamed file that
+    // can't be reopened), outside any load. Counted apart from the last load's diagnostics and
+    // not stored with them; printed with a limit of their own per category, for the whole run.
+    void reportRuntime(DiagnosticCategory category, const std::string& file, int line,
+                       const std::string& tag, const std::string& message);
+
+    // While muted, reports are ignored entirely (used when re-parsing already reported lines).
+    void setMuted(bool muted) { this->muted = muted; }
+
+    // Like muted, but for the owner's whole life rather than one re-parse: for loads whose
+    // diagnostics are reported elsewhere (the batch renderer's workers). DIAG_RESOURCE reports
+    // still go through, since they're about the owner's own renderer.
+    void setSilenced(bool silenced) { this->silenced = silenced; }
+
+    // --- Queries ---
+    const std::vector<StoryDiagnostic>& getDiagnostics() const { return diagnostics; }
+    size_t getCount(DiagnosticCategory category) const { return counts[category]; }
+    size_t getTotalCount() const;
+    size_t getRuntimeCount(DiagnosticCategory category) const { return runtimeCounts[category]; }
+
+private:
+    std::string loadFile;
+    std::vector<StoryDiagnostic> diagnostics;
+    size_t counts[DIAG_CATEGORY_COUNT];
+    size_t runtimeCounts[DIAG_CATEGORY_COUNT]; // Never reset: the runtime print limit is per run
+    bool muted;
+    bool silenced;
+};
+
+// --- Background Writer ---
+// Reports go into a fixed-size ring buffer that a background thread drains to stderr, writing
+// whole batches with a single flush. If the ring is full the text is dropped and counted, and
+// the writer reports how many messages were lost.
+
+// Blocks until every report so far has been written. Call before exiting so none are lost.
+void flushDiagnostics();
@@ -0,0 +1,93 @@
+// story_history.cpp - Implementation of the story history and reading its entries back
+#include "story_history.h"  // Include the corresponding header
+#include <fstream>          // For std::ifstream
+#include "rich_text.h"      // For parseRichText
+#include "story_tokenizer.h" // For classifyStoryLine, parseStoryChoiceLine
+
+// --- StoryHistory ---
+StoryHistory::StoryHistory(size_t capacity) : entries(capacity > 0 ? capacity : 1) {}
+
+Uint32 StoryHistory::internFile(const std::string& file) {
+    auto it = fileIds.find(file);
+    if (it != fileIds.end()) return it->second;
+    const Uint32 id = (Uint32)fileNames.size();
+    fileNames.push_back(file);
+    fileIds.emplace(file, id);
+    return id;
+}
+
+void StoryHistory::push(const HistoryEntry& entry) {
+    if (count > 0) {
+        const HistoryEntry& newest = at(count - 1);
+        if (newest.file == entry.file && newest.line == entry.line && newest.choice == entry.choice) return;
+    }
+    if (count == entries.size()) {
+        first = (first + 1) % entries.size(); // Overwrite the oldest
+        dropped++;
+        count--;
+    }
+    entries[(first + count) % entries.size()] = entry;
+    count++;
+}
+
+void StoryHistory::clear() {
+    dropped += count; // Sequences of cleared entries are never reused
+    first = 0;
+    count = 0;
+}
+
+// --- Reading Entries Back ---
+bool readHistoryEntryText(const std::string& filename, const StoryLineIndex& index, const HistoryEntry& entry,
+                          std::string& speaker, std::string& text) {
+    const size_t block = entry.line / STORY_INDEX_STRIDE;
+    if (entry.line >= index.lineCount || block >= index.checkpoints.size()) return false;
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return false;
+    const StoryCheckpoint& checkpoint = index.checkpoints[block];
+    file.seekg((std::streamoff)checkpoint.offset);
+
+    // Walk forward from the checkpoint classifying lines the way the index did
+    std::string line;
+    std::string currentSpeaker = checkpoint.speaker;
+    size_t lineIndex = block * STORY_INDEX_STRIDE;
+    bool found = false; // Past the entry's line, looking for its choices
+    Uint16 choiceIndex = 0;
+    StoryToken token;
+    StoryChoiceToken choiceToken;
+    while (readStoryLine(file, line)) {
+        classifyStoryLine(line, token);
+
+        if (token.kind == STORY_LINE_CHOICE_OPEN && lineIndex > 0) { // Before any dialog line the loader reads on
+            while (readStoryLine(file, line)) {
+                classifyStoryLine(line, token);
+                if (token.kind == STORY_LINE_CHOICE_CLOSE) break;
+                if (!found || token.kind == STORY_LINE_BLANK || token.kind == STORY_LINE_COMMENT) continue;
+                if (!parseStoryChoiceLine(token.text, choiceToken)) continue; // Not loaded either
+                if (choiceIndex++ == entry.choice) {
+                    text.assign(choiceToken.text);
+                    return true;
+                }
+            }
+        } else if (token.kind == STORY_LINE_DIALOG || token.kind == STORY_LINE_OTHER) {
+            if (token.hasSpeaker) {
+                currentSpeaker.assign(token.speaker);
+            }
+            if (token.kind != STORY_LINE_DIALOG) continue;
+            if (found) return false; // The next line: the choice isn't there any more
+            if (lineIndex++ != entry.line) continue;
+
+            speaker = currentSpeaker;
+            if (entry.choice != HISTORY_NO_CHOICE) {
+                found = true;
+                continue;
+            }
+            std::vector<TextStyleRun> runs;
+            std::vector<TextTiming> timings;
+            std::string error;
+            parseRichText(token.dialog, text, runs, timings, error); // Bad markup still leaves the text
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,63 @@
+// story_history.h - Bounded history of the lines shown and choices taken, for the backlog
+#pragma once
+#include <SDL3/SDL.h>       // For Uint16, Uint32, Uint64
+#include <string>           // For std::string
+#include <vector>           // For std::vector
+#include <unordered_map>    // For std::unordered_map
+#include "story_index.h"    // For StoryLineIndex
+
+// --- History Entries ---
+// A reference to a line of a story file, never a copy of its text: the text is looked up again
+// only when the backlog shows the entry.
+const Uint16 HISTORY_NO_CHOICE = 0xFFFF;
+
+struct HistoryEntry {
+    Uint32 file;   // StoryHistory::getFileName
+    Uint32 line;   // Dialog line of the whole file
+    Uint16 choice; // Which of the line's choices was taken, or HISTORY_NO_CHOICE for the line itself
+};
+
+// --- StoryHistory ---
+// A ring buffer of entries: once full, each new entry replaces the oldest. 16384 entries are
+// 192 KB however long the lines are.
+const size_t HISTORY_DEFAULT_CAPACITY = 16384;
+
+class StoryHistory {
+public:
+    explicit StoryHistory(size_t capacity = HISTORY_DEFAULT_CAPACITY);
+
+    // The id of a story file name for HistoryEntry::file (each name is stored once)
+    Uint32 internFile(const std::string& file);
+    const std::string& getFileName(Uint32 file) const { return fileNames[file]; }
+
+    // Appends an entry, dropping the oldest if the buffer is full. Repeating the newest entry
+    // is ignored, so the same line can be reported on every update.
+    void push(const HistoryEntry& entry);
+
+    size_t size() const { return count; }
+    size_t capacity() const { return entries.size(); }
+
+    // Entry i, counted from the oldest still kept
+    const HistoryEntry& at(size_t i) const { return entries[(first + i) % entries.size()]; }
+
+    // A number that stays with entry i while it's kept (unlike i, which shifts as old entries
+    // drop out): usable as a cache key
+    Uint64 getSequence(size_t i) const { return dropped + i; }
+
+    void clear();
+
+private:
+    std::vector<HistoryEntry> entries;
+    size_t first = 0;   // Oldest entry
+    size_t count = 0;
+    Uint64 dropped = 0; // Entries pushed out so far (and cleared)
+    std::vector<std::string> fileNames;
+    std::unordered_map<std::string, Uint32> fileIds;
+};
+
+// --- Reading Entries Back ---
+// Reads the speaker and plain text (markup stripped) of an entry's line, or the text of its
+// choice, from the story file on disk. Starts at the line's index checkpoint, so at most
+// STORY_INDEX_STRIDE lines are read. Returns false if the file or line can't be found.
+bool readHistoryEntryText(const std::string& filename, const StoryLineIndex& index, const HistoryEntry& entry,
+                          std::string& speaker, std::string& text);
@@ -0,0 +1,84 @@
+// story_index.cpp - Implementation of the sparse story line index
+#include "story_index.h"    // Include the corresponding header
+#include <fstream>          // For std::ifstream
+#include "story_tokenizer.h" // For classifyStoryLine, parseStoryLabelTag
+
+void StoryLineIndex::clear() {
+    checkpoints.clear();
+    lineCount = 0;
+    voiceTags.clear();
+    labels.clear();
+}
+
+bool readStoryLine(std::istream& in, std::string& line, Uint64& offset) {
+    if (!std::getline(in, line)) {
+        return false;
+    }
+    offset += line.size() + (in.eof() ? 0 : 1); // The last line may have no '\n'
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return true;
+}
+
+bool readStoryLine(std::istream& in, std::string& line) {
+    Uint64 unusedOffset = 0;
+    return readStoryLine(in, line, unusedOffset);
+}
+
+bool buildStoryLineIndex(const std::string& filename, StoryLineIndex& index) {
+    index.clear();
+
+    std::ifstream file(filename, std::ios::binary); // Binary, so offsets are exact byte positions
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    std::string speaker;
+    Uint64 offset = 0;
+    int rawLineNumber = 0;
+    StoryCheckpoint boundary = {0, 0, ""}; // Where the next dialog line's parse starts
+
+    StoryToken token;
+    std::vector<std::string> pendingLabels; // Labels waiting for the next dialog line
+    while (readStoryLine(file, line, offset)) {
+        rawLineNumber++;
+        classifyStoryLine(line, token); // The loader's classification, so both agree on dialog lines
+
+        if (token.kind == STORY_LINE_CHOICE_OPEN) {
+            // A choice block belongs to the preceding dialog line. loadStory ignores the marker
+            // (and reads the choices as ordinary lines) if there's no dialog line yet.
+            if (index.lineCount == 0) continue;
+            while (readStoryLine(file, line, offset)) {
+                rawLineNumber++;
+                classifyStoryLine(line, token);
+                if (token.kind == STORY_LINE_CHOICE_CLOSE) break;
+            }
+            boundary = {offset, rawLineNumber, speaker};
+        } else if (token.kind == STORY_LINE_TAG) {
+            std::string_view labelName;
+            if (token.text.compare(0, 6, "[VOICE") == 0) {
+                index.voiceTags.emplace_back(token.text);
+            } else if (token.text.compare(0, 6, "[LABEL") == 0 && parseStoryLabelTag(token, labelName)) {
+                pendingLabels.emplace_back(labelName);
+            }
+        } else if (token.kind == STORY_LINE_DIALOG || token.kind == STORY_LINE_OTHER) {
+            if (token.hasSpeaker) {
+                speaker.assign(token.speaker); // Speakers carry over, even on lines that aren't dialog
+            }
+            if (token.kind == STORY_LINE_DIALOG) {
+                if (index.lineCount % STORY_INDEX_STRIDE == 0) {
+                    index.checkpoints.push_back(boundary);
+                }
+                for (const std::string& label : pendingLabels) {
+                    index.labels.emplace(label, (int)index.lineCount);
+                }
+                pendingLabels.clear();
+                index.lineCount++;
+                boundary = {offset, rawLineNumber, speaker};
+            }
+        }
+    }
+    return true;
+}
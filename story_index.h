@@ -0,0 +1,41 @@
+// story_index.h - Sparse line-offset index for streaming large story files
+#pragma once
+#include <SDL3/SDL.h>       // For Uint64
+#include <string>           // For std::string
+#include <vector>           // For std::vector
+#include <unordered_map>    // For std::unordered_map
+#include <istream>          // For std::istream
+
+// --- Index Layout ---
+// Only every STORY_INDEX_STRIDE-th dialog line gets a checkpoint, so the index of a
+// million-line script is a few hundred KB. Seeking to line n jumps to checkpoint n / STRIDE
+// and parses at most STRIDE - 1 lines forward: constant work however large the file is.
+const size_t STORY_INDEX_STRIDE = 64;
+
+// Where parsing of a dialog line can start. The offset is just past the previous dialog line and
+// any choice blocks that belong to it, so the tags before the line are parsed with it.
+struct StoryCheckpoint {
+    Uint64 offset;           // Byte offset into the file
+    int rawLineNumber;       // File lines before the offset, for warnings
+    std::string speaker;     // Speaker in effect at the offset (speakers carry over between lines)
+};
+
+struct StoryLineIndex {
+    std::vector<StoryCheckpoint> checkpoints; // checkpoints[k] is for dialog line k * STORY_INDEX_STRIDE
+    size_t lineCount = 0;                     // Dialog lines in the file
+    std::vector<std::string> voiceTags;       // [VOICE] tags anywhere in the file (they apply globally)
+    std::unordered_map<std::string, int> labels; // [LABEL] name -> the dialog line after it (first definition wins)
+
+    void clear();
+};
+
+// Reads one line like std::getline, dropping a trailing '\r' so CRLF scripts parse the same as LF
+// ones. Adds the raw bytes consumed (including the line break) to `offset`.
+bool readStoryLine(std::istream& in, std::string& line, Uint64& offset);
+bool readStoryLine(std::istream& in, std::string& line);
+
+// First pass over a story file: counts dialog lines and records checkpoints without building
+// any DialogLine. Must recognize dialog lines exactly as StoryManager::loadStory does (both
+// classify lines with classifyStoryLine).
+// Returns false if the file can't be opened.
+bool buildStoryLineIndex(const std::string& filename, StoryLineIndex& index);
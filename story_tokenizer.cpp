@@ -0,0 +1,173 @@
+// story_tokenizer.cpp - Implementation of the in-place story script tokenizer
+#include "story_tokenizer.h" // Include the corresponding header
+#include <charconv>         // For std::from_chars
+
+// --- Line Tokens ---
+void classifyStoryLine(std::string_view line, StoryToken& token) {
+    token.text = std::string_view();
+    token.tagName = std::string_view();
+    token.speaker = std::string_view();
+    token.hasSpeaker = false;
+    token.dialog = std::string_view();
+
+    const size_t first = line.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) {
+        token.kind = STORY_LINE_BLANK;
+        return;
+    }
+    const std::string_view text = line.substr(first);
+    token.text = text;
+
+    switch (text.front()) {
+        case '#':
+            token.kind = STORY_LINE_COMMENT;
+            return;
+        case '[':
+            if (text.size() == 1) {
+                token.kind = STORY_LINE_CHOICE_OPEN;
+            } else {
+                const size_t nameEnd = text.find_first_of(" \t]", 1);
+                token.kind = STORY_LINE_TAG;
+                token.tagName = text.substr(1, (nameEnd == std::string_view::npos ? text.size() : nameEnd) - 1);
+            }
+            return;
+        case ']':
+            if (text.size() == 1) {
+                token.kind = STORY_LINE_CHOICE_CLOSE;
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // Optional 'Speaker' prefix; the speaker carries over to later lines even if no text follows
+    std::string_view rest = text;
+    if (text.front() == '\'') {
+        const size_t speakerEnd = text.find('\'', 1);
+        if (speakerEnd != std::string_view::npos) {
+            token.hasSpeaker = true;
+            token.speaker = text.substr(1, speakerEnd - 1);
+            rest = text.substr(speakerEnd + 1);
+            const size_t restFirst = rest.find_first_not_of(" \t\r\n");
+            rest = (restFirst == std::string_view::npos) ? std::string_view() : rest.substr(restFirst);
+        }
+    }
+
+    if (!rest.empty() && rest.front() == '"') {
+        const size_t quoteEnd = rest.find('"', 1);
+        if (quoteEnd != std::string_view::npos) {
+            token.kind = STORY_LINE_DIALOG;
+            token.dialog = rest.substr(1, quoteEnd - 1);
+            return;
+        }
+    }
+    token.kind = STORY_LINE_OTHER;
+}
+
+// --- StoryTokenizer ---
+bool StoryTokenizer::next(StoryToken& token) {
+    if (pos >= buffer.size()) {
+        return false;
+    }
+    const size_t lineBreak = buffer.find('\n', pos); // memchr over the buffer
+    const size_t lineEnd = (lineBreak == std::string_view::npos) ? buffer.size() : lineBreak;
+    std::string_view line = buffer.substr(pos, lineEnd - pos);
+    pos = (lineBreak == std::string_view::npos) ? buffer.size() : lineBreak + 1;
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1); // CRLF scripts parse the same as LF ones
+    }
+    token.rawLineNumber = ++rawLineNumber;
+    classifyStoryLine(line, token);
+    return true;
+}
+
+// --- Arguments ---
+namespace {
+
+template <typename T>
+bool parseNumber(std::string_view& args, T& value) {
+    size_t start = 0;
+    while (start < args.size() && (args[start] == ' ' || args[start] == '\t')) ++start;
+    const char* end = args.data() + args.size();
+    const std::from_chars_result result = std::from_chars(args.data() + start, end, value);
+    if (result.ec != std::errc()) {
+        return false;
+    }
+    args.remove_prefix((size_t)(result.ptr - args.data()));
+    return true;
+}
+
+} // namespace
+
+bool parseStoryNumber(std::string_view& args, float& value) {
+    return parseNumber(args, value);
+}
+
+bool parseStoryNumber(std::string_view& args, int& value) {
+    return parseNumber(args, value);
+}
+
+bool isStoryArgsEnd(std::string_view args) {
+    return args.find_first_not_of(" \t") == std::string_view::npos;
+}
+
+bool getStoryTagArgs(const StoryToken& token, std::string_view& args) {
+    const size_t closeBracketPos = token.text.find(']');
+    if (closeBracketPos == std::string_view::npos) {
+        return false;
+    }
+    const size_t argsStart = 1 + token.tagName.size();
+    args = token.text.substr(argsStart, closeBracketPos - argsStart);
+    return true;
+}
+
+// --- Labels ---
+bool isStoryLabelName(std::string_view name) {
+    if (name.empty() || (name.front() >= '0' && name.front() <= '9')) return false;
+    for (char c : name) {
+        const bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+        if (!valid) return false;
+    }
+    return true;
+}
+
+bool parseStoryLabelTag(const StoryToken& token, std::string_view& name) {
+    std::string_view args;
+    if (!getStoryTagArgs(token, args)) return false;
+    const size_t first = args.find_first_not_of(" \t");
+    if (first == std::string_view::npos) return false;
+    const size_t last = args.find_last_not_of(" \t");
+    name = args.substr(first, last - first + 1);
+    return isStoryLabelName(name);
+}
+
+// --- Choices ---
+bool parseStoryChoiceLine(std::string_view line, StoryChoiceToken& out) {
+    const size_t firstQuote = line.find('"');
+    const size_t secondQuote = line.find('"', firstQuote + 1);
+    const size_t arrow = line.find("->");
+    if (firstQuote == std::string_view::npos || secondQuote == std::string_view::npos || arrow == std::string_view::npos ||
+        firstQuote >= secondQuote || secondQuote >= arrow) {
+        return false;
+    }
+
+    out.text = line.substr(firstQuote + 1, secondQuote - (firstQuote + 1));
+    out.target = line.substr(arrow + 2);
+    out.condition = std::string_view();
+    out.hasCondition = false;
+    out.conditionClosed = false;
+
+    // Optional trailing condition: "Text" -> target [IF expr]
+    const size_t conditionPos = out.target.find("[IF");
+    if (conditionPos != std::string_view::npos) {
+        out.hasCondition = true;
+        const size_t conditionEnd = out.target.rfind(']');
+        if (conditionEnd != std::string_view::npos && conditionEnd > conditionPos) {
+            out.conditionClosed = true;
+            out.condition = out.target.substr(conditionPos + 3, conditionEnd - conditionPos - 3);
+        }
+        out.target = out.target.substr(0, conditionPos);
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+// story_tokenizer.h - Single-pass story script tokenizer working in place over the file bytes
+#pragma once
+#include <SDL3/SDL.h>       // For Uint64
+#include <string_view>      // For std::string_view
+
+// --- Line Tokens ---
+// Every view in a token points into the buffer being tokenized; nothing is copied.
+enum StoryLineKind {
+    STORY_LINE_BLANK,        // Empty or whitespace only
+    STORY_LINE_COMMENT,      // # ...
+    STORY_LINE_CHOICE_OPEN,  // A lone '[' opening a choice block
+    STORY_LINE_CHOICE_CLOSE, // A lone ']' closing it
+    STORY_LINE_TAG,          // [NAME ...]: effects, statements, [VOICE], [SPEED], [LABEL]
+    STORY_LINE_DIALOG,       // Optional 'Speaker' prefix, then "quoted text"
+    STORY_LINE_OTHER         // Anything else (it may still carry a 'Speaker' prefix)
+};
+
+struct StoryToken {
+    StoryLineKind kind = STORY_LINE_BLANK;
+    int rawLineNumber = 0;       // 1-based line number in the file
+    std::string_view text;       // The line without leading whitespace or its line break
+    std::string_view tagName;    // TAG: the NAME of [NAME ...] (may be empty)
+    std::string_view speaker;    // DIALOG / OTHER: the 'Speaker' prefix, if hasSpeaker
+    bool hasSpeaker = false;
+    std::string_view dialog;     // DIALOG: the text between the quotes, markup included
+};
+
+// Classifies one line (without its line break) into `token`, keeping its rawLineNumber. Shared by
+// the loader and the streaming index, so both recognize dialog lines the same way.
+void classifyStoryLine(std::string_view line, StoryToken& token);
+
+// --- StoryTokenizer ---
+// Walks a whole script (or a streamed window of one) held in memory, one line per next(). Lines
+// end at '\n' with an optional '\r' before it; the last line may have no line break.
+class StoryTokenizer {
+public:
+    // rawLineNumber: file lines before the start of `buffer`
+    explicit StoryTokenizer(std::string_view buffer, int rawLineNumber = 0)
+        : buffer(buffer), pos(0), rawLineNumber(rawLineNumber) {}
+
+    // Reads and classifies the next line. Returns false at the end of the buffer.
+    bool next(StoryToken& token);
+
+    // Bytes consumed so far, line breaks included
+    Uint64 getOffset() const { return pos; }
+
+private:
+    std::string_view buffer;
+    size_t pos;
+    int rawLineNumber;
+};
+
+// --- Arguments ---
+// Skips spaces and tabs, then parses one number with std::from_chars and advances `args` past it.
+// Returns false (leaving `args` as it was) if no number starts there.
+bool parseStoryNumber(std::string_view& args, float& value);
+bool parseStoryNumber(std::string_view& args, int& value);
+
+// Whether only spaces and tabs are left in `args`.
+bool isStoryArgsEnd(std::string_view args);
+
+// The arguments of a tag line: the text between its name and the first ']'. Returns false if
+// the ']' is missing.
+bool getStoryTagArgs(const StoryToken& token, std::string_view& args);
+
+// --- Labels ---
+// Whether `name` can be a label: letters, digits and '_', not starting with a digit. Anything
+// else (a '.', a '/') makes a jump target a file name.
+bool isStoryLabelName(std::string_view name);
+
+// The name of a [LABEL name] tag line. Returns false if the ']' is missing or the name isn't valid.
+bool parseStoryLabelTag(const StoryToken& token, std::string_view& name);
+
+// --- Choices ---
+// A line inside a choice block: "Text" -> target [IF condition]
+struct StoryChoiceToken {
+    std::string_view text;       // Between the quotes
+    std::string_view target;     // After "->", without the condition
+    std::string_view condition;  // Inside [IF ...], if hasCondition and conditionClosed
+    bool hasCondition = false;
+    bool conditionClosed = false; // The [IF has its ']'
+};
+
+// Splits a choice line. Returns false if the quotes or the "->" are missing or out of order.
+bool parseStoryChoiceLine(std::string_view line, StoryChoiceToken& out);
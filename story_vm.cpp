@@ -0,0 +1,380 @@
+// story_vm.cpp - Implementation of the story condition compiler and interpreter
+#include "story_vm.h"       // Include the corresponding header
+#include <cctype>           // For std::isdigit, std::isalpha, std::isspace
+#include <cstdlib>          // For std::strtol
+#include <charconv>         // For std::from_chars
+#include <climits>          // For INT_MAX
+#include <algorithm>        // For std::min
+#include "story_tokenizer.h" // For isStoryLabelName
+
+// --- StoryVariables ---
+bool StoryVariables::intern(const std::string& name, Uint16& slot) {
+    auto it = slots.find(name);
+    if (it != slots.end()) {
+        slot = it->second;
+        return true;
+    }
+    if (names.size() > 0xFFFF) {
+        return false;
+    }
+    slot = (Uint16)names.size();
+    slots.emplace(name, slot);
+    names.push_back(name);
+    values.push_back(0);
+    return true;
+}
+
+void StoryVariables::resetValues() {
+    for (auto& value : values) {
+        value = 0;
+    }
+}
+
+void StoryProgram::clear() {
+    code.clear();
+    jumpTargets.clear();
+}
+
+// --- Expression Compiler ---
+// Recursive descent over the expression text, emitting stack code as it goes.
+//   expr    := and ('||' and)*
+//   and     := unary ('&&' unary)*
+//   unary   := '!' unary | compare
+//   compare := primary (('=='|'!='|'<'|'<='|'>'|'>=') primary)?
+//   primary := integer | '-' integer | true | false | name | '(' expr ')'
+namespace {
+
+class ExpressionCompiler {
+public:
+    ExpressionCompiler(const std::string& text, std::vector<StoryInstr>& out, StoryVariables& variables)
+        : text(text), pos(0), out(out), variables(variables), depth(0), maxDepth(0) {}
+
+    bool compile(std::string& error) {
+        if (!parseOr()) {
+            error = errorMessage;
+            return false;
+        }
+        skipSpaces();
+        if (pos != text.size()) {
+            error = "unexpected '" + text.substr(pos) + "' in condition";
+            return false;
+        }
+        if (maxDepth > STORY_VM_STACK_SIZE) {
+            error = "condition is nested too deeply";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const std::string& text;
+    size_t pos;
+    std::vector<StoryInstr>& out;
+    StoryVariables& variables;
+    int depth;       // Stack depth at this point of the emitted code
+    int maxDepth;
+    std::string errorMessage;
+
+    void emit(StoryOp op, Uint16 slot, Sint32 value, int stackEffect) {
+        out.push_back({(Uint16)op, slot, value});
+        depth += stackEffect;
+        if (depth > maxDepth) maxDepth = depth;
+    }
+
+    void skipSpaces() {
+        while (pos < text.size() && std::isspace((unsigned char)text[pos])) pos++;
+    }
+
+    bool match(const char* token) {
+        skipSpaces();
+        size_t len = 0;
+        while (token[len]) len++;
+        if (text.compare(pos, len, token) == 0) {
+            pos += len;
+            return true;
+        }
+        return false;
+    }
+
+    bool fail(const std::string& message) {
+        if (errorMessage.empty()) errorMessage = message;
+        return false;
+    }
+
+    bool parseOr() {
+        if (!parseAnd()) return false;
+        while (match("||")) {
+            if (!parseAnd()) return false;
+            emit(STORY_OP_OR, 0, 0, -1);
+        }
+        return true;
+    }
+
+    bool parseAnd() {
+        if (!parseUnary()) return false;
+        while (match("&&")) {
+            if (!parseUnary()) return false;
+            emit(STORY_OP_AND, 0, 0, -1);
+        }
+        return true;
+    }
+
+    bool parseUnary() {
+        skipSpaces();
+        // '!' but not the start of '!='
+        if (pos < text.size() && text[pos] == '!' && (pos + 1 >= text.size() || text[pos + 1] != '=')) {
+            pos++;
+            if (!parseUnary()) return false;
+            emit(STORY_OP_NOT, 0, 0, 0);
+            return true;
+        }
+        return parseCompare();
+    }
+
+    bool parseCompare() {
+        if (!parsePrimary()) return false;
+        StoryOp op;
+        // Two-character operators first so "<=" isn't read as "<"
+        if (match("==")) op = STORY_OP_EQ;
+        else if (match("!=")) op = STORY_OP_NE;
+        else if (match("<=")) op = STORY_OP_LE;
+        else if (match(">=")) op = STORY_OP_GE;
+        else if (match("<")) op = STORY_OP_LT;
+        else if (match(">")) op = STORY_OP_GT;
+        else return true;
+        if (!parsePrimary()) return false;
+        emit(op, 0, 0, -1);
+        return true;
+    }
+
+    bool parsePrimary() {
+        skipSpaces();
+        if (pos >= text.size()) return fail("condition ends unexpectedly");
+
+        char c = text[pos];
+        if (c == '(') {
+            pos++;
+            if (!parseOr()) return false;
+            if (!match(")")) return fail("missing ')' in condition");
+            return true;
+        }
+        if (std::isdigit((unsigned char)c) || (c == '-' && pos + 1 < text.size() && std::isdigit((unsigned char)text[pos + 1]))) {
+            const char* begin = text.c_str() + pos;
+            char* end = nullptr;
+            long value = std::strtol(begin, &end, 10);
+            if (value > INT_MAX || value < -INT_MAX) return fail("number out of range in condition");
+            pos += (size_t)(end - begin);
+            emit(STORY_OP_PUSH_CONST, 0, (Sint32)value, +1);
+            return true;
+        }
+        if (std::isalpha((unsigned char)c) || c == '_') {
+            size_t start = pos;
+            while (pos < text.size() && (std::isalnum((unsigned char)text[pos]) || text[pos] == '_' || text[pos] == '.')) pos++;
+            std::string name = text.substr(start, pos - start);
+            if (name == "true") { emit(STORY_OP_PUSH_CONST, 0, 1, +1); return true; }
+            if (name == "false") { emit(STORY_OP_PUSH_CONST, 0, 0, +1); return true; }
+            Uint16 slot;
+            if (!variables.intern(name, slot)) return fail("too many story variables");
+            emit(STORY_OP_PUSH_VAR, slot, 0, +1);
+            return true;
+        }
+        return fail(std::string("unexpected '") + c + "' in condition");
+    }
+};
+
+// Splits "NAME rest" after a statement keyword; NAME must be a valid variable name.
+bool splitNameAndRest(const std::string& body, std::string& name, std::string& rest) {
+    size_t start = body.find_first_not_of(" \t");
+    if (start == std::string::npos) return false;
+    size_t end = start;
+    while (end < body.size() && (std::isalnum((unsigned char)body[end]) || body[end] == '_' || body[end] == '.')) end++;
+    if (end == start || std::isdigit((unsigned char)body[start])) return false;
+    name = body.substr(start, end - start);
+    rest = body.substr(end);
+    // Allow an optional '=' ([SET gold = 10]); "==" would be a comparison, not an assignment
+    size_t restStart = rest.find_first_not_of(" \t");
+    if (restStart != std::string::npos && rest[restStart] == '=' && rest.compare(restStart, 2, "==") != 0) {
+        rest = rest.substr(restStart + 1);
+    }
+    return true;
+}
+
+} // namespace
+
+// --- Compiler Entry Points ---
+bool compileStoryStatement(const std::string& tag, std::vector<StoryInstr>& out, StoryProgram& program,
+                           StoryVariables& variables, std::string& error) {
+    size_t close = tag.rfind(']');
+    if (tag.empty() || tag[0] != '[' || close == std::string::npos) {
+        error = "missing ']'";
+        return false;
+    }
+    size_t keywordEnd = tag.find_first_of(" \t]", 1);
+    std::string keyword = tag.substr(1, keywordEnd - 1);
+    std::string body = tag.substr(keywordEnd, close - keywordEnd);
+
+    if (keyword == "SET" || keyword == "ADD") {
+        std::string name, valueExpr;
+        if (!splitNameAndRest(body, name, valueExpr)) {
+            error = "expected a variable name";
+            return false;
+        }
+        Uint16 slot;
+        if (!variables.intern(name, slot)) {
+            error = "too many story variables";
+            return false;
+        }
+        if (valueExpr.find_first_not_of(" \t") == std::string::npos) {
+            valueExpr = "true"; // [SET flag] is shorthand for [SET flag true]
+        }
+        ExpressionCompiler expr(valueExpr, out, variables);
+        if (!expr.compile(error)) return false;
+        out.push_back({(Uint16)(keyword == "SET" ? STORY_OP_SET : STORY_OP_ADD), slot, 0});
+        return true;
+    }
+
+    if (keyword == "IF") {
+        size_t arrow = body.find("->");
+        if (arrow == std::string::npos) {
+            error = "[IF] needs a '-> target'";
+            return false;
+        }
+        StoryJumpTarget target;
+        const std::string_view targetText = std::string_view(body).substr(arrow + 2);
+        std::string_view targetFile, targetLabel;
+        if (!parseStoryTarget(targetText, targetFile, targetLabel, target.lineIndex)) {
+            error = "invalid [IF] target '" + std::string(targetText) + "'";
+            return false;
+        }
+        target.file = std::string(targetFile);
+        target.label = std::string(targetLabel);
+        std::string condition = body.substr(0, arrow); // Named: the compiler keeps a reference to it
+        ExpressionCompiler expr(condition, out, variables);
+        if (!expr.compile(error)) return false;
+        out.push_back({(Uint16)STORY_OP_JUMP_IF_FALSE, 0, 1}); // Skip the GOTO when false
+        out.push_back({(Uint16)STORY_OP_GOTO, 0, (Sint32)program.jumpTargets.size()});
+        program.jumpTargets.push_back(target);
+        return true;
+    }
+
+    error = "unknown statement '" + keyword + "'";
+    return false;
+}
+
+Uint32 compileStoryCondition(const std::string& expression, StoryProgram& program,
+                             StoryVariables& variables, std::string& error) {
+    const size_t start = program.code.size();
+    ExpressionCompiler expr(expression, program.code, variables);
+    if (!expr.compile(error)) {
+        program.code.resize(start); // Drop the partial code
+        return STORY_NO_CODE;
+    }
+    program.code.push_back({(Uint16)STORY_OP_END, 0, 0});
+    return (Uint32)start;
+}
+
+Uint32 appendStoryBlock(StoryProgram& program, const std::vector<StoryInstr>& block) {
+    if (block.empty()) return STORY_NO_CODE;
+    const Uint32 start = (Uint32)program.code.size();
+    program.code.insert(program.code.end(), block.begin(), block.end());
+    program.code.push_back({(Uint16)STORY_OP_END, 0, 0});
+    return start;
+}
+
+// A whole line index: optional leading whitespace, then only digits (an optional sign first).
+static bool parseTargetLineIndex(std::string_view text, int& lineIndex) {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos) return false;
+    if (text[start] == '+' && start + 1 < text.size() && text[start + 1] != '-') start++;
+    const char* end = text.data() + text.size();
+    const std::from_chars_result result = std::from_chars(text.data() + start, end, lineIndex);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+bool parseStoryTarget(std::string_view text, std::string_view& file, std::string_view& label, int& lineIndex) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) return false;
+    size_t last = text.find_last_not_of(" \t\r\n");
+    const std::string_view target = text.substr(first, last - first + 1);
+    label = std::string_view();
+
+    size_t colonPos = target.find(':');
+    if (colonPos != std::string_view::npos) {
+        file = target.substr(0, colonPos);
+        if (file.empty()) return false;
+        std::string_view line = target.substr(colonPos + 1);
+        if (parseTargetLineIndex(line, lineIndex)) return true;
+        line.remove_prefix(std::min(line.size(), line.find_first_not_of(" \t")));
+        if (!isStoryLabelName(line)) return false;
+        label = line;
+        lineIndex = 0;
+        return true;
+    }
+
+    file = std::string_view();
+    if (!parseTargetLineIndex(target, lineIndex)) {
+        lineIndex = 0;
+        if (isStoryLabelName(target)) {
+            label = target;
+        } else {
+            file = target; // A bare file name starts at its first line
+        }
+    }
+    return true;
+}
+
+// --- Interpreter ---
+// Shared dispatch loop. Returns the jump target index for GOTO, -1 at END (with the top of the
+// stack, if any, in `result`).
+static int executeStoryCode(const StoryProgram& program, Uint32 pc, Sint32* variables, Sint32& result) {
+    Sint32 stack[STORY_VM_STACK_SIZE];
+    int sp = 0;
+    const StoryInstr* code = program.code.data();
+
+    for (;;) {
+        const StoryInstr& in = code[pc++];
+        switch (in.op) {
+            case STORY_OP_END:
+                result = (sp > 0) ? stack[sp - 1] : 0;
+                return -1;
+            case STORY_OP_PUSH_CONST: stack[sp++] = in.value; break;
+            case STORY_OP_PUSH_VAR:   stack[sp++] = variables[in.slot]; break;
+            case STORY_OP_NOT:        stack[sp - 1] = !stack[sp - 1]; break;
+            case STORY_OP_AND: sp--;  stack[sp - 1] = (stack[sp - 1] && stack[sp]); break;
+            case STORY_OP_OR:  sp--;  stack[sp - 1] = (stack[sp - 1] || stack[sp]); break;
+            case STORY_OP_EQ:  sp--;  stack[sp - 1] = (stack[sp - 1] == stack[sp]); break;
+            case STORY_OP_NE:  sp--;  stack[sp - 1] = (stack[sp - 1] != stack[sp]); break;
+            case STORY_OP_LT:  sp--;  stack[sp - 1] = (stack[sp - 1] < stack[sp]); break;
+            case STORY_OP_LE:  sp--;  stack[sp - 1] = (stack[sp - 1] <= stack[sp]); break;
+            case STORY_OP_GT:  sp--;  stack[sp - 1] = (stack[sp - 1] > stack[sp]); break;
+            case STORY_OP_GE:  sp--;  stack[sp - 1] = (stack[sp - 1] >= stack[sp]); break;
+            case STORY_OP_SET:        variables[in.slot] = stack[--sp]; break;
+            case STORY_OP_ADD: // Wraps around on overflow (in unsigned, where that's defined)
+                sp--;
+                variables[in.slot] = (Sint32)((Uint32)variables[in.slot] + (Uint32)stack[sp]);
+                break;
+            case STORY_OP_JUMP_IF_FALSE:
+                if (!stack[--sp]) pc += (Uint32)in.value;
+                break;
+            case STORY_OP_GOTO:
+                return in.value;
+            default:
+                result = 0;
+                return -1; // Unknown opcode: treat as END
+        }
+    }
+}
+
+int runStoryCode(const StoryProgram& program, Uint32 start, Sint32* variables) {
+    if (start == STORY_NO_CODE) return -1;
+    Sint32 unused;
+    return executeStoryCode(program, start, variables, unused);
+}
+
+bool evaluateStoryCondition(const StoryProgram& program, Uint32 start, const Sint32* variables) {
+    if (start == STORY_NO_CODE) return true;
+    Sint32 result = 0;
+    // Conditions never contain SET/ADD, so the variables are only read
+    executeStoryCode(program, start, const_cast<Sint32*>(variables), result);
+    return result != 0;
+}
@@ -0,0 +1,116 @@
+// story_vm.h - Story variables, condition compiler and bytecode interpreter
+#pragma once
+#include <SDL3/SDL.h>       // For Uint16, Uint32, Sint32
+#include <string>           // For std::string
+#include <string_view>      // For std::string_view
+#include <vector>           // For std::vector
+#include <unordered_map>    // For std::unordered_map (variable name interning)
+
+// --- Script Syntax ---
+// Statements are tags placed before a dialog line, like the effect tags. They compile into
+// that line's "enter" code, which runs when the story arrives at the line:
+//   [SET name expr]          assign a variable (flags are just variables: [SET metGuard true])
+//   [ADD name expr]          add to a counter ([ADD gold -5])
+//   [IF expr -> target]      jump instead of showing the line when expr holds (target as in choices)
+// Choices can be made conditional by appending a condition after the target:
+//   "Buy the sword" -> 12 [IF gold >= 10]
+// Expressions: integers, true/false, variable names (unset variables are 0), parentheses,
+// == != < <= > >=, and ! && ||. Any non-zero value counts as true.
+
+// --- Bytecode ---
+enum StoryOp : Uint16 {
+    STORY_OP_END,            // Stop; a condition's result is the value on top of the stack
+    STORY_OP_PUSH_CONST,     // push value
+    STORY_OP_PUSH_VAR,       // push variables[slot]
+    STORY_OP_NOT,
+    STORY_OP_AND,
+    STORY_OP_OR,
+    STORY_OP_EQ,
+    STORY_OP_NE,
+    STORY_OP_LT,
+    STORY_OP_LE,
+    STORY_OP_GT,
+    STORY_OP_GE,
+    STORY_OP_SET,            // variables[slot] = pop
+    STORY_OP_ADD,            // variables[slot] += pop
+    STORY_OP_JUMP_IF_FALSE,  // if (!pop) skip the next `value` instructions (relative, so blocks relocate freely)
+    STORY_OP_GOTO            // stop and jump to jumpTargets[value]
+};
+
+// One instruction: 8 bytes, no pointers, so a program is one flat array.
+struct StoryInstr {
+    Uint16 op;
+    Uint16 slot;             // Variable slot for PUSH_VAR / SET / ADD
+    Sint32 value;            // Constant, relative skip or jump-target index
+};
+
+// Where a choice or an [IF ... -> target] goes: a line of this file or another one, by number or
+// by [LABEL]. Labels of the loaded file are looked up when it's loaded; labels of another file
+// when the jump is taken, since that file has to be loaded then anyway.
+struct StoryJumpTarget {
+    std::string file;        // Empty for a jump within the current file
+    std::string label;       // A label not looked up yet (lineIndex is meaningless until it is)
+    int lineIndex = 0;       // -1: the target couldn't be resolved (reported at load)
+};
+
+// Marks "no code" for lines without statements and choices without conditions.
+const Uint32 STORY_NO_CODE = 0xFFFFFFFFu;
+
+// Maximum evaluation stack depth; deeper expressions are rejected at compile time.
+const int STORY_VM_STACK_SIZE = 32;
+
+// --- StoryVariables ---
+// Names are interned to slots at compile time, so running code only indexes a flat array.
+// Variables live for the whole session (they carry over when a choice loads another file).
+struct StoryVariables {
+    std::unordered_map<std::string, Uint16> slots;
+    std::vector<std::string> names;
+    std::vector<Sint32> values;
+
+    // Returns the slot for a name, creating it (with value 0) on first use.
+    // Returns false if the slot limit (65536 variables) is reached.
+    bool intern(const std::string& name, Uint16& slot);
+
+    // Resets every variable to 0, keeping the slots.
+    void resetValues();
+};
+
+// --- StoryProgram ---
+// The compiled code of one loaded story file.
+struct StoryProgram {
+    std::vector<StoryInstr> code;
+    std::vector<StoryJumpTarget> jumpTargets;
+
+    void clear();
+};
+
+// --- Compiler ---
+// Compiles one statement tag ([SET ...], [ADD ...] or [IF ... -> ...]) and appends its code to `out`.
+// Jump targets are added to program.jumpTargets. Returns false with a message in `error` if malformed.
+bool compileStoryStatement(const std::string& tag, std::vector<StoryInstr>& out, StoryProgram& program,
+                           StoryVariables& variables, std::string& error);
+
+// Compiles a condition expression into program.code (terminated by END) and returns its start,
+// or STORY_NO_CODE with a message in `error` if it's malformed.
+Uint32 compileStoryCondition(const std::string& expression, StoryProgram& program,
+                             StoryVariables& variables, std::string& error);
+
+// Appends a block of statement code to the program (terminated by END) and returns its start,
+// or STORY_NO_CODE if the block is empty.
+Uint32 appendStoryBlock(StoryProgram& program, const std::vector<StoryInstr>& block);
+
+// Parses a jump target as used by choices and [IF]: "12", "label", "file.txt:3", "file.txt:label"
+// or "file.txt" (line 0). A bare target that is a valid label name is a label; anything else
+// that isn't a number is a file name. Surrounding whitespace is ignored. Returns false if the
+// text is empty or what follows a ':' is neither a number nor a label name.
+// `file` and `label` point into `text` (empty when not given).
+bool parseStoryTarget(std::string_view text, std::string_view& file, std::string_view& label, int& lineIndex);
+
+// --- Interpreter ---
+// Both run without allocating: the stack is a fixed array and variables are indexed by slot.
+
+// Runs a statement block. Returns the index of the jump target taken, or -1 if it ran to the end.
+int runStoryCode(const StoryProgram& program, Uint32 start, Sint32* variables);
+
+// Evaluates a condition compiled by compileStoryCondition. STORY_NO_CODE counts as true.
+bool evaluateStoryCondition(const StoryProgram& program, Uint32 start, const Sint32* variables);
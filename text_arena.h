@@ -0,0 +1,44 @@
+// text_arena.h - One contiguous buffer holding every string of a loaded story
+#pragma once
+#include <SDL3/SDL.h>       // For Uint32
+#include <string_view>      // For std::string_view
+#include <vector>           // For std::vector
+
+// --- StoryStr ---
+// A string in a TextArena: an offset and length instead of a pointer, so handles stay valid
+// when the arena grows.
+struct StoryStr {
+    Uint32 offset = 0;
+    Uint32 length = 0;
+};
+
+// --- TextArena ---
+// Strings are appended back to back, each followed by a '\0' so a view can be handed to C APIs
+// (SDL_ttf treats a length of 0 as "NUL-terminated"). clear() keeps the capacity, so reloading
+// a streaming window allocates nothing; freeing the arena frees every string at once.
+class TextArena {
+public:
+    void reserve(size_t bytes) { data.reserve(bytes); }
+
+    StoryStr add(std::string_view text) {
+        StoryStr s;
+        s.offset = (Uint32)data.size();
+        s.length = (Uint32)text.size();
+        data.insert(data.end(), text.begin(), text.end());
+        data.push_back('\0');
+        return s;
+    }
+
+    std::string_view view(StoryStr s) const {
+        return data.empty() ? std::string_view() : std::string_view(data.data() + s.offset, s.length);
+    }
+
+    // NUL-terminated, like std::string::c_str()
+    const char* c_str(StoryStr s) const { return data.empty() ? "" : data.data() + s.offset; }
+
+    size_t size() const { return data.size(); }
+    void clear() { data.clear(); }
+
+private:
+    std::vector<char> data;
+};
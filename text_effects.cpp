@@ -1,8 +1,6 @@
 // text_effects.cpp - Implementation for text-specific effects
 #include "text_effects.h" // Include the corresponding header
-#include <cstdlib> // For rand(), srand()
 #include <iostream> // For std::cerr
-#include <sstream> // For std::istringstream
 #include <cmath>   // For std::fabs, std::sin, M_PI, std::pow (for drag)
 #include <algorithm> // For std::min, std::max (not directly used here, but common)
 
@@ -12,122 +10,82 @@
 extern const int winHeight;
 
 
-// --- Jitter Effect Implementations ---
-std::vector<RenderedWord> initJitterWords(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, int x, int y, int wrapWidth) {
+// --- Effect Words ---
+// One RenderedWord per word of the line's layout, at the position the typewriter text has it,
+// so the text doesn't move when an effect takes over.
+std::vector<RenderedWord> initLayoutWords(TTF_TextEngine* textEngine, TTF_Font* font, std::string_view text,
+                                          const TextLayout& layout, int x, int y) {
     std::vector<RenderedWord> words;
-    std::string currentWord;
-    int currentX = x;
-    int currentY = y;
-    int spaceWidth;
-    TTF_GetStringSize(font, " ", 1, &spaceWidth, nullptr); // Get space width for a single space character
-
-    std::istringstream iss(text);
-    std::string wordStr;
-    while (iss >> wordStr) {
-        int wordW, wordH;
-        TTF_GetStringSize(font, wordStr.c_str(), wordStr.length(), &wordW, &wordH);
-
-        // Simple wrapping logic
-        if (currentX + wordW > x + wrapWidth && currentX > x) {
-            currentX = x;
-            currentY += wordH; // Move to next line
-        }
-
+    words.reserve(layout.words.size());
+    for (const LayoutWord& layoutWord : layout.words) {
         RenderedWord word;
-        word.text = wordStr;
-        word.rect = {(float)currentX, (float)currentY, (float)wordW, (float)wordH};
-        word.originalRect = word.rect; // Store the initial position for jitter effect
-        word.vx = 0; word.vy = 0;
-        word.ax = 0; word.ay = 0;
+        word.text = text.substr(layoutWord.start, layoutWord.end - layoutWord.start);
+        word.textObject = textEngine ? TTF_CreateText(textEngine, font, word.text.data(), word.text.length()) : nullptr;
+        word.rect = {(float)x + layoutWord.x, (float)(y + layoutWord.row * layout.lineHeight),
+                     layoutWord.width, (float)layout.fontHeight};
+        word.originalRect = word.rect;
+        word.prevRect = word.rect;
+        word.offset = {0.0f, 0.0f};
+        word.vx = 0.0f; word.vy = 0.0f;
+        word.ax = 0.0f; word.ay = 0.0f;
         word.active = true;
         words.push_back(word);
-
-        currentX += wordW + spaceWidth;
     }
     return words;
 }
 
-void applyJitter(std::vector<RenderedWord>& words) {
+void destroyRenderedWords(std::vector<RenderedWord>& words) {
+    for (auto& word : words) {
+        if (word.textObject) TTF_DestroyText(word.textObject);
+    }
+    words.clear();
+}
+
+// --- Jitter Effect Implementations ---
+void applyJitter(std::vector<RenderedWord>& words, EffectRng& rng) {
     // This value controls the intensity of the jitter. Lower value for less jitter.
     const float JITTER_MAGNITUDE = 0.1f;
 
     for (auto& word : words) {
         // Calculate random offsets between -JITTER_MAGNITUDE and +JITTER_MAGNITUDE
-        // Offsets are applied relative to the word's original (non-jittered) position
-        float offsetX = ((float)rand() / RAND_MAX * (2 * JITTER_MAGNITUDE)) - JITTER_MAGNITUDE;
-        float offsetY = ((float)rand() / RAND_MAX * (2 * JITTER_MAGNITUDE)) - JITTER_MAGNITUDE;
-
-        word.rect.x = word.originalRect.x + offsetX;
-        word.rect.y = word.originalRect.y + offsetY;
+        // Offsets are added at draw time, so a falling or floating word jitters along its path
+        word.offset.x = rng.range(-JITTER_MAGNITUDE, JITTER_MAGNITUDE);
+        word.offset.y = rng.range(-JITTER_MAGNITUDE, JITTER_MAGNITUDE);
     }
 }
 
 
 // --- Word Physics (Fall/Float) Implementations ---
-std::vector<RenderedWord> initPhysicsWords(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, int x, int y, int wrapWidth) {
-    std::vector<RenderedWord> words;
-    std::string currentWord;
-    int currentX = x;
-    int currentY = y;
-    int spaceWidth;
-    TTF_GetStringSize(font, " ", 1, &spaceWidth, nullptr);
-
-    std::istringstream iss(text);
-    std::string wordStr;
-    while (iss >> wordStr) {
-        int wordW, wordH;
-        TTF_GetStringSize(font, wordStr.c_str(), wordStr.length(), &wordW, &wordH);
-
-        if (currentX + wordW > x + wrapWidth && currentX > x) {
-            currentX = x;
-            currentY += wordH;
-        }
-
-        RenderedWord word;
-        word.text = wordStr;
-        word.rect = {(float)currentX, (float)currentY, (float)wordW, (float)wordH};
-        word.originalRect = word.rect; // Store original for reference if needed, not strictly used in physics update
-        word.vx = 0.0f;
-        word.vy = 0.0f;
-        word.ax = 0.0f;
-        word.ay = 0.0f;
-        word.active = true; // Start active for physics
-        words.push_back(word);
-
-        currentX += wordW + spaceWidth;
-    }
-    return words;
-}
-
-void applyfallEffect(std::vector<RenderedWord>& words) {
+void applyfallEffect(std::vector<RenderedWord>& words, EffectRng& rng) {
     const float INITIAL_VELOCITY_X_SPREAD = 100.0f; // Spread around 0 for horizontal velocity
     const float INITIAL_VELOCITY_Y_MIN = 200.0f;    // Min initial downward velocity
     const float INITIAL_VELOCITY_Y_MAX = 400.0f;    // Max initial downward velocity
     const float GRAVITY = 980.0f;                   // Standard gravity (pixels/sec^2)
 
     for (auto& word : words) {
-        word.vx = (float)rand() / RAND_MAX * (2.0f * INITIAL_VELOCITY_X_SPREAD) - INITIAL_VELOCITY_X_SPREAD;
-        word.vy = ((float)rand() / RAND_MAX * (INITIAL_VELOCITY_Y_MAX - INITIAL_VELOCITY_Y_MIN)) + INITIAL_VELOCITY_Y_MIN;
+        word.vx = rng.range(-INITIAL_VELOCITY_X_SPREAD, INITIAL_VELOCITY_X_SPREAD);
+        word.vy = rng.range(INITIAL_VELOCITY_Y_MIN, INITIAL_VELOCITY_Y_MAX);
         word.ay = GRAVITY; // Apply gravity for fall effect
         word.active = true;
     }
 }
 
-void applyfloatEffect(std::vector<RenderedWord>& words) {
+void applyfloatEffect(std::vector<RenderedWord>& words, EffectRng& rng) {
     const float INITIAL_VELOCITY_X_SPREAD = 100.0f;
     const float INITIAL_VELOCITY_Y_MIN = 200.0f;
     const float INITIAL_VELOCITY_Y_MAX = 400.0f;
     const float ANTI_GRAVITY = -980.0f; // Negative for upward acceleration
 
     for (auto& word : words) {
-        word.vx = (float)rand() / RAND_MAX * (2.0f * INITIAL_VELOCITY_X_SPREAD) - INITIAL_VELOCITY_X_SPREAD;
-        word.vy = -(((float)rand() / RAND_MAX * (INITIAL_VELOCITY_Y_MAX - INITIAL_VELOCITY_Y_MIN)) + INITIAL_VELOCITY_Y_MIN);
+        word.vx = rng.range(-INITIAL_VELOCITY_X_SPREAD, INITIAL_VELOCITY_X_SPREAD);
+        word.vy = -rng.range(INITIAL_VELOCITY_Y_MIN, INITIAL_VELOCITY_Y_MAX);
         word.ay = ANTI_GRAVITY; // Apply anti-gravity for float effect
         word.active = true;
     }
 }
 
 void updatePhysicsWords(std::vector<RenderedWord>& words, float deltaTime) {
+    // deltaTime is always the fixed simulation step, so the result doesn't depend on frame rate
     const float DRAG_FACTOR = 0.98f; // Reduced drag for smoother motion
     const float MIN_VELOCITY_DEACTIVATE = 5.0f; // Stop small movements
     const float BOUNCE_FACTOR = 0.7f; // How much velocity is retained after bounce (0.0 to 1.0)
@@ -137,6 +95,7 @@ void updatePhysicsWords(std::vector<RenderedWord>& words, float deltaTime) {
     const int TOP_COLLISION_Y = 0;                 // Top of the window
 
     for (auto& word : words) {
+        word.prevRect = word.rect;
         if (word.active) {
             // Apply acceleration
             word.vx += word.ax * deltaTime;
@@ -184,63 +143,57 @@ void updatePhysicsWords(std::vector<RenderedWord>& words, float deltaTime) {
 
 
 // --- Text Color Pulse Effect Implementations ---
-// Define global state variables (declared extern in text_effects.h)
-Uint64 pulseStartTime = 0;
-Uint64 pulseDuration = 0;
-float pulseFrequencyHz = 2.0f; // Default frequency (e.g., 2 cycles per second)
-SDL_Color pulseColorStart = {255, 255, 255, 255}; // Default white
-SDL_Color pulseColorEnd = {255, 100, 100, 255};   // Default reddish
-bool pulseActive = false;
-
-void initTextColorPulse(Uint64 durationMs, float frequencyHz, SDL_Color c1, SDL_Color c2) {
-    pulseStartTime = SDL_GetTicks();
-    pulseDuration = durationMs;
-    pulseFrequencyHz = frequencyHz;
-    pulseColorStart = c1;
-    pulseColorEnd = c2;
-    pulseActive = true;
-    getPulsingTextColor(pulseStartTime);
+void initTextColorPulse(TextEffectsContext& ctx, Uint64 startTicks, Uint64 durationMs, float frequencyHz, SDL_Color c1, SDL_Color c2) {
+    ctx.pulseStartTime = startTicks;
+    ctx.pulseDuration = durationMs;
+    ctx.pulseFrequencyHz = frequencyHz;
+    ctx.pulseColorStart = c1;
+    ctx.pulseColorEnd = c2;
+    ctx.pulseActive = true;
+    getPulsingTextColor(ctx, ctx.pulseStartTime);
 }
 
-SDL_Color getPulsingTextColor(Uint64 currentTicks) {
-    if (!pulseActive) {
-        return pulseColorStart; // Return the start color if not active
+SDL_Color getPulsingTextColor(TextEffectsContext& ctx, Uint64 currentTicks) {
+    if (!ctx.pulseActive) {
+        return ctx.pulseColorStart; // Return the start color if not active
     }
 
-    Uint64 elapsed = currentTicks - pulseStartTime;
+    Uint64 elapsed = currentTicks - ctx.pulseStartTime;
     // Check if pulse has ended
-    if (pulseDuration > 0 && elapsed >= pulseDuration) {
-        pulseActive = false; // Deactivate
+    if (ctx.pulseDuration > 0 && elapsed >= ctx.pulseDuration) {
+        ctx.pulseActive = false; // Deactivate
         // Return the end color or start color here, based on desired final state after pulse completes.
         // Returning pulseColorStart is common if it's meant to revert.
-        return pulseColorStart;
+        return ctx.pulseColorStart;
     }
 
     float timeInSeconds = (float)elapsed / 1000.0f; // Corrected: use 1000.0f for seconds
 
     // Corrected phase calculation for continuous pulsing starting at 0.0f
     // sin(x - PI/2) starts at -1 when x=0. Adding 1 and dividing by 2 maps to 0..1.
-    float phase = (std::sin(timeInSeconds * pulseFrequencyHz * 2 * M_PI - M_PI / 2.0f) + 1.0f) / 2.0f;
+    float phase = (std::sin(timeInSeconds * ctx.pulseFrequencyHz * 2 * M_PI - M_PI / 2.0f) + 1.0f) / 2.0f;
 
+    const SDL_Color& c1 = ctx.pulseColorStart;
+    const SDL_Color& c2 = ctx.pulseColorEnd;
     SDL_Color interpolatedColor;
     // Linear interpolation: color = color1 * (1-phase) + color2 * phase
-    interpolatedColor.r = (Uint8)(pulseColorStart.r * (1.0f - phase) + pulseColorEnd.r * phase);
-    interpolatedColor.g = (Uint8)(pulseColorStart.g * (1.0f - phase) + pulseColorEnd.g * phase);
-    interpolatedColor.b = (Uint8)(pulseColorStart.b * (1.0f - phase) + pulseColorEnd.b * phase);
-    interpolatedColor.a = (Uint8)(pulseColorStart.a * (1.0f - phase) + pulseColorEnd.a * phase);
+    interpolatedColor.r = (Uint8)(c1.r * (1.0f - phase) + c2.r * phase);
+    interpolatedColor.g = (Uint8)(c1.g * (1.0f - phase) + c2.g * phase);
+    interpolatedColor.b = (Uint8)(c1.b * (1.0f - phase) + c2.b * phase);
+    interpolatedColor.a = (Uint8)(c1.a * (1.0f - phase) + c2.a * phase);
 
     return interpolatedColor;
 }
 
-bool isTextColorPulseActive() {
-    return pulseActive;
+bool isTextColorPulseActive(const TextEffectsContext& ctx) {
+    return ctx.pulseActive;
 }
 
-void deactivateTextColorPulse() {
-    pulseActive = false;
+void deactivateTextColorPulse(TextEffectsContext& ctx) {
+    ctx.pulseActive = false;
     // Reset state variables to their defaults when deactivated
-    pulseStartTime = 0;
-    pulseDuration = 0;
-    pulseFrequencyHz = 2.0f; // Reset to default frequency
+    ctx.pulseStartTime = 0;
+    ctx.pulseDuration = 0;
+    ctx.pulseFrequencyHz = 2.0f; // Reset to default frequency
     // Colors are not reset here, they'll be set again by initTextColorPulse
 }
@@ -3,61 +3,77 @@
 #include <SDL3/SDL.h>       // Included for SDL_FRect, SDL_Color, Uint64
 #include <SDL3_ttf/SDL_ttf.h> // Included for TTF_Font and TTF_TextEngine types, and TTF_GetStringSize
 #include <string>           // For std::string
+#include <string_view>      // For std::string_view
 #include <vector>           // For std::vector
+#include "effect_rng.h"     // For EffectRng (per-effect random streams)
+#include "rich_text.h"      // For TextLayout (word positions)
 
 // --- RenderedWord Struct ---
 // Represents a single word rendered with its position and physics properties
 struct RenderedWord {
-    std::string text;
+    std::string_view text;  // Points into the line's text, which outlives the words
+    TTF_Text* textObject;   // Laid out once by init*Words and drawn every frame; freed by destroyRenderedWords
     SDL_FRect rect;         // Current position and size (where it's rendered)
     SDL_FRect originalRect; // Store the word's original, static position and size
+    SDL_FPoint offset;      // Added when drawn, on top of the physics position (jitter)
+    SDL_FRect prevRect;     // Position at the previous physics step (for interpolated rendering)
     float vx, vy;           // Velocity components
     float ax, ay;           // Acceleration components (e.g., gravity)
     bool active;            // True if word is still actively participating in physics (e.g., falling/floating)
 };
 
 
-// --- Jitter Effect ---
-// Initializes words for the jitter effect, calculating their initial positions.
-// Renderer and font are needed for text measurement.
-std::vector<RenderedWord> initJitterWords(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, int x, int y, int wrapWidth);
+// --- Effect Words ---
+// Initializes one word per word of the line's layout (see rich_text.h), with the text's origin at
+// (x, y), at rest. Each word gets a TTF_Text created with textEngine (null: words are positioned
+// but not drawable). Jitter and physics both act on the same words, so they combine.
+std::vector<RenderedWord> initLayoutWords(TTF_TextEngine* textEngine, TTF_Font* font, std::string_view text,
+                                          const TextLayout& layout, int x, int y);
+
+// Destroys the words' text objects and empties the vector.
+void destroyRenderedWords(std::vector<RenderedWord>& words);
 
-// Applies a random jitter offset to the positions of the words, relative to their original positions.
-void applyJitter(std::vector<RenderedWord>& words);
+
+// --- Jitter Effect ---
+// Draws a new random draw offset for every word, leaving their physics positions alone.
+// rng: The line's jitter stream, so the same line always jitters the same way.
+void applyJitter(std::vector<RenderedWord>& words, EffectRng& rng);
 
 
 // --- Word Physics (Fall/Float) ---
-// Initializes words for physics simulation, calculating their initial positions.
-// Renderer and font are needed for text measurement.
-std::vector<RenderedWord> initPhysicsWords(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, int x, int y, int wrapWidth);
 
-// Applies an initial "pop" force for a falling effect.
-void applyfallEffect(std::vector<RenderedWord>& words);
+// Applies an initial "pop" force for a falling effect, drawing velocities from rng.
+void applyfallEffect(std::vector<RenderedWord>& words, EffectRng& rng);
 
-// Applies an initial "pop" force for a floating effect.
-void applyfloatEffect(std::vector<RenderedWord>& words);
+// Applies an initial "pop" force for a floating effect, drawing velocities from rng.
+void applyfloatEffect(std::vector<RenderedWord>& words, EffectRng& rng);
 
-// Updates the position and velocity of words based on physics (gravity/anti-gravity, drag).
-void updatePhysicsWords(std::vector<RenderedWord>& words, float deltaTime);
+// Advances the position and velocity of words by one fixed physics step (gravity/anti-gravity, drag).
+// The position before the step is kept in prevRect for interpolation.
+void updatePhysicsWords(std::vector<RenderedWord>& words, float stepSeconds);
 
 
 // --- Text Color Pulse Effect ---
-// These are global state variables for the pulse effect, defined in text_effects.cpp
-extern Uint64 pulseStartTime;
-extern Uint64 pulseDuration;
-extern float pulseFrequencyHz;
-extern SDL_Color pulseColorStart;
-extern SDL_Color pulseColorEnd;
-extern bool pulseActive;
+// Per-instance state for the pulse effect. Each StoryManager owns one of these,
+// so several stories can pulse independently (e.g. in the batch renderer's worker threads).
+struct TextEffectsContext {
+    Uint64 pulseStartTime = 0;
+    Uint64 pulseDuration = 0;
+    float pulseFrequencyHz = 2.0f;                    // Default frequency (e.g., 2 cycles per second)
+    SDL_Color pulseColorStart = {255, 255, 255, 255}; // Default white
+    SDL_Color pulseColorEnd = {255, 100, 100, 255};   // Default reddish
+    bool pulseActive = false;
+};
 
 // Initializes the text color pulsing effect with a duration, frequency, and two colors to interpolate between.
-void initTextColorPulse(Uint64 durationMs, float frequencyHz, SDL_Color startColor, SDL_Color endColor);
+// startTicks: The story clock time the pulse starts at.
+void initTextColorPulse(TextEffectsContext& ctx, Uint64 startTicks, Uint64 durationMs, float frequencyHz, SDL_Color startColor, SDL_Color endColor);
 
 // Gets the current interpolated color for the pulsing text based on elapsed time.
-SDL_Color getPulsingTextColor(Uint64 currentTicks);
+SDL_Color getPulsingTextColor(TextEffectsContext& ctx, Uint64 currentTicks);
 
 // Checks if the text color pulse effect is currently active.
-bool isTextColorPulseActive();
+bool isTextColorPulseActive(const TextEffectsContext& ctx);
 
 // Deactivates the text color pulse effect and resets its state.
-void deactivateTextColorPulse();
+void deactivateTextColorPulse(TextEffectsContext& ctx);
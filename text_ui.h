@@ -3,6 +3,7 @@
 #include <SDL3/SDL.h>       // Included for SDL_Color
 #include <SDL3_ttf/SDL_ttf.h> // Included for TTF_Font and TTF_TextEngine types, and TTF_GetStringSize
 #include <string>           // For std::string
+#include <string_view>      // For std::string_view
 #include <vector>           // For std::vector (though not directly used in this specific header, good practice)
 
 // --- Global Constants (Declared extern, defined once in main.cpp) ---
@@ -27,7 +28,7 @@ extern SDL_Color choiceBorderColor;
 // color: The color of the text.
 // x, y: Top-left coordinates for the text.
 // wrapWidth: Maximum width for text wrapping. 0 means no wrapping.
-void renderText(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, SDL_Color color, int x, int y, int wrapWidth = 0);
+void renderText(SDL_Renderer* renderer, TTF_Font* font, std::string_view text, SDL_Color color, int x, int y, int wrapWidth = 0);
 
 // Draws a generic dialog box background and border.
 // x, y, w, h: Position and dimensions of the box.
@@ -36,9 +37,9 @@ void renderText(SDL_Renderer* renderer, TTF_Font* font, const std::string& text,
 void drawDialogBoxUI(SDL_Renderer* renderer, float x, float y, float w, float h, SDL_Color bgColor, SDL_Color borderColor);
 
 // Renders a name tag box with centered text.
-// name: The speaker's name.
+// nameText: The speaker's name as a persistent TTF_Text (drawn from the text engine's glyph atlas); may be null.
 // x, y, w, h: Position and dimensions of the name box.
 // bgColor: Background color of the name box.
 // borderColor: Color of the name box's border.
 // textColor: Color of the name text.
-void renderNameBox(SDL_Renderer* renderer, TTF_Font* font, TTF_TextEngine* textEngine, const std::string& name, float x, float y, float w, float h, SDL_Color bgColor, SDL_Color borderColor, SDL_Color textColor);
+void renderNameBox(SDL_Renderer* renderer, TTF_Text* nameText, float x, float y, float w, float h, SDL_Color bgColor, SDL_Color borderColor, SDL_Color textColor);
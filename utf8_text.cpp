@@ -0,0 +1,182 @@
+// utf8_text.cpp - Implementation of UTF-8 decoding and grapheme cluster segmentation
+#include "utf8_text.h"      // Include the corresponding header
+#include <algorithm>        // For std::lower_bound
+
+// --- Decoding ---
+Uint32 decodeUtf8(std::string_view text, size_t& pos) {
+    const unsigned char lead = (unsigned char)text[pos];
+    if (lead < 0x80) {
+        pos++;
+        return lead;
+    }
+    size_t length;
+    Uint32 cp;
+    if ((lead & 0xE0) == 0xC0) { length = 2; cp = lead & 0x1F; }
+    else if ((lead & 0xF0) == 0xE0) { length = 3; cp = lead & 0x0F; }
+    else if ((lead & 0xF8) == 0xF0) { length = 4; cp = lead & 0x07; }
+    else { pos++; return 0xFFFD; } // Stray continuation byte or invalid lead
+
+    if (pos + length > text.size()) { pos++; return 0xFFFD; }
+    for (size_t i = 1; i < length; ++i) {
+        const unsigned char c = (unsigned char)text[pos + i];
+        if ((c & 0xC0) != 0x80) { pos++; return 0xFFFD; }
+        cp = (cp << 6) | (c & 0x3F);
+    }
+    // Reject overlong forms, surrogates and values past U+10FFFF
+    static const Uint32 minimum[5] = {0, 0, 0x80, 0x800, 0x10000};
+    if (cp < minimum[length] || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) { pos++; return 0xFFFD; }
+    pos += length;
+    return cp;
+}
+
+// --- Properties ---
+namespace {
+
+enum GraphemeProp {
+    GP_OTHER,
+    GP_CR,
+    GP_LF,
+    GP_CONTROL,
+    GP_EXTEND,          // Extend and SpacingMark: both never start a cluster
+    GP_ZWJ,
+    GP_REGIONAL,        // Regional indicator (flag halves)
+    GP_L, GP_V, GP_T, GP_LV, GP_LVT, // Hangul jamo and syllables
+    GP_PICTOGRAPHIC     // Extended_Pictographic (emoji)
+};
+
+struct CodepointRange {
+    Uint32 first;
+    Uint32 last;
+};
+
+// Combining marks and dependent vowel signs, sorted. Covers Latin/Greek/Cyrillic diacritics,
+// Hebrew, Arabic, the Indic scripts, Thai/Lao/Tibetan/Myanmar/Khmer, kana voicing marks,
+// variation selectors, emoji modifiers and tags.
+const CodepointRange EXTEND_RANGES[] = {
+    {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2},
+    {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0610, 0x061A}, {0x064B, 0x065F}, {0x0670, 0x0670},
+    {0x06D6, 0x06DC}, {0x06DF, 0x06E4}, {0x06E7, 0x06E8}, {0x06EA, 0x06ED}, {0x0711, 0x0711},
+    {0x0730, 0x074A}, {0x07A6, 0x07B0}, {0x07EB, 0x07F3}, {0x0816, 0x082D}, {0x0859, 0x085B},
+    {0x08CA, 0x08E1}, {0x08E3, 0x0903}, {0x093A, 0x093C}, {0x093E, 0x094F}, {0x0951, 0x0957},
+    {0x0962, 0x0963}, {0x0981, 0x0983}, {0x09BC, 0x09BC}, {0x09BE, 0x09CD}, {0x09D7, 0x09D7},
+    {0x09E2, 0x09E3}, {0x0A01, 0x0A03}, {0x0A3C, 0x0A51}, {0x0A70, 0x0A71}, {0x0A75, 0x0A75},
+    {0x0A81, 0x0A83}, {0x0ABC, 0x0ABC}, {0x0ABE, 0x0ACD}, {0x0AE2, 0x0AE3}, {0x0B01, 0x0B03},
+    {0x0B3C, 0x0B3C}, {0x0B3E, 0x0B57}, {0x0B62, 0x0B63}, {0x0B82, 0x0B82}, {0x0BBE, 0x0BCD},
+    {0x0BD7, 0x0BD7}, {0x0C00, 0x0C04}, {0x0C3C, 0x0C3C}, {0x0C3E, 0x0C56}, {0x0C62, 0x0C63},
+    {0x0C81, 0x0C83}, {0x0CBC, 0x0CBC}, {0x0CBE, 0x0CD6}, {0x0CE2, 0x0CE3}, {0x0D00, 0x0D03},
+    {0x0D3B, 0x0D3C}, {0x0D3E, 0x0D4D}, {0x0D57, 0x0D57}, {0x0D62, 0x0D63}, {0x0D81, 0x0D83},
+    {0x0DCA, 0x0DDF}, {0x0DF2, 0x0DF3}, {0x0E31, 0x0E31}, {0x0E33, 0x0E3A}, {0x0E47, 0x0E4E},
+    {0x0EB1, 0x0EB1}, {0x0EB3, 0x0EBC}, {0x0EC8, 0x0ECE}, {0x0F18, 0x0F19}, {0x0F35, 0x0F35},
+    {0x0F37, 0x0F37}, {0x0F39, 0x0F39}, {0x0F3E, 0x0F3F}, {0x0F71, 0x0F84}, {0x0F86, 0x0F87},
+    {0x0F8D, 0x0FBC}, {0x0FC6, 0x0FC6}, {0x102B, 0x103E}, {0x1056, 0x1059}, {0x105E, 0x1060},
+    {0x1062, 0x1064}, {0x1067, 0x106D}, {0x1071, 0x1074}, {0x1082, 0x108D}, {0x108F, 0x108F},
+    {0x109A, 0x109D}, {0x135D, 0x135F}, {0x1712, 0x1715}, {0x1732, 0x1734}, {0x1752, 0x1753},
+    {0x1772, 0x1773}, {0x17B4, 0x17D3}, {0x17DD, 0x17DD}, {0x180B, 0x180D}, {0x180F, 0x180F},
+    {0x1885, 0x1886}, {0x18A9, 0x18A9}, {0x1920, 0x193B}, {0x1A17, 0x1A1B}, {0x1A55, 0x1A7F},
+    {0x1AB0, 0x1AFF}, {0x1B00, 0x1B04}, {0x1B34, 0x1B44}, {0x1B6B, 0x1B73}, {0x1B80, 0x1B82},
+    {0x1BA1, 0x1BAD}, {0x1BE6, 0x1BF3}, {0x1C24, 0x1C37}, {0x1CD0, 0x1CD2}, {0x1CD4, 0x1CE8},
+    {0x1CED, 0x1CED}, {0x1CF4, 0x1CF4}, {0x1CF7, 0x1CF9}, {0x1DC0, 0x1DFF}, {0x200C, 0x200C},
+    {0x20D0, 0x20F0}, {0x2CEF, 0x2CF1}, {0x2D7F, 0x2D7F}, {0x2DE0, 0x2DFF}, {0x302A, 0x302F},
+    {0x3099, 0x309A}, {0xA66F, 0xA672}, {0xA674, 0xA67D}, {0xA69E, 0xA69F}, {0xA6F0, 0xA6F1},
+    {0xA802, 0xA802}, {0xA806, 0xA806}, {0xA80B, 0xA80B}, {0xA823, 0xA827}, {0xA82C, 0xA82C},
+    {0xA880, 0xA881}, {0xA8B4, 0xA8C5}, {0xA8E0, 0xA8F1}, {0xA8FF, 0xA8FF}, {0xA926, 0xA92D},
+    {0xA947, 0xA953}, {0xA980, 0xA983}, {0xA9B3, 0xA9C0}, {0xA9E5, 0xA9E5}, {0xAA29, 0xAA36},
+    {0xAA43, 0xAA43}, {0xAA4C, 0xAA4D}, {0xAA7B, 0xAA7D}, {0xAAB0, 0xAAB0}, {0xAAB2, 0xAAB4},
+    {0xAAB7, 0xAAB8}, {0xAABE, 0xAABF}, {0xAAC1, 0xAAC1}, {0xAAEB, 0xAAEF}, {0xAAF5, 0xAAF6},
+    {0xABE3, 0xABEA}, {0xABEC, 0xABED}, {0xFB1E, 0xFB1E}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F},
+    {0xFF9E, 0xFF9F}, {0x1F3FB, 0x1F3FF}, {0xE0020, 0xE007F}, {0xE0100, 0xE01EF},
+};
+
+// Emoji and pictographic symbols (regional indicators and modifiers are classified first)
+const CodepointRange PICTOGRAPHIC_RANGES[] = {
+    {0x00A9, 0x00A9}, {0x00AE, 0x00AE}, {0x203C, 0x203C}, {0x2049, 0x2049}, {0x2122, 0x2122},
+    {0x2139, 0x2139}, {0x2194, 0x21AA}, {0x231A, 0x23FF}, {0x24C2, 0x24C2}, {0x25AA, 0x25FE},
+    {0x2600, 0x27BF}, {0x2934, 0x2935}, {0x2B05, 0x2B55}, {0x3030, 0x3030}, {0x303D, 0x303D},
+    {0x3297, 0x3297}, {0x3299, 0x3299}, {0x1F000, 0x1FAFF},
+};
+
+// Scripts without spaces between words
+const CodepointRange BREAK_ANYWHERE_RANGES[] = {
+    {0x2E80, 0x2FDF},   // CJK radicals
+    {0x3000, 0x303F},   // CJK symbols and punctuation
+    {0x3040, 0x30FF},   // Hiragana, Katakana
+    {0x31F0, 0x31FF},   // Katakana extensions
+    {0x3400, 0x4DBF},   // CJK extension A
+    {0x4E00, 0x9FFF},   // CJK unified ideographs
+    {0xF900, 0xFAFF},   // CJK compatibility ideographs
+    {0xFF00, 0xFFEF},   // Halfwidth and fullwidth forms
+    {0x20000, 0x3134F}, // CJK extensions B-G
+};
+
+template <size_t N>
+bool inRanges(const CodepointRange (&ranges)[N], Uint32 cp) {
+    // First range whose end is >= cp, then check its start
+    const CodepointRange* it = std::lower_bound(ranges, ranges + N, cp,
+        [](const CodepointRange& range, Uint32 value) { return range.last < value; });
+    return it != ranges + N && it->first <= cp;
+}
+
+GraphemeProp getGraphemeProp(Uint32 cp) {
+    if (cp == '\r') return GP_CR;
+    if (cp == '\n') return GP_LF;
+    if (cp < 0x20 || (cp >= 0x7F && cp < 0xA0)) return GP_CONTROL;
+    if (cp < 0x300) return (cp == 0xA9 || cp == 0xAE) ? GP_PICTOGRAPHIC : GP_OTHER; // Fast path for Latin
+    if (cp == 0x200D) return GP_ZWJ;
+    if (cp == 0x2028 || cp == 0x2029) return GP_CONTROL;
+    if (cp >= 0x1100 && cp <= 0x115F) return GP_L;
+    if (cp >= 0xA960 && cp <= 0xA97C) return GP_L;
+    if (cp >= 0x1160 && cp <= 0x11A7) return GP_V;
+    if (cp >= 0xD7B0 && cp <= 0xD7C6) return GP_V;
+    if (cp >= 0x11A8 && cp <= 0x11FF) return GP_T;
+    if (cp >= 0xD7CB && cp <= 0xD7FB) return GP_T;
+    if (cp >= 0xAC00 && cp <= 0xD7A3) return ((cp - 0xAC00) % 28 == 0) ? GP_LV : GP_LVT;
+    if (cp >= 0x1F1E6 && cp <= 0x1F1FF) return GP_REGIONAL;
+    if (inRanges(EXTEND_RANGES, cp)) return GP_EXTEND;
+    if (inRanges(PICTOGRAPHIC_RANGES, cp)) return GP_PICTOGRAPHIC;
+    return GP_OTHER;
+}
+
+} // namespace
+
+bool isBreakAnywhereCodepoint(Uint32 cp) {
+    return cp >= 0x2E80 && inRanges(BREAK_ANYWHERE_RANGES, cp);
+}
+
+// --- Segmentation ---
+size_t appendGraphemeStarts(std::string_view text, std::vector<Uint32>& starts) {
+    const size_t first = starts.size();
+    GraphemeProp prev = GP_CONTROL;
+    bool pictographicSequence = false; // Inside Pictographic Extend* (GB11)
+    bool zwjAfterPictographic = false; // ...followed by a ZWJ
+    size_t regionalRun = 0;            // Regional indicators since the last other codepoint (GB12/13)
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t start = pos;
+        const GraphemeProp prop = getGraphemeProp(decodeUtf8(text, pos));
+
+        bool join;
+        if (start == 0) join = false;                                                      // GB1
+        else if (prev == GP_CR && prop == GP_LF) join = true;                              // GB3
+        else if (prev == GP_CR || prev == GP_LF || prev == GP_CONTROL) join = false;       // GB4
+        else if (prop == GP_CR || prop == GP_LF || prop == GP_CONTROL) join = false;       // GB5
+        else if (prev == GP_L && (prop == GP_L || prop == GP_V || prop == GP_LV || prop == GP_LVT)) join = true; // GB6
+        else if ((prev == GP_LV || prev == GP_V) && (prop == GP_V || prop == GP_T)) join = true;         // GB7
+        else if ((prev == GP_LVT || prev == GP_T) && prop == GP_T) join = true;            // GB8
+        else if (prop == GP_EXTEND || prop == GP_ZWJ) join = true;                         // GB9, GB9a
+        else if (prev == GP_ZWJ && prop == GP_PICTOGRAPHIC && zwjAfterPictographic) join = true; // GB11
+        else if (prev == GP_REGIONAL && prop == GP_REGIONAL) join = (regionalRun % 2) == 1; // GB12, GB13
+        else join = false;                                                                 // GB999
+
+        if (!join) starts.push_back((Uint32)start);
+
+        zwjAfterPictographic = pictographicSequence && prop == GP_ZWJ;
+        if (prop == GP_PICTOGRAPHIC) pictographicSequence = true;
+        else if (prop != GP_EXTEND) pictographicSequence = false;
+        regionalRun = (prop == GP_REGIONAL) ? regionalRun + 1 : 0;
+        prev = prop;
+    }
+    const size_t count = starts.size() - first;
+    starts.push_back((Uint32)text.size());
+    return count;
+}
@@ -0,0 +1,24 @@
+// utf8_text.h - UTF-8 decoding and grapheme cluster boundaries for dialog text
+#pragma once
+#include <SDL3/SDL.h>       // For Uint32
+#include <string_view>      // For std::string_view
+#include <vector>           // For std::vector
+
+// --- Decoding ---
+// Decodes the codepoint starting at text[pos] and advances pos past it. Malformed or truncated
+// sequences decode as U+FFFD and consume a single byte, so decoding always makes progress.
+Uint32 decodeUtf8(std::string_view text, size_t& pos);
+
+// --- Grapheme Clusters ---
+// A grapheme cluster is what a reader sees as one character: a base letter with its combining
+// accents, a Hangul syllable spelled in jamo, an emoji with skin tone / variation selector or
+// a ZWJ sequence, a flag (pair of regional indicators), CR LF. The segmentation follows the
+// UAX #29 rules with compact property tables covering the scripts a story is likely to use.
+
+// Appends the byte offset of every cluster start in `text`, then text.size() as a terminator,
+// so cluster g spans [starts[g], starts[g + 1]). Returns the number of clusters.
+size_t appendGraphemeStarts(std::string_view text, std::vector<Uint32>& starts);
+
+// True for scripts written without spaces between words (CJK ideographs, kana, fullwidth forms),
+// where a line may wrap between any two clusters.
+bool isBreakAnywhereCodepoint(Uint32 cp);
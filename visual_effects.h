@@ -1,22 +1,48 @@
 // visual_effects.h - Header for screen-wide visual effects
 #pragma once
 #include <SDL3/SDL.h> // Included for SDL_FPoint, Uint32, Uint64
+#include "effect_rng.h" // For EffectRng (per-effect random streams)
+
+// --- Screen Effects Context ---
+// Holds the shake and tear state for one story instance, so several StoryManagers
+// (e.g. one per batch-render worker) never share effect state.
+struct ScreenEffectsContext {
+    // Screen shake
+    bool shakeActive = false;                  // Is the shake effect currently active?
+    Uint64 shakeStartTime = 0;                 // SDL_GetTicks() when the shake started
+    Uint32 shakeDuration = 0;                  // How long the shake should last (milliseconds)
+    float shakeIntensity = 0.0f;               // Maximum displacement intensity of the shake
+    SDL_FPoint currentShakeOffset = {0.0f, 0.0f}; // The current (x,y) offset to apply to screen elements
+    EffectRng shakeRng;                        // Private random stream for the shake offsets
+
+    // Screen tear
+    bool tearActive = false;                   // Is the tear effect currently active?
+    Uint64 tearStartTime = 0;                  // SDL_GetTicks() when the tear started
+    Uint32 tearDuration = 0;                   // How long the tear should last (milliseconds)
+    float tearMaxOffsetX = 0.0f;               // The maximum horizontal displacement for the torn part
+    float tearLineDensity = 1.0f;              // How often the tear line changes (higher for more chaotic)
+    float currentTearLineY = 0.0f;             // The Y-coordinate on screen where the tear visually occurs
+    float currentTearOffsetX = 0.0f;           // The X-offset to apply to elements below the tear line
+    EffectRng tearRng;                         // Private random stream for the tear line and offset
+};
 
 // --- Screen Shake Effect ---
 // Initializes a screen shake effect with a duration in milliseconds and an intensity.
 // durationMs: How long the shake lasts.
 // intensity: How strong the shake is (e.g., 0.0f for none, 10.0f for moderate, 20.0f for strong).
-void initScreenShake(Uint32 durationMs, float intensity);
+// startTicks: The story clock time the shake starts at.
+// seed: Seed for the shake's random stream (see makeEffectSeed).
+void initScreenShake(ScreenEffectsContext& ctx, Uint64 startTicks, Uint32 durationMs, float intensity, Uint64 seed);
 
 // Updates the screen shake effect state each frame based on currentTicks.
-void updateScreenShake(Uint64 currentTicks);
+void updateScreenShake(ScreenEffectsContext& ctx, Uint64 currentTicks);
 
 // Gets the current offset for screen shake to apply to rendered elements.
 // Returns a 2D float point representing the (x, y) offset.
-SDL_FPoint getScreenShakeOffset();
+SDL_FPoint getScreenShakeOffset(const ScreenEffectsContext& ctx);
 
 // Checks if screen shake is currently active.
-bool isScreenShakeActive();
+bool isScreenShakeActive(const ScreenEffectsContext& ctx);
 
 
 // --- Screen Tear Effect ---
@@ -24,15 +50,17 @@ bool isScreenShakeActive();
 // durationMs: How long the tear effect lasts.
 // maxOffsetX: The maximum horizontal displacement for the "torn" part of the screen in pixels.
 // tearLineDensity: A float value influencing how rapidly the tear line and offset change (e.g., 0.5 for smoother, 2.0 for choppy).
-void initScreenTear(Uint32 durationMs, float maxOffsetX, float tearLineDensity);
+// startTicks: The story clock time the tear starts at.
+// seed: Seed for the tear's random stream (see makeEffectSeed).
+void initScreenTear(ScreenEffectsContext& ctx, Uint64 startTicks, Uint32 durationMs, float maxOffsetX, float tearLineDensity, Uint64 seed);
 
 // Updates the screen tear effect state each frame based on currentTicks.
-void updateScreenTear(Uint64 currentTicks);
+void updateScreenTear(ScreenEffectsContext& ctx, Uint64 currentTicks);
 
 // Gets the current horizontal offset for elements at a given Y position due to screen tear.
 // yPosition: The vertical position of the element being rendered.
 // Returns a float representing the X offset. Returns 0.0f if the effect is inactive or if the yPosition is above the tear line.
-float getScreenTearXOffset(float yPosition);
+float getScreenTearXOffset(const ScreenEffectsContext& ctx, float yPosition);
 
 // Checks if the screen tear effect is currently active.
-bool isScreenTearActive();
+bool isScreenTearActive(const ScreenEffectsContext& ctx);
@@ -0,0 +1,157 @@
+// voice_blips.cpp - Implementation of the voice blip mixer
+#include "voice_blips.h"    // Include the corresponding header
+#include <iostream>         // For std::cerr
+#include <cmath>            // For std::sin, M_PI
+#include <algorithm>        // For std::min
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// How far ahead of the audio clock the first blip of a run is scheduled. Must cover at least
+// one frame, since a frame's events carry reveal times up to one frame in the past.
+static const double SCHEDULE_LATENCY_MS = 40.0;
+// If the story clock and the audio clock drift further apart than this, re-anchor them.
+static const double MAX_SCHEDULE_AHEAD_MS = 500.0;
+
+VoiceBlipPlayer::VoiceBlipPlayer()
+    : stream(nullptr), samplePosition(0), clockAnchored(false), storyToSampleOffset(0.0),
+      blipsPosted(0), blipsDropped(0), blipsMixed(0), samplesMixed(0) {
+    for (auto& voice : voices) {
+        voice.active = false;
+    }
+}
+
+VoiceBlipPlayer::~VoiceBlipPlayer() {
+    close();
+}
+
+bool VoiceBlipPlayer::open() {
+    if (stream) return true;
+
+    if (!SDL_InitSubSystem(SDL_INIT_AUDIO)) {
+        std::cerr << "Voice blips disabled: SDL audio could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    SDL_AudioSpec spec;
+    spec.format = SDL_AUDIO_F32;
+    spec.channels = 1;
+    spec.freq = SAMPLE_RATE;
+    stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, audioCallback, this);
+    if (!stream) {
+        std::cerr << "Voice blips disabled: failed to open audio device! SDL_Error: " << SDL_GetError() << std::endl;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    SDL_ResumeAudioStreamDevice(stream); // Devices opened this way start paused
+    return true;
+}
+
+void VoiceBlipPlayer::close() {
+    if (!stream) return;
+    SDL_DestroyAudioStream(stream); // Also stops the callback and closes the device
+    stream = nullptr;
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+bool VoiceBlipPlayer::post(const BlipEvent& event) {
+    if (!stream) return false;
+    if (!queue.push(event)) {
+        blipsDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    blipsPosted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// --- Audio Thread ---
+void SDLCALL VoiceBlipPlayer::audioCallback(void* userdata, SDL_AudioStream* audioStream, int additionalAmount, int /*totalAmount*/) {
+    VoiceBlipPlayer* player = (VoiceBlipPlayer*)userdata;
+    int framesNeeded = additionalAmount / (int)sizeof(float);
+    while (framesNeeded > 0) {
+        int chunk = std::min(framesNeeded, MIX_CHUNK_FRAMES);
+        player->mix(player->mixBuffer, chunk);
+        SDL_PutAudioStreamData(audioStream, player->mixBuffer, chunk * (int)sizeof(float));
+        framesNeeded -= chunk;
+    }
+}
+
+void VoiceBlipPlayer::startVoice(const BlipEvent& event) {
+    // Map the event's story-clock time onto the output sample clock
+    double eventSample = event.revealTimeMs * SAMPLE_RATE / 1000.0;
+    double latencySamples = SCHEDULE_LATENCY_MS * SAMPLE_RATE / 1000.0;
+    if (!clockAnchored) {
+        storyToSampleOffset = (double)samplePosition + latencySamples - eventSample;
+        clockAnchored = true;
+    }
+    double start = eventSample + storyToSampleOffset;
+    if (start < (double)samplePosition || start > (double)samplePosition + MAX_SCHEDULE_AHEAD_MS * SAMPLE_RATE / 1000.0) {
+        // The clocks drifted (stall, story clock jump): re-anchor so later blips keep exact spacing again
+        storyToSampleOffset = (double)samplePosition + latencySamples - eventSample;
+        start = eventSample + storyToSampleOffset;
+    }
+
+    // Reuse a free voice, or replace the one that started first
+    Voice* target = &voices[0];
+    for (auto& voice : voices) {
+        if (!voice.active) { target = &voice; break; }
+        if (voice.startSample < target->startSample) target = &voice;
+    }
+    target->active = true;
+    target->startSample = (Uint64)start;
+    target->lengthSamples = (Uint32)std::max(1.0f, event.lengthMs * SAMPLE_RATE / 1000.0f);
+    target->phaseStep = (float)(2.0 * M_PI * event.pitchHz / SAMPLE_RATE);
+    target->volume = event.volume;
+    blipsMixed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void VoiceBlipPlayer::mix(float* out, int frameCount) {
+    const Uint64 chunkStart = samplePosition;
+    const Uint64 chunkEnd = chunkStart + (Uint64)frameCount;
+
+    // Start every queued blip that begins before the end of this chunk. Events are posted in
+    // reveal order, so the first one still in the future ends the scan.
+    BlipEvent event;
+    while (queue.peek(event)) {
+        if (clockAnchored) {
+            double start = event.revealTimeMs * SAMPLE_RATE / 1000.0 + storyToSampleOffset;
+            if (start >= (double)chunkEnd && start <= (double)chunkStart + MAX_SCHEDULE_AHEAD_MS * SAMPLE_RATE / 1000.0) {
+                break;
+            }
+        }
+        queue.pop(event);
+        startVoice(event);
+    }
+
+    for (int i = 0; i < frameCount; ++i) {
+        out[i] = 0.0f;
+    }
+
+    for (auto& voice : voices) {
+        if (!voice.active) continue;
+        const Uint64 voiceEnd = voice.startSample + voice.lengthSamples;
+        Uint64 from = std::max(voice.startSample, chunkStart);
+        Uint64 to = std::min(voiceEnd, chunkEnd);
+        for (Uint64 s = from; s < to; ++s) {
+            float t = (float)(s - voice.startSample);
+            float progress = t / voice.lengthSamples;
+            // Fast attack, linear decay: short enough to read as a "blip", long enough not to click
+            float envelope = std::min(1.0f, t / 96.0f) * (1.0f - progress);
+            float phase = t * voice.phaseStep;
+            // Fundamental plus a third harmonic gives a soft square-ish, speech-like buzz
+            float sample = std::sin(phase) + std::sin(3.0f * phase) * (1.0f / 3.0f);
+            out[s - chunkStart] += sample * envelope * voice.volume;
+        }
+        if (voiceEnd <= chunkEnd) {
+            voice.active = false;
+        }
+    }
+
+    for (int i = 0; i < frameCount; ++i) {
+        out[i] = std::max(-1.0f, std::min(1.0f, out[i])); // Hard clip overlapping blips
+    }
+
+    samplePosition = chunkEnd;
+    samplesMixed.fetch_add((Uint64)frameCount, std::memory_order_relaxed);
+}
@@ -0,0 +1,86 @@
+// voice_blips.h - Per-speaker typewriter "voice blips" mixed on the audio thread
+#pragma once
+#include <SDL3/SDL.h>       // For SDL_AudioStream, Uint32, Uint64
+#include <atomic>           // For std::atomic (stats shared with the audio thread)
+#include "spsc_queue.h"     // For SpscQueue
+
+// --- Voice Parameters ---
+// How one speaker's blips sound. Set per speaker with [VOICE 'Name' pitchHz lengthMs volume].
+struct VoiceParams {
+    float pitchHz = 220.0f;  // Base tone frequency
+    float lengthMs = 35.0f;  // Length of one blip
+    float volume = 0.25f;    // Peak amplitude, 0..1
+};
+
+// --- Blip Event ---
+// Posted by the render thread for every revealed character; consumed by the audio callback.
+struct BlipEvent {
+    double revealTimeMs;     // Story clock time the character became visible (exact, not frame-rounded)
+    float pitchHz;
+    float lengthMs;
+    float volume;
+};
+
+// --- VoiceBlipPlayer ---
+// Owns an SDL3 audio stream whose callback mixes short procedurally generated tones.
+// The render thread only ever does a non-blocking push into a lock-free queue; the audio thread
+// turns each event's story-clock time into an exact sample offset, so blips keep their spacing
+// even when several characters are revealed in one frame at fast animation speeds.
+// Works with any SDL audio driver, including SDL_AUDIO_DRIVER=dummy for headless testing;
+// the counters below let tests check what was mixed.
+class VoiceBlipPlayer {
+public:
+    VoiceBlipPlayer();
+    ~VoiceBlipPlayer();
+
+    // Initializes the SDL audio subsystem and opens the default playback device.
+    // Returns false (leaving blips disabled) if no audio device is available.
+    bool open();
+
+    // Stops the audio callback and closes the device.
+    void close();
+
+    bool isOpen() const { return stream != nullptr; }
+
+    // Queues one blip. Never blocks; returns false and counts a drop if the queue is full.
+    bool post(const BlipEvent& event);
+
+    // --- Stats (safe to read from any thread) ---
+    Uint64 getBlipsPosted() const { return blipsPosted.load(std::memory_order_relaxed); }
+    Uint64 getBlipsDropped() const { return blipsDropped.load(std::memory_order_relaxed); }
+    Uint64 getBlipsMixed() const { return blipsMixed.load(std::memory_order_relaxed); }
+    Uint64 getSamplesMixed() const { return samplesMixed.load(std::memory_order_relaxed); }
+
+private:
+    static const int SAMPLE_RATE = 48000;
+    static const int MAX_VOICES = 16;       // Simultaneous blips; the oldest is replaced when full
+    static const int MIX_CHUNK_FRAMES = 512;
+
+    // A blip currently sounding (audio thread only)
+    struct Voice {
+        bool active;
+        Uint64 startSample;  // Absolute output sample the blip starts at
+        Uint32 lengthSamples;
+        float phaseStep;     // Radians per sample
+        float volume;
+    };
+
+    static void SDLCALL audioCallback(void* userdata, SDL_AudioStream* audioStream, int additionalAmount, int totalAmount);
+    void mix(float* out, int frameCount);
+    void startVoice(const BlipEvent& event);
+
+    SDL_AudioStream* stream;
+    SpscQueue<BlipEvent, 256> queue;
+
+    // Audio-thread state
+    Voice voices[MAX_VOICES];
+    Uint64 samplePosition;   // Output samples produced so far
+    bool clockAnchored;      // Whether storyToSampleOffset has been set by a first event
+    double storyToSampleOffset; // sample = revealTimeMs * SAMPLE_RATE / 1000 + offset
+    float mixBuffer[MIX_CHUNK_FRAMES];
+
+    std::atomic<Uint64> blipsPosted;
+    std::atomic<Uint64> blipsDropped;
+    std::atomic<Uint64> blipsMixed;
+    std::atomic<Uint64> samplesMixed;
+};